@@ -48,6 +48,10 @@ Settings config = {
 
     /** Custom command to generate preview icons */
     .preview_cmd = NULL,
+    /** Maximum number of thumbnailers running at the same time */
+    .max_thumbnailers = 4,
+    /** Memory budget for loaded icons, unlimited */
+    .icon_cache_size = NULL,
 
     /** Terminal to use. (for ssh and open in terminal) */
     .terminal_emulator = "rofi-sensible-terminal",
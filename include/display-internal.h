@@ -39,6 +39,7 @@ struct _view_proxy;
 typedef struct _display_proxy {
   gboolean (*setup)(GMainLoop *main_loop, NkBindings *bindings);
   gboolean (*late_setup)(void);
+  gboolean (*resume)(void);
   void (*early_cleanup)(void);
   void (*cleanup)(void);
   void (*dump_monitor_layout)(void);
@@ -91,6 +91,14 @@ gboolean display_setup(GMainLoop *main_loop, NkBindings *bindings);
  */
 gboolean display_late_setup(void);
 
+/**
+ * Re-acquire what display_early_cleanup() released, so a window can be shown
+ * again by a resident (daemon) rofi.
+ *
+ * @returns Whether the display is ready to show a window again
+ */
+gboolean display_resume(void);
+
 /**
  * Do some early cleanup, like unmapping the surface
  */
@@ -49,6 +49,18 @@ PangoAttrList *helper_token_match_get_pango_attr(RofiHighlightColorStyle th,
                                                  const char *input,
                                                  PangoAttrList *retv);
 
+/**
+ * @param th The RofiHighlightColorStyle
+ * @param spans The matched spans (rofi_range_pair), may be NULL.
+ * @param retv The Attribute list to update with matches
+ *
+ * Creates a set of pango attributes highlighting the spans found by
+ * helper_token_match_get_spans or rofi_scorer_fuzzy_align.
+ */
+void helper_token_match_spans_to_pango_attr(RofiHighlightColorStyle th,
+                                            const GArray *spans,
+                                            PangoAttrList *retv);
+
 /**
  * @param retv The Attribute list to update with matches
  * @param start The start to highlighting.
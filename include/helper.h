@@ -137,6 +137,18 @@ int find_arg(const char *const key);
  * @returns TRUE when matches, FALSE otherwise
  */
 int helper_token_match(rofi_int_matcher *const *tokens, const char *input);
+
+/**
+ * @param tokens  List of (input) tokens to match.
+ * @param input   The string to find the matches in.
+ *
+ * Find the parts of input matched by the (non-inverted) tokens.
+ *
+ * @returns an array of rofi_range_pair with the byte offsets of the matches,
+ * or NULL when highlighting is not supported. Free with g_array_free.
+ */
+GArray *helper_token_match_get_spans(rofi_int_matcher *const *tokens,
+                                     const char *input);
 /**
  * @param cmd The command to execute.
  *
@@ -264,6 +276,21 @@ char *rofi_latin_to_utf8_strdup(const char *input, gssize length);
  */
 int rofi_scorer_fuzzy_evaluate(const char *pattern, glong plen, const char *str,
                                glong slen);
+
+/**
+ * @param pattern   The user input to match against.
+ * @param plen      Pattern length.
+ * @param str       The input to match against pattern.
+ *
+ * Find the alignment rofi_scorer_fuzzy_evaluate scores `pattern` to `str`
+ * with, so highlighting shows the characters the score is based on.
+ *
+ * @returns an array of rofi_range_pair with the byte offsets of the aligned
+ * characters, or NULL when pattern does not align to str. Free with
+ * g_array_free.
+ */
+GArray *rofi_scorer_fuzzy_align(const char *pattern, glong plen,
+                                const char *str);
 /*@}*/
 
 /**
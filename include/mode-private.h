@@ -47,6 +47,9 @@ typedef enum {
   MODE_TYPE_COMPLETER = 0x2,
   /** DMenu mode. */
   MODE_TYPE_DMENU = 0x4,
+  /** The _init function can run on a worker thread at startup, it does not
+   * use the display, the view or the icon fetcher. */
+  MODE_TYPE_THREADED_INIT = 0x8,
 } ModeType;
 
 /**
@@ -96,6 +96,33 @@ typedef enum {
  */
 int mode_init(Mode *mode);
 
+/**
+ * @param mode The mode to initialize on another thread.
+ *
+ * Mark the mode as being initialized, before handing it to a thread that calls
+ * mode_init_claimed(). Until that returns, the mode has no entries and
+ * mode_result() waits for it.
+ */
+void mode_init_claim(Mode *mode);
+
+/**
+ * @param mode The mode claimed with mode_init_claim().
+ *
+ * Initialize a claimed mode.
+ *
+ * @returns FALSE if there was a failure, TRUE if successful
+ */
+int mode_init_claimed(Mode *mode);
+
+/**
+ * @param mode The mode to check.
+ *
+ * Check if the mode is being initialized, possibly on another thread.
+ *
+ * @returns TRUE while the mode is being initialized.
+ */
+gboolean mode_init_pending(const Mode *mode);
+
 /**
  * @param mode The mode to destroy
  *
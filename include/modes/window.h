@@ -41,7 +41,22 @@
 extern Mode window_mode;
 extern Mode window_mode_cd;
 
+/**
+ * @param win The window that was created or destroyed.
+ * @param create TRUE when the window was created.
+ *
+ * Update the window list for a created or destroyed window.
+ */
 void window_client_handle_signal(xcb_window_t win, gboolean create);
+
+/**
+ * @param win The window with the changed property.
+ * @param atom The property that changed.
+ *
+ * Update the window list entry of win, or the list itself when a property
+ * of the root window changed.
+ */
+void window_client_handle_property(xcb_window_t win, xcb_atom_t atom);
 #endif // defined(WINDOW_MODE) && defined(ENABLE_XCB)
 /** @}*/
 #endif // ROFI_MODE_WINDOW_H
@@ -0,0 +1,78 @@
+#ifndef ROFI_DAEMON_H
+#define ROFI_DAEMON_H
+
+#include <glib.h>
+
+/**
+ * @defgroup DAEMON Daemon
+ * @ingroup HELPERS
+ *
+ * Keep rofi resident in the background, with the display connection, theme,
+ * fonts and icon cache loaded, and show a window on request of a thin client
+ * talking over a UNIX socket in the user runtime directory.
+ * @{
+ */
+
+/**
+ * @param mode The name of the mode to show.
+ * @param filter The filter to pre-set, or NULL.
+ *
+ * Called by the daemon on the main thread when a client requests a window.
+ * When the window is closed, rofi_daemon_session_finish() should be called.
+ */
+typedef void (*RofiDaemonShowFunc)(const char *mode, const char *filter);
+
+/**
+ * @param replace Terminate a running daemon instead of failing.
+ *
+ * Take the daemon lock, so only one daemon owns the socket.
+ *
+ * @returns TRUE when the lock was taken.
+ */
+gboolean rofi_daemon_lock(gboolean replace);
+
+/**
+ * @param show Function called for each client request.
+ *
+ * Start listening on the daemon socket, rofi_daemon_lock() should have
+ * succeeded first.
+ *
+ * @returns TRUE when listening.
+ */
+gboolean rofi_daemon_start(RofiDaemonShowFunc show);
+
+/**
+ * Stop listening, drop pending requests and release the daemon lock.
+ */
+void rofi_daemon_stop(void);
+
+/**
+ * Check if a window is currently shown on request of a client.
+ *
+ * @returns TRUE when a client is waiting for the window to close.
+ */
+gboolean rofi_daemon_session_active(void);
+
+/**
+ * @param exit_code The exit code to send to the waiting client.
+ *
+ * Reply to the client that requested the current window and start the next
+ * queued request, if any.
+ */
+void rofi_daemon_session_finish(int exit_code);
+
+/**
+ * @param argc Number of arguments.
+ * @param argv The arguments.
+ *
+ * If the arguments only consist of `-show` and `-filter`, and a daemon is
+ * listening, forward the request to it and wait for the window to close.
+ * The working directory and display environment are forwarded too, the daemon
+ * applies them to the commands launched for the request.
+ *
+ * @returns the exit code of the request, or -1 when it was not forwarded.
+ */
+int rofi_daemon_forward(int argc, char **argv);
+
+/**@}*/
+#endif // ROFI_DAEMON_H
@@ -13,6 +13,22 @@
  * @{
  */
 
+/**
+ * Statistics of the icon surface cache.
+ */
+typedef struct {
+  /** Queries answered with a loaded surface. */
+  uint64_t hits;
+  /** Queries for an evicted surface, that needed a reload. */
+  uint64_t misses;
+  /** Surfaces dropped to stay within the budget. */
+  uint64_t evictions;
+  /** Bytes currently used by surfaces. */
+  size_t size;
+  /** Maximum bytes, 0 when unlimited. */
+  size_t budget;
+} RofiIconFetcherStats;
+
 /**
  * Initialize the icon fetcher.
  */
@@ -81,5 +97,12 @@ gboolean rofi_icon_fetcher_get_ex(const uint32_t uid,
  * @returns true if image, false otherwise.
  */
 gboolean rofi_icon_fetcher_file_is_image(const char *const path);
+
+/**
+ * @param stats [out] The current cache statistics.
+ *
+ * Get the statistics of the icon surface cache.
+ */
+void rofi_icon_fetcher_get_stats(RofiIconFetcherStats *stats);
 /** @} */
 #endif // ROFI_ICON_FETCHER_H
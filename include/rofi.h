@@ -103,6 +103,16 @@ void rofi_quit_main_loop(void);
  */
 Mode *rofi_collect_modes_search(const char *name);
 
+/**
+ * @param name The name of the mode.
+ *
+ * Check for a built-in or plugin mode with this name, without opening the
+ * plugins that are not loaded yet.
+ *
+ * @return TRUE when found.
+ */
+gboolean rofi_collect_modes_provides(const char *name);
+
 /**
  * Query the configure file completer.
  *
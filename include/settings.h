@@ -68,6 +68,10 @@ typedef struct {
   
   /** Custom command to generate preview icons */
   char *preview_cmd;
+  /** Maximum number of thumbnailers running at the same time */
+  unsigned int max_thumbnailers;
+  /** Memory budget for loaded icons (e.g. 64M), NULL is unlimited */
+  char *icon_cache_size;
 
   /** Terminal to use  */
   char *terminal_emulator;
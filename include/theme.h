@@ -290,6 +290,21 @@ RofiHighlightColorStyle rofi_theme_get_highlight(widget *widget,
  * @returns the number of pixels this distance represents.
  */
 int distance_get_pixel(RofiDistance d, RofiOrientation ori);
+/**
+ * Get the generation of the values distances are converted with: the font
+ * size (em, ch), the monitor size (%), the dpi (mm) and the theme. The
+ * generation changes when any of these changes, so pixel values can be cached
+ * until it does.
+ *
+ * @returns the current generation, never 0.
+ */
+unsigned int distance_get_generation(void);
+
+/**
+ * Start a new distance generation, called by the code that changes the font,
+ * the monitor, the dpi, the scale or the theme.
+ */
+void distance_bump_generation(void);
 /**
  * @param d The distance handle.
  * @param draw The cairo drawable.
@@ -329,6 +344,49 @@ void rofi_theme_reset(void);
  */
 char *rofi_theme_parse_prepare_file(const char *file);
 
+/**
+ * @param name Name of the environment variable.
+ *
+ * Lookup an environment variable for the parser, recording it when the
+ * theme is being recorded for the theme cache.
+ *
+ * @returns the value, or NULL when not set.
+ */
+const char *rofi_theme_parse_getenv(const char *name);
+
+/**
+ * Mark the theme being recorded as not cacheable, because it contains
+ * something (like a configuration block) that is not kept in the theme tree.
+ */
+void rofi_theme_parse_uncacheable(void);
+
+/**
+ * Start recording the parsed files and the environment variables used, so
+ * the parsed theme can be stored with rofi_theme_cache_record_end().
+ */
+void rofi_theme_cache_record_begin(void);
+
+/**
+ * @param cache_file The theme cache file to write, or NULL to only stop
+ * recording.
+ * @param file The full path of the theme file that was parsed.
+ *
+ * Stop recording and store the current theme in the theme cache.
+ */
+void rofi_theme_cache_record_end(const char *cache_file, const char *file);
+
+/**
+ * @param cache_file The theme cache file to read.
+ * @param file The full path of the theme file.
+ *
+ * Replace the current theme with the one stored in the theme cache, if it
+ * was stored for file and none of the files it was parsed from, or the
+ * environment variables it used, changed.
+ *
+ * @returns TRUE when the theme was loaded from the cache.
+ */
+gboolean rofi_theme_cache_load(const char *cache_file, const char *file);
+
 /**
  * Process conditionals.
  */
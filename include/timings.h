@@ -33,6 +33,14 @@
 #ifndef ROFI_TIMINGS_H
 #define ROFI_TIMINGS_H
 
+#include <glib.h>
+
+/**
+ * Set when the trace is recorded, see `-profile-out`.
+ * Checked by the macros, so disabled spans and counters only cost a branch.
+ */
+extern gboolean rofi_timings_profiling;
+
 /**
  * Init the timestamping mechanism .
  * implementation.
@@ -49,10 +57,79 @@ void rofi_timings_init(void);
 void rofi_timings_tick(const char *file, char const *str, int line,
                        char const *msg);
 /**
- * Stop the timestamping mechanism
+ * Stop the timestamping mechanism, and write out the trace if requested.
  */
 void rofi_timings_quit(void);
 
+/**
+ * @param name static name of the span.
+ *
+ * Open a span on the calling thread. Spans nest per thread.
+ */
+void rofi_timings_span_begin(const char *name);
+/**
+ * @param name static name of the span, the same as passed to begin.
+ *
+ * Close the innermost span on the calling thread.
+ */
+void rofi_timings_span_end(const char *name);
+/**
+ * @param name static name of the counter.
+ * @param delta amount to add to the counter.
+ *
+ * Add to a counter, the trace records the running total.
+ */
+void rofi_timings_counter_add(const char *name, gint64 delta);
+
+/**
+ * Set when input latency is measured, see `-latency-out`.
+ */
+extern gboolean rofi_timings_latency;
+
+/**
+ * The measured steps between a keystroke and its result on screen.
+ */
+typedef enum {
+  /** From the key event to the start of the refilter. */
+  ROFI_LATENCY_INPUT_TO_REFILTER,
+  /** Filtering (and sorting) the entries. */
+  ROFI_LATENCY_REFILTER,
+  /** Layout and drawing of the widgets. */
+  ROFI_LATENCY_DRAW,
+  /** Handing the frame to the display server (commit or flush). */
+  ROFI_LATENCY_COMMIT,
+  /** From the commit to the next frame callback (Wayland). */
+  ROFI_LATENCY_FRAME_CALLBACK,
+  /** From the key event to the frame handed to the display server. */
+  ROFI_LATENCY_INPUT_TO_PAINT,
+  /** Number of steps. */
+  ROFI_LATENCY_NUM_STEPS
+} RofiLatencyStep;
+
+/**
+ * Record a key event, the steps until it is painted are measured.
+ */
+void rofi_timings_latency_input(void);
+/**
+ * @param step The step.
+ *
+ * Start timing step, if a key event waits to be painted.
+ */
+void rofi_timings_latency_begin(RofiLatencyStep step);
+/**
+ * @param step The step.
+ *
+ * Stop timing step, and add the duration to its histogram.
+ */
+void rofi_timings_latency_end(RofiLatencyStep step);
+/**
+ * @param step The step.
+ *
+ * Add the time since the pending key event to the histogram of step.
+ * For ROFI_LATENCY_INPUT_TO_PAINT, this also finishes the key event.
+ */
+void rofi_timings_latency_mark(RofiLatencyStep step);
+
 /**
  * Start timestamping mechanism.
  * Call to this function is time 0.
@@ -71,6 +148,76 @@ void rofi_timings_quit(void);
  * Stop timestamping mechanism.
  */
 #define TIMINGS_STOP() rofi_timings_quit()
+/**
+ * @param a static span name
+ * Open a span in the profile trace.
+ */
+#define TIMINGS_SPAN_BEGIN(a)                                                  \
+  do {                                                                         \
+    if (rofi_timings_profiling) {                                              \
+      rofi_timings_span_begin(a);                                              \
+    }                                                                          \
+  } while (0)
+/**
+ * @param a static span name
+ * Close a span in the profile trace.
+ */
+#define TIMINGS_SPAN_END(a)                                                    \
+  do {                                                                         \
+    if (rofi_timings_profiling) {                                              \
+      rofi_timings_span_end(a);                                                \
+    }                                                                          \
+  } while (0)
+/**
+ * @param a static counter name
+ * @param d amount to add
+ * Add to a counter in the profile trace.
+ */
+#define TIMINGS_COUNTER(a, d)                                                  \
+  do {                                                                         \
+    if (rofi_timings_profiling) {                                              \
+      rofi_timings_counter_add(a, d);                                          \
+    }                                                                          \
+  } while (0)
+/**
+ * Record a key event for the latency histograms.
+ */
+#define TIMINGS_LATENCY_INPUT()                                                \
+  do {                                                                         \
+    if (rofi_timings_latency) {                                                \
+      rofi_timings_latency_input();                                            \
+    }                                                                          \
+  } while (0)
+/**
+ * @param a RofiLatencyStep
+ * Start timing a latency step.
+ */
+#define TIMINGS_LATENCY_BEGIN(a)                                               \
+  do {                                                                         \
+    if (rofi_timings_latency) {                                                \
+      rofi_timings_latency_begin(a);                                           \
+    }                                                                          \
+  } while (0)
+/**
+ * @param a RofiLatencyStep
+ * Stop timing a latency step.
+ */
+#define TIMINGS_LATENCY_END(a)                                                 \
+  do {                                                                         \
+    if (rofi_timings_latency) {                                                \
+      rofi_timings_latency_end(a);                                             \
+    }                                                                          \
+  } while (0)
+/**
+ * @param a RofiLatencyStep
+ * Record the time since the pending key event.
+ */
+#define TIMINGS_LATENCY_MARK(a)                                                \
+  do {                                                                         \
+    if (rofi_timings_latency) {                                                \
+      rofi_timings_latency_mark(a);                                            \
+    }                                                                          \
+  } while (0)
 
 #else
 
@@ -92,6 +239,41 @@ void rofi_timings_quit(void);
  * Report current time since TIMINGS_START
  */
 #define TICK_N(a)
+/**
+ * @param a static span name
+ * Open a span in the profile trace.
+ */
+#define TIMINGS_SPAN_BEGIN(a)
+/**
+ * @param a static span name
+ * Close a span in the profile trace.
+ */
+#define TIMINGS_SPAN_END(a)
+/**
+ * @param a static counter name
+ * @param d amount to add
+ * Add to a counter in the profile trace.
+ */
+#define TIMINGS_COUNTER(a, d)
+/**
+ * Record a key event for the latency histograms.
+ */
+#define TIMINGS_LATENCY_INPUT()
+/**
+ * @param a RofiLatencyStep
+ * Start timing a latency step.
+ */
+#define TIMINGS_LATENCY_BEGIN(a)
+/**
+ * @param a RofiLatencyStep
+ * Stop timing a latency step.
+ */
+#define TIMINGS_LATENCY_END(a)
+/**
+ * @param a RofiLatencyStep
+ * Record the time since the pending key event.
+ */
+#define TIMINGS_LATENCY_MARK(a)
 
 #endif // ROFI_TIMINGS_H
 /**@}*/
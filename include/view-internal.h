@@ -159,6 +159,14 @@ struct RofiViewState {
 
   /** Regexs used for matching */
   rofi_int_matcher **tokens;
+  /** The (preprocessed) input the tokens were created from. */
+  char *tokens_pattern;
+  /** Highlighted spans of shown entries, keyed on entry, until the tokens
+   * change. */
+  GHashTable *highlight_spans;
+
+  /** Shaped rows, keyed on entry and row state, until the next refilter. */
+  GHashTable *row_layouts;
 };
 /** @} */
 
@@ -123,7 +123,7 @@ struct _wayland_seat {
 };
 
 /* Supported interface versions */
-#define WL_COMPOSITOR_INTERFACE_VERSION 3
+#define WL_COMPOSITOR_INTERFACE_VERSION 4
 #define WL_SHM_INTERFACE_VERSION 1
 #define WL_SEAT_INTERFACE_MIN_VERSION 5
 #define WL_SEAT_INTERFACE_MAX_VERSION 8
@@ -38,7 +38,11 @@ display_buffer_pool *display_buffer_pool_new(gint width, gint height);
 void display_buffer_pool_free(display_buffer_pool *pool);
 
 cairo_surface_t *display_buffer_pool_get_next_buffer(display_buffer_pool *pool);
-void display_surface_commit(cairo_surface_t *surface);
+cairo_region_t *
+display_buffer_pool_get_repaint_region(cairo_surface_t *surface,
+                                       const cairo_region_t *damage);
+void display_surface_commit(cairo_surface_t *surface,
+                            const cairo_region_t *damage);
 
 gboolean display_get_surface_dimensions(int *width, int *height);
 void display_set_surface_dimensions(int width, int height, int x_margin,
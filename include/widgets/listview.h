@@ -288,6 +288,15 @@ void listview_set_ellipsize(listview *lv, PangoEllipsizeMode mode);
  *
  */
 void listview_set_filtered(listview *lv, gboolean filtered);
+
+/**
+ * @param lv Handler to the listview object.
+ *
+ * Rows only pull their content when the element they show, or its drawing
+ * mode, changes. Make all rows pull it again on the next draw, for when the
+ * content of the elements changed.
+ */
+void listview_refresh_rows(listview *lv);
 /** @} */
 
 #endif // ROFI_LISTVIEW_H
@@ -82,6 +82,10 @@ typedef struct {
   PangoEllipsizeMode emode;
   //
   const char *theme_name;
+
+  /** Shaped glyph runs of the layout, replayed while the layout is
+   * unchanged. */
+  struct _TextboxGlyphCache *glyph_cache;
 } textbox;
 
 /**
@@ -306,6 +310,36 @@ void textbox_set_pango_attributes(textbox *tb, PangoAttrList *list);
  */
 PangoAttrList *textbox_get_pango_attributes(textbox *tb);
 
+/**
+ * @param tb Handle to the textbox
+ *
+ * Get the pango layout of the textbox, so it can be kept after the textbox
+ * moves on to other text. Call textbox_detach_layout() before changing the
+ * text of the textbox.
+ *
+ * @returns the pango layout (owned by the textbox).
+ */
+PangoLayout *textbox_get_layout(textbox *tb);
+
+/**
+ * @param tb Handle to the textbox
+ *
+ * Give the textbox a new layout, with the same settings as the current one,
+ * leaving the current layout unchanged for whoever holds a reference to it.
+ */
+void textbox_detach_layout(textbox *tb);
+
+/**
+ * @param tb Handle to the textbox
+ * @param layout A layout previously taken from a textbox with the same
+ * settings.
+ * @param text The text shown by layout.
+ *
+ * Show a previously shaped layout, instead of setting and shaping the text
+ * again with textbox_text().
+ */
+void textbox_set_layout(textbox *tb, PangoLayout *layout, const char *text);
+
 /**
  * @param tb Handle to the textbox
  *
@@ -50,6 +50,22 @@
     .bottom = WIDGET_DISTANCE_INIT, .left = WIDGET_DISTANCE_INIT,              \
   }
 
+/**
+ * The distances of a widget converted to pixels, in the order left, top,
+ * right, bottom.
+ */
+typedef struct {
+  /** Margin in pixels */
+  int margin[4];
+  /** Border width in pixels */
+  int border[4];
+  /** Border radius in pixels, bottom-left, top-left, top-right,
+   * bottom-right. */
+  int radius[4];
+  /** Padding in pixels */
+  int padding[4];
+} WidgetPixels;
+
 /**
  * Data structure holding the internal state of the Widget
  */
@@ -74,6 +90,11 @@ struct _widget {
   RofiPadding border;
   RofiPadding border_radius;
 
+  /** Margin, border, border-radius and padding converted to pixels. */
+  WidgetPixels pixels;
+  /** Distance generation pixels was computed for, 0 if not computed. */
+  unsigned int pixels_generation;
+
   /** Cursor that is set when the widget is hovered */
   RofiCursorType cursor_type;
 
@@ -119,6 +140,14 @@ struct _widget {
   /** Name of widget (used for theming) */
   char *name;
   const char *state;
+
+  /** Area that needs to be redrawn, only kept on the toplevel widget. */
+  cairo_region_t *damage;
+
+  /** Resolved theme style for name and state, owned by the theme. */
+  struct _ThemeStyle *style;
+  /** Generation of the theme style cache the style was taken from. */
+  unsigned int style_generation;
 };
 
 /**
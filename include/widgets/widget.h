@@ -247,9 +247,21 @@ void widget_update(widget *wid);
  * @param wid The widget handle
  *
  * Indicate that the widget needs to be redrawn.
- * This is done by setting the redraw flag on the toplevel widget.
+ * This is done by setting the redraw flag on the toplevel widget, and adding
+ * the area of the widget to the damage of the toplevel widget.
  */
 void widget_queue_redraw(widget *wid);
+
+/**
+ * @param wid The toplevel widget handle
+ *
+ * Take the area that changed since the last call, in the coordinates of the
+ * surface the toplevel widget is drawn on. The damage is reset.
+ *
+ * @returns the damaged region (free with cairo_region_destroy()), or NULL if
+ * nothing was damaged.
+ */
+cairo_region_t *widget_take_damage(widget *wid);
 /**
  * @param wid The widget handle
  *
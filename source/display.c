@@ -27,6 +27,8 @@ gboolean display_setup(GMainLoop *main_loop, NkBindings *bindings) {
 
 gboolean display_late_setup(void) { return proxy->late_setup(); }
 
+gboolean display_resume(void) { return proxy->resume(); }
+
 void display_early_cleanup(void) { proxy->early_cleanup(); }
 
 void display_cleanup(void) { proxy->cleanup(); }
@@ -34,6 +34,7 @@
 #include "helper-theme.h"
 #include "rofi.h"
 #include "settings.h"
+#include "timings.h"
 #include "view.h"
 #include <ctype.h>
 #include <errno.h>
@@ -218,6 +219,7 @@ static rofi_int_matcher *create_regex(const char *input, int case_sensitive) {
   GRegex *retv = NULL;
   gchar *r;
   rofi_int_matcher *rv = g_malloc0(sizeof(rofi_int_matcher));
+  TIMINGS_COUNTER("regex compiles", 1);
   if (input && input[0] == config.matching_negate_char) {
     rv->invert = 1;
     input++;
@@ -479,33 +481,55 @@ void helper_token_match_set_pango_attr_on_style(PangoAttrList *retv, int start,
   }
 }
 
-PangoAttrList *helper_token_match_get_pango_attr(RofiHighlightColorStyle th,
-                                                 rofi_int_matcher **tokens,
-                                                 const char *input,
-                                                 PangoAttrList *retv) {
+GArray *helper_token_match_get_spans(rofi_int_matcher *const *tokens,
+                                     const char *input) {
   // Disable highlighting for normalize match, not supported atm.
-  if (config.normalize_match) {
-    return retv;
+  if (config.normalize_match || tokens == NULL || input == NULL) {
+    return NULL;
   }
+  GArray *spans = g_array_new(FALSE, FALSE, sizeof(rofi_range_pair));
   // Do a tokenized match.
-  if (tokens) {
-    for (int j = 0; tokens[j]; j++) {
-      GMatchInfo *gmi = NULL;
-      if (tokens[j]->invert) {
-        continue;
-      }
-      g_regex_match(tokens[j]->regex, input, G_REGEX_MATCH_PARTIAL, &gmi);
-      while (g_match_info_matches(gmi)) {
-        int count = g_match_info_get_match_count(gmi);
-        for (int index = (count > 1) ? 1 : 0; index < count; index++) {
-          int start, end;
-          g_match_info_fetch_pos(gmi, index, &start, &end);
-          helper_token_match_set_pango_attr_on_style(retv, start, end, th);
-        }
-        g_match_info_next(gmi, NULL);
+  for (int j = 0; tokens[j]; j++) {
+    GMatchInfo *gmi = NULL;
+    if (tokens[j]->invert) {
+      continue;
+    }
+    g_regex_match(tokens[j]->regex, input, G_REGEX_MATCH_PARTIAL, &gmi);
+    while (g_match_info_matches(gmi)) {
+      int count = g_match_info_get_match_count(gmi);
+      for (int index = (count > 1) ? 1 : 0; index < count; index++) {
+        rofi_range_pair span;
+        g_match_info_fetch_pos(gmi, index, &(span.start), &(span.stop));
+        g_array_append_val(spans, span);
       }
-      g_match_info_free(gmi);
+      g_match_info_next(gmi, NULL);
     }
+    g_match_info_free(gmi);
+  }
+  return spans;
+}
+
+void helper_token_match_spans_to_pango_attr(RofiHighlightColorStyle th,
+                                            const GArray *spans,
+                                            PangoAttrList *retv) {
+  if (spans == NULL) {
+    return;
+  }
+  for (guint i = 0; i < spans->len; i++) {
+    const rofi_range_pair *span = &g_array_index(spans, rofi_range_pair, i);
+    helper_token_match_set_pango_attr_on_style(retv, span->start, span->stop,
+                                               th);
+  }
+}
+
+PangoAttrList *helper_token_match_get_pango_attr(RofiHighlightColorStyle th,
+                                                 rofi_int_matcher **tokens,
+                                                 const char *input,
+                                                 PangoAttrList *retv) {
+  GArray *spans = helper_token_match_get_spans(tokens, input);
+  if (spans != NULL) {
+    helper_token_match_spans_to_pango_attr(th, spans, retv);
+    g_array_free(spans, TRUE);
   }
   return retv;
 }
@@ -975,6 +999,151 @@ int rofi_scorer_fuzzy_evaluate(const char *pattern, glong plen, const char *str,
   return -lefts;
 }
 
+GArray *rofi_scorer_fuzzy_align(const char *pattern, glong plen,
+                                const char *str) {
+  glong slen = g_utf8_strlen(str, -1);
+  if (slen == 0 || slen > FUZZY_SCORER_MAX_LENGTH) {
+    return NULL;
+  }
+  // The pattern characters that are aligned, and if they start a word.
+  gunichar *pcs = g_malloc_n(plen, sizeof(gunichar));
+  gboolean *pstarts = g_malloc_n(plen, sizeof(gboolean));
+  glong m = 0;
+  gboolean pstart = TRUE;
+  const gchar *pit = pattern;
+  for (glong pi = 0; pi < plen; pi++, pit = g_utf8_next_char(pit)) {
+    gunichar pc = g_utf8_get_char(pit);
+    if (g_unichar_isspace(pc)) {
+      pstart = TRUE;
+      continue;
+    }
+    pcs[m] = pc;
+    pstarts[m] = pstart;
+    pstart = FALSE;
+    m++;
+  }
+  if (m == 0) {
+    g_free(pcs);
+    g_free(pstarts);
+    return NULL;
+  }
+
+  // Byte offset and score of each character of str.
+  int *offsets = g_malloc_n(slen + 1, sizeof(int));
+  int *score = g_malloc_n(slen, sizeof(int));
+  gunichar *scs = g_malloc_n(slen, sizeof(gunichar));
+  enum CharClass prev = NON_WORD;
+  const gchar *sit = str;
+  for (glong si = 0; si < slen; si++, sit = g_utf8_next_char(sit)) {
+    offsets[si] = sit - str;
+    scs[si] = g_utf8_get_char(sit);
+    enum CharClass cur = rofi_scorer_get_character_class(scs[si]);
+    score[si] = rofi_scorer_get_score_for(prev, cur);
+    prev = cur;
+  }
+  offsets[slen] = sit - str;
+
+  // Same recurrence as rofi_scorer_fuzzy_evaluate, but keeping all rows and
+  // where each aligned character came from, so the alignment can be traced
+  // back.
+  int *dp = g_malloc_n(m * slen, sizeof(int));
+  int *from = g_malloc_n(m * slen, sizeof(int));
+  for (glong k = 0; k < m; k++) {
+    int *row = &(dp[k * slen]);
+    int *prow = (k > 0) ? &(dp[(k - 1) * slen]) : NULL;
+    int lefts = MIN_SCORE, lefts_pos = -1;
+    for (glong si = 0; si < slen; si++) {
+      // Best cell on the row above up to si - 1, with the gap to si - 1.
+      int ulefts = lefts, ulefts_pos = lefts_pos;
+      if (prow != NULL) {
+        if (prow[si] >= lefts + GAP_SCORE) {
+          lefts = prow[si];
+          lefts_pos = si;
+        } else {
+          lefts += GAP_SCORE;
+        }
+      }
+      row[si] = MIN_SCORE;
+      from[k * slen + si] = -1;
+      gboolean match =
+          config.case_sensitive
+              ? pcs[k] == scs[si]
+              : g_unichar_tolower(pcs[k]) == g_unichar_tolower(scs[si]);
+      if (!match) {
+        continue;
+      }
+      int t = score[si] * (pstarts[k] ? PATTERN_START_MULTIPLIER
+                                      : PATTERN_NON_START_MULTIPLIER);
+      if (k == 0) {
+        row[si] = LEADING_GAP_SCORE * si + t;
+        continue;
+      }
+      if (si == 0) {
+        continue;
+      }
+      int consecutive = (prow[si - 1] > MIN_SCORE / 2)
+                            ? prow[si - 1] + CONSECUTIVE_SCORE
+                            : MIN_SCORE;
+      int gap = (ulefts_pos >= 0 && prow[ulefts_pos] > MIN_SCORE / 2)
+                    ? ulefts + t
+                    : MIN_SCORE;
+      if (consecutive >= gap && consecutive > MIN_SCORE) {
+        row[si] = consecutive;
+        from[k * slen + si] = si - 1;
+      } else if (gap > MIN_SCORE) {
+        row[si] = gap;
+        from[k * slen + si] = ulefts_pos;
+      }
+    }
+  }
+
+  // Best end position, including the trailing gap.
+  int best = MIN_SCORE;
+  glong best_pos = -1;
+  for (glong si = 0; si < slen; si++) {
+    int v = dp[(m - 1) * slen + si];
+    if (v > MIN_SCORE / 2 && v + GAP_SCORE * (slen - 1 - si) > best) {
+      best = v + GAP_SCORE * (slen - 1 - si);
+      best_pos = si;
+    }
+  }
+
+  GArray *spans = NULL;
+  if (best_pos >= 0) {
+    spans = g_array_new(FALSE, FALSE, sizeof(rofi_range_pair));
+    glong *positions = g_malloc_n(m, sizeof(glong));
+    glong si = best_pos;
+    for (glong k = m - 1; k >= 0; k--) {
+      positions[k] = si;
+      si = from[k * slen + si];
+    }
+    // Merge consecutive characters into one span.
+    for (glong k = 0; k < m; k++) {
+      rofi_range_pair span = {offsets[positions[k]],
+                              offsets[positions[k] + 1]};
+      if (spans->len > 0) {
+        rofi_range_pair *last =
+            &g_array_index(spans, rofi_range_pair, spans->len - 1);
+        if (last->stop == span.start) {
+          last->stop = span.stop;
+          continue;
+        }
+      }
+      g_array_append_val(spans, span);
+    }
+    g_free(positions);
+  }
+
+  g_free(dp);
+  g_free(from);
+  g_free(offsets);
+  g_free(score);
+  g_free(scs);
+  g_free(pcs);
+  g_free(pstarts);
+  return spans;
+}
+
 /**
  * @param a    UTF-8 string to compare
  * @param b    UTF-8 string to compare
@@ -41,7 +41,39 @@
  * @{
  */
 
-int mode_init(Mode *mode) {
+/** Guards #mode_init_busy. */
+static GMutex mode_init_lock;
+/** Signalled when a mode finished initializing. */
+static GCond mode_init_cond;
+/** Modes that are being initialized, possibly on another thread. */
+static GSList *mode_init_busy = NULL;
+
+/**
+ * @param mode The mode to wait for.
+ * @param claim Mark the mode as being initialized by the caller.
+ *
+ * Wait until the mode is no longer initialized by another thread.
+ */
+static void mode_init_wait(Mode *mode, gboolean claim) {
+  g_mutex_lock(&mode_init_lock);
+  while (g_slist_find(mode_init_busy, mode) != NULL) {
+    g_cond_wait(&mode_init_cond, &mode_init_lock);
+  }
+  if (claim) {
+    mode_init_busy = g_slist_prepend(mode_init_busy, mode);
+  }
+  g_mutex_unlock(&mode_init_lock);
+}
+
+/**
+ * @param mode The mode to initialize.
+ * @param claimed The caller already claimed the mode with mode_init_claim().
+ *
+ * Initialize the mode, waiting for another thread initializing it.
+ *
+ * @returns FALSE if there was a failure, TRUE if successful
+ */
+static int mode_init_run(Mode *mode, gboolean claimed) {
   g_return_val_if_fail(mode != NULL, FALSE);
   g_return_val_if_fail(mode->_init != NULL, FALSE);
   if (mode->type == MODE_TYPE_UNSET) {
@@ -56,20 +88,51 @@ int mode_init(Mode *mode) {
     }
   }
   // to make sure this is initialized correctly.
+  // Modes can be initialized from worker threads, never run _init twice
+  // concurrently.
+  if (!claimed) {
+    mode_init_wait(mode, TRUE);
+  }
   mode->fallback_icon_fetch_uid = 0;
   mode->fallback_icon_not_found = FALSE;
-  return mode->_init(mode);
+  int retv = mode->_init(mode);
+  g_mutex_lock(&mode_init_lock);
+  mode_init_busy = g_slist_remove(mode_init_busy, mode);
+  g_cond_broadcast(&mode_init_cond);
+  g_mutex_unlock(&mode_init_lock);
+  return retv;
+}
+
+int mode_init(Mode *mode) { return mode_init_run(mode, FALSE); }
+
+void mode_init_claim(Mode *mode) {
+  g_return_if_fail(mode != NULL);
+  mode_init_wait(mode, TRUE);
+}
+
+int mode_init_claimed(Mode *mode) { return mode_init_run(mode, TRUE); }
+
+gboolean mode_init_pending(const Mode *mode) {
+  g_mutex_lock(&mode_init_lock);
+  gboolean pending = g_slist_find(mode_init_busy, mode) != NULL;
+  g_mutex_unlock(&mode_init_lock);
+  return pending;
 }
 
 void mode_destroy(Mode *mode) {
   g_assert(mode != NULL);
   g_assert(mode->_destroy != NULL);
+  mode_init_wait(mode, FALSE);
   mode->_destroy(mode);
 }
 
 unsigned int mode_get_num_entries(const Mode *mode) {
   g_assert(mode != NULL);
   g_assert(mode->_get_num_entries != NULL);
+  // Entries show up on the reload after initializing finishes.
+  if (mode_init_pending(mode)) {
+    return 0;
+  }
   return mode->_get_num_entries(mode);
 }
 
@@ -144,6 +207,8 @@ ModeMode mode_result(Mode *mode, int menu_retv, char **input,
   g_assert(mode->_result != NULL);
   g_assert(input != NULL);
 
+  // The user can select before the entries are loaded.
+  mode_init_wait(mode, FALSE);
   return mode->_result(mode, menu_retv, input, selected_line);
 }
 
@@ -205,13 +270,13 @@ void mode_set_config(Mode *mode) {
 }
 
 char *mode_preprocess_input(Mode *mode, const char *input) {
-  if (mode->_preprocess_input) {
+  if (mode->_preprocess_input && !mode_init_pending(mode)) {
     return mode->_preprocess_input(mode, input);
   }
   return g_strdup(input);
 }
 char *mode_get_message(const Mode *mode) {
-  if (mode->_get_message) {
+  if (mode->_get_message && !mode_init_pending(mode)) {
     return mode->_get_message(mode);
   }
   return NULL;
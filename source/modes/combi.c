@@ -35,6 +35,7 @@
 #include <stdlib.h>
 
 #include "mode-private.h"
+#include "view.h"
 #include "widgets/textbox.h"
 #include <modes/modes.h>
 #include <pango/pango.h>
@@ -46,6 +47,15 @@
 typedef struct {
   Mode *mode;
   gboolean disable;
+  // Colour of the mode prefix, looked up once on init.
+  gboolean has_color;
+  guint16 color[3];
+  // Thread initializing the mode, NULL when initialized on the main thread.
+  GThread *init_thread;
+  // The mode finished initializing (atomic).
+  gint ready;
+  // The mode failed to initialize (atomic), its entries are not shown.
+  gint failed;
 } CombiMode;
 
 typedef struct {
@@ -57,8 +67,18 @@ typedef struct {
   // List of switchers to combine.
   unsigned int num_switchers;
   CombiMode *switchers;
+  // Guards ready_idle.
+  GMutex lock;
+  // Pending reload after a mode finished initializing.
+  guint ready_idle;
 } CombiModePrivateData;
 
+/** A sub-mode initialized on a worker thread. */
+typedef struct {
+  CombiModePrivateData *pd;
+  unsigned int index;
+} CombiInitJob;
+
 static void combi_mode_parse_switchers(Mode *sw) {
   CombiModePrivateData *pd = mode_get_private_data(sw);
   char *savept = NULL;
@@ -97,12 +117,102 @@ static void combi_mode_parse_switchers(Mode *sw) {
   // Free string that was modified by strtok_r
   g_free(switcher_str);
 }
+/**
+ * @param pd The combi private data.
+ * @param index The index in the combined list.
+ *
+ * Binary search for the switcher that owns index, the ranges in starts and
+ * lengths are sorted and do not overlap.
+ *
+ * @returns the switcher index, or -1 when out of range.
+ */
+static int combi_mode_find(const CombiModePrivateData *pd,
+                           unsigned int index) {
+  unsigned int lo = 0, hi = pd->num_switchers;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if ((pd->starts[mid] + pd->lengths[mid]) <= index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < pd->num_switchers && pd->starts[lo] <= index) {
+    return (int)lo;
+  }
+  return -1;
+}
+
+static void combi_mode_lookup_colors(Mode *sw) {
+  CombiModePrivateData *pd = mode_get_private_data(sw);
+  ThemeWidget *wid = rofi_config_find_widget(sw->name, NULL, TRUE);
+  for (unsigned int i = 0; i < pd->num_switchers; i++) {
+    Property *p = rofi_theme_find_property(wid, P_COLOR,
+                                           pd->switchers[i].mode->name, TRUE);
+    pd->switchers[i].has_color = (p != NULL);
+    if (p != NULL) {
+      pd->switchers[i].color[0] = p->value.color.red * 65535;
+      pd->switchers[i].color[1] = p->value.color.green * 65535;
+      pd->switchers[i].color[2] = p->value.color.blue * 65535;
+    }
+  }
+}
+
+static gboolean combi_mode_ready_idle(gpointer data) {
+  CombiModePrivateData *pd = (CombiModePrivateData *)data;
+  g_mutex_lock(&(pd->lock));
+  pd->ready_idle = 0;
+  g_mutex_unlock(&(pd->lock));
+  // Picks up the entries of the modes that became ready.
+  rofi_view_reload();
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer combi_mode_init_thread(gpointer data) {
+  CombiInitJob *job = (CombiInitJob *)data;
+  CombiModePrivateData *pd = job->pd;
+  CombiMode *cm = &(pd->switchers[job->index]);
+  if (!mode_init(cm->mode)) {
+    g_warning("Failed to initialize mode: %s", mode_get_name(cm->mode));
+    g_atomic_int_set(&(cm->failed), TRUE);
+  }
+  g_atomic_int_set(&(cm->ready), TRUE);
+  g_mutex_lock(&(pd->lock));
+  if (pd->ready_idle == 0) {
+    pd->ready_idle = g_idle_add(combi_mode_ready_idle, pd);
+  }
+  g_mutex_unlock(&(pd->lock));
+  g_free(job);
+  return NULL;
+}
+
+/**
+ * @param pd The combi private data.
+ * @param i The switcher to wait for.
+ *
+ * Wait until switcher i is initialized.
+ *
+ * @returns TRUE when it can be used.
+ */
+static gboolean combi_mode_wait(CombiModePrivateData *pd, unsigned int i) {
+  if (pd->switchers[i].init_thread != NULL) {
+    g_thread_join(pd->switchers[i].init_thread);
+    pd->switchers[i].init_thread = NULL;
+  }
+  return !g_atomic_int_get(&(pd->switchers[i].failed));
+}
+
 static unsigned int combi_mode_get_num_entries(const Mode *sw) {
   const CombiModePrivateData *pd =
       (const CombiModePrivateData *)mode_get_private_data(sw);
   unsigned int length = 0;
   for (unsigned int i = 0; i < pd->num_switchers; i++) {
-    unsigned int entries = mode_get_num_entries(pd->switchers[i].mode);
+    // Modes still loading on a worker thread show up when ready.
+    unsigned int entries = 0;
+    if (g_atomic_int_get(&(pd->switchers[i].ready)) &&
+        !g_atomic_int_get(&(pd->switchers[i].failed))) {
+      entries = mode_get_num_entries(pd->switchers[i].mode);
+    }
     pd->starts[i] = length;
     pd->lengths[i] = entries;
     length += entries;
@@ -114,13 +224,34 @@ static int combi_mode_init(Mode *sw) {
   if (mode_get_private_data(sw) == NULL) {
     CombiModePrivateData *pd = g_malloc0(sizeof(*pd));
     mode_set_private_data(sw, (void *)pd);
+    g_mutex_init(&(pd->lock));
     combi_mode_parse_switchers(sw);
+    combi_mode_lookup_colors(sw);
     pd->starts = g_malloc0(sizeof(int) * pd->num_switchers);
     pd->lengths = g_malloc0(sizeof(int) * pd->num_switchers);
+    // Modes that can, load concurrently and their entries are added as they
+    // become ready. The others are initialized here, in order.
+    for (unsigned int i = 0; i < pd->num_switchers; i++) {
+      Mode *mode = pd->switchers[i].mode;
+      pd->switchers[i].init_thread = NULL;
+      pd->switchers[i].ready = FALSE;
+      pd->switchers[i].failed = FALSE;
+      if ((mode->type & MODE_TYPE_THREADED_INIT) == MODE_TYPE_THREADED_INIT) {
+        CombiInitJob *job = g_malloc0(sizeof(*job));
+        job->pd = pd;
+        job->index = i;
+        pd->switchers[i].init_thread =
+            g_thread_new("combi init", combi_mode_init_thread, job);
+      }
+    }
     for (unsigned int i = 0; i < pd->num_switchers; i++) {
+      if (pd->switchers[i].init_thread != NULL) {
+        continue;
+      }
       if (!mode_init(pd->switchers[i].mode)) {
         return FALSE;
       }
+      pd->switchers[i].ready = TRUE;
     }
     if (pd->cmd_list_length == 0) {
       pd->cmd_list_length = combi_mode_get_num_entries(sw);
@@ -131,6 +262,15 @@ static int combi_mode_init(Mode *sw) {
 static void combi_mode_destroy(Mode *sw) {
   CombiModePrivateData *pd = (CombiModePrivateData *)mode_get_private_data(sw);
   if (pd != NULL) {
+    for (unsigned int i = 0; i < pd->num_switchers; i++) {
+      combi_mode_wait(pd, i);
+    }
+    // No thread is left to schedule a reload.
+    if (pd->ready_idle > 0) {
+      g_source_remove(pd->ready_idle);
+      pd->ready_idle = 0;
+    }
+    g_mutex_clear(&(pd->lock));
     g_free(pd->starts);
     g_free(pd->lengths);
     // Cleanup switchers.
@@ -165,6 +305,9 @@ static ModeMode combi_mode_result(Mode *sw, int mretv, char **input,
         }
       }
     }
+    if (switcher >= 0 && !combi_mode_wait(pd, switcher)) {
+      return MODE_EXIT;
+    }
     if (switcher >= 0) {
       if (eob[0] == ' ') {
         char *n = g_strdup(eob + 1);
@@ -185,14 +328,13 @@ static ModeMode combi_mode_result(Mode *sw, int mretv, char **input,
     return RELOAD_DIALOG;
   }
 
-  for (unsigned i = 0; i < pd->num_switchers; i++) {
-    if (selected_line >= pd->starts[i] &&
-        selected_line < (pd->starts[i] + pd->lengths[i])) {
-      return mode_result(pd->switchers[i].mode, mretv, input,
-                         selected_line - pd->starts[i]);
-    }
+  int i = combi_mode_find(pd, selected_line);
+  if (i >= 0) {
+    return mode_result(pd->switchers[i].mode, mretv, input,
+                       selected_line - pd->starts[i]);
   }
-  if ((mretv & MENU_CUSTOM_INPUT)) {
+  if ((mretv & MENU_CUSTOM_INPUT) && pd->num_switchers > 0 &&
+      combi_mode_wait(pd, 0)) {
     return mode_result(pd->switchers[0].mode, mretv, input, selected_line);
   }
   return MODE_EXIT;
@@ -200,85 +342,66 @@ static ModeMode combi_mode_result(Mode *sw, int mretv, char **input,
 static int combi_mode_match(const Mode *sw, rofi_int_matcher **tokens,
                             unsigned int index) {
   CombiModePrivateData *pd = mode_get_private_data(sw);
-  for (unsigned i = 0; i < pd->num_switchers; i++) {
-    if (pd->switchers[i].disable) {
-      continue;
-    }
-    if (index >= pd->starts[i] && index < (pd->starts[i] + pd->lengths[i])) {
-      return mode_token_match(pd->switchers[i].mode, tokens,
-                              index - pd->starts[i]);
-    }
+  int i = combi_mode_find(pd, index);
+  if (i < 0 || pd->switchers[i].disable) {
+    return 0;
   }
-  return 0;
+  return mode_token_match(pd->switchers[i].mode, tokens,
+                          index - pd->starts[i]);
 }
 static char *combi_mgrv(const Mode *sw, unsigned int selected_line, int *state,
                         GList **attr_list, int get_entry) {
   CombiModePrivateData *pd = mode_get_private_data(sw);
+  int i = combi_mode_find(pd, selected_line);
+  if (i < 0) {
+    return NULL;
+  }
   if (!get_entry) {
-    for (unsigned i = 0; i < pd->num_switchers; i++) {
-      if (selected_line >= pd->starts[i] &&
-          selected_line < (pd->starts[i] + pd->lengths[i])) {
-        mode_get_display_value(pd->switchers[i].mode,
-                               selected_line - pd->starts[i], state, attr_list,
-                               FALSE);
-        return NULL;
-      }
-    }
+    mode_get_display_value(pd->switchers[i].mode,
+                           selected_line - pd->starts[i], state, attr_list,
+                           FALSE);
     return NULL;
   }
-  for (unsigned i = 0; i < pd->num_switchers; i++) {
-    if (selected_line >= pd->starts[i] &&
-        selected_line < (pd->starts[i] + pd->lengths[i])) {
-      char *retv;
-      char *str = retv = mode_get_display_value(pd->switchers[i].mode,
-                                                selected_line - pd->starts[i],
-                                                state, attr_list, TRUE);
-      const char *dname = mode_get_display_name(pd->switchers[i].mode);
+  char *retv;
+  char *str = retv = mode_get_display_value(pd->switchers[i].mode,
+                                            selected_line - pd->starts[i],
+                                            state, attr_list, TRUE);
+  const char *dname = mode_get_display_name(pd->switchers[i].mode);
 
-      if (!config.combi_hide_mode_prefix) {
-        if (!(*state & MARKUP)) {
-          char *tmp = str;
-          str = g_markup_escape_text(tmp, -1);
-          g_free(tmp);
-          *state |= MARKUP;
-        }
+  if (!config.combi_hide_mode_prefix) {
+    if (!(*state & MARKUP)) {
+      char *tmp = str;
+      str = g_markup_escape_text(tmp, -1);
+      g_free(tmp);
+      *state |= MARKUP;
+    }
 
-        retv = helper_string_replace_if_exists(config.combi_display_format,
-                                               "{mode}", dname, "{text}", str,
-                                               (char *)0);
-        g_free(str);
+    retv = helper_string_replace_if_exists(config.combi_display_format,
+                                           "{mode}", dname, "{text}", str,
+                                           (char *)0);
+    g_free(str);
 
-        if (attr_list != NULL) {
-          ThemeWidget *wid = rofi_config_find_widget(sw->name, NULL, TRUE);
-          Property *p = rofi_theme_find_property(
-              wid, P_COLOR, pd->switchers[i].mode->name, TRUE);
-          if (p != NULL) {
-            PangoAttribute *pa = pango_attr_foreground_new(
-                p->value.color.red * 65535, p->value.color.green * 65535,
-                p->value.color.blue * 65535);
-            pa->start_index = PANGO_ATTR_INDEX_FROM_TEXT_BEGINNING;
-            pa->end_index = strlen(dname);
-            *attr_list = g_list_append(*attr_list, pa);
-          }
-        }
-      }
-      return retv;
+    if (attr_list != NULL && pd->switchers[i].has_color) {
+      PangoAttribute *pa = pango_attr_foreground_new(
+          pd->switchers[i].color[0], pd->switchers[i].color[1],
+          pd->switchers[i].color[2]);
+      pa->start_index = PANGO_ATTR_INDEX_FROM_TEXT_BEGINNING;
+      pa->end_index = strlen(dname);
+      *attr_list = g_list_append(*attr_list, pa);
     }
   }
-
-  return NULL;
+  return retv;
 }
 static char *combi_get_completion(const Mode *sw, unsigned int index) {
   CombiModePrivateData *pd = mode_get_private_data(sw);
-  for (unsigned i = 0; i < pd->num_switchers; i++) {
-    if (index >= pd->starts[i] && index < (pd->starts[i] + pd->lengths[i])) {
-      char *comp =
-          mode_get_completion(pd->switchers[i].mode, index - pd->starts[i]);
-      char *mcomp =
-          g_strdup_printf("!%s %s", mode_get_name(pd->switchers[i].mode), comp);
-      g_free(comp);
-      return mcomp;
-    }
+  int i = combi_mode_find(pd, index);
+  if (i >= 0) {
+    char *comp =
+        mode_get_completion(pd->switchers[i].mode, index - pd->starts[i]);
+    char *mcomp =
+        g_strdup_printf("!%s %s", mode_get_name(pd->switchers[i].mode), comp);
+    g_free(comp);
+    return mcomp;
   }
   // Should never get here.
   g_assert_not_reached();
@@ -288,14 +411,11 @@ static char *combi_get_completion(const Mode *sw, unsigned int index) {
 static cairo_surface_t *combi_get_icon(const Mode *sw, unsigned int index,
                                        unsigned int height) {
   CombiModePrivateData *pd = mode_get_private_data(sw);
-  for (unsigned i = 0; i < pd->num_switchers; i++) {
-    if (index >= pd->starts[i] && index < (pd->starts[i] + pd->lengths[i])) {
-      cairo_surface_t *icon =
-          mode_get_icon(pd->switchers[i].mode, index - pd->starts[i], height);
-      return icon;
-    }
+  int i = combi_mode_find(pd, index);
+  if (i < 0) {
+    return NULL;
   }
-  return NULL;
+  return mode_get_icon(pd->switchers[i].mode, index - pd->starts[i], height);
 }
 
 static char *combi_preprocess_input(Mode *sw, const char *input) {
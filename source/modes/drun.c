@@ -1081,6 +1081,7 @@ static void get_apps(DRunModePrivateData *pd) {
 
     write_cache(pd, cache_file);
   }
+  TIMINGS_COUNTER("drun entries loaded", pd->cmd_list_length);
   g_free(cache_file);
 }
 
@@ -1527,6 +1528,6 @@ Mode drun_mode = {.name = "drun",
                   ._preprocess_input = NULL,
                   .private_data = NULL,
                   .free = NULL,
-                  .type = MODE_TYPE_SWITCHER};
+                  .type = MODE_TYPE_SWITCHER | MODE_TYPE_THREADED_INIT};
 
 #endif // ENABLE_DRUN
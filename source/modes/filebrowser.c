@@ -33,9 +33,14 @@
 #include <unistd.h>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <glib-unix.h>
 #include <glib/gstdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 #include "display.h"
 #include "helper.h"
@@ -60,6 +65,19 @@
 #define st_mtim st_mtimespec
 #endif
 
+/** Read directories with getdents64 and large buffers. */
+#if defined(__linux__) && defined(SYS_getdents64)
+#define FB_USE_GETDENTS64
+#endif
+/** Size of the buffer passed to getdents64. */
+#define FB_GETDENTS_BUFFER_SIZE (256 * 1024)
+/** Size of the first block of files sent to the UI, it doubles up to the
+ * maximum. */
+#define FB_BLOCK_SIZE_MIN 256
+#define FB_BLOCK_SIZE_MAX 65536
+/** Time (us) to wait for the listing before showing the window. */
+#define FB_SYNC_LOAD_TIME 50000
+
 /**
  * The internal data structure holding the private data of the TEST Mode.
  */
@@ -100,12 +118,32 @@ typedef struct {
   time_t time;
 } FBFile;
 
+/**
+ * Sorted files read by the listing thread.
+ */
+typedef struct {
+  FBFile *files;
+  unsigned int length;
+  unsigned int size;
+  /** Last block of the listing. */
+  gboolean last;
+} FBBlock;
+
 typedef struct {
   char *command;
   GFile *current_dir;
   FBFile *array;
   unsigned int array_length;
   unsigned int array_length_real;
+
+  /** The directory being listed. */
+  char *listing_dir;
+  GThread *reading_thread;
+  GAsyncQueue *async_queue;
+  guint wake_source;
+  gint end_thread;
+  gboolean loading;
+  int pipefd2[2];
 } FileBrowserModePrivateData;
 
 /**
@@ -191,44 +229,318 @@ static gint compare(gconstpointer a, gconstpointer b, gpointer data) {
   return comparator(a, b, data);
 }
 
-static time_t get_time(const GStatBuf *statbuf) {
-  switch (file_browser_config.sorting_time) {
-  case FB_MTIME:
-    return statbuf->st_mtim.tv_sec;
-  case FB_ATIME:
-    return statbuf->st_atim.tv_sec;
-  case FB_CTIME:
-    return statbuf->st_ctim.tv_sec;
-  default:
-    return 0;
+static void fb_block_free(FBBlock *block) {
+  for (unsigned int i = 0; i < block->length; i++) {
+    g_free(block->files[i].name);
+    g_free(block->files[i].path);
   }
+  g_free(block->files);
+  g_free(block);
 }
 
-static void set_time(FBFile *file) {
-  // GError *error = NULL;
-  //  gchar *path = g_filename_from_utf8(file->path, -1, NULL, NULL, &error);
-  //  if (error) {
-  //    g_warning("Failed to convert filename: %s: %s", file->path,
-  //    error->message); g_error_free(error); return;
-  //  }
+static FBBlock *fb_block_new(unsigned int size) {
+  FBBlock *block = g_malloc0(sizeof(FBBlock));
+  block->size = size;
+  block->files = g_malloc(size * sizeof(FBFile));
+  return block;
+}
 
+/**
+ * @param dfd The directory.
+ * @param name The file in the directory.
+ * @param follow Follow a symbolic link.
+ * @param mode Set to the file mode, if want_type is set.
+ * @param time Set to the time to sort on, if sorting on time.
+ * @param want_type If the file type is needed.
+ *
+ * Stat a file, only asking for the fields needed.
+ *
+ * @returns TRUE when successful.
+ */
+static gboolean fb_stat(int dfd, const char *name, gboolean follow,
+                        gboolean want_type, mode_t *mode, time_t *time) {
+  gboolean want_time = file_browser_config.sorting_method == FB_SORT_TIME;
+#if defined(STATX_TYPE)
+  unsigned int mask = want_type ? STATX_TYPE : 0;
+  if (want_time) {
+    switch (file_browser_config.sorting_time) {
+    case FB_MTIME:
+      mask |= STATX_MTIME;
+      break;
+    case FB_ATIME:
+      mask |= STATX_ATIME;
+      break;
+    case FB_CTIME:
+      mask |= STATX_CTIME;
+      break;
+    default:
+      break;
+    }
+  }
+  struct statx stx;
+  if (statx(dfd, name, follow ? 0 : AT_SYMLINK_NOFOLLOW, mask, &stx) != 0) {
+    return FALSE;
+  }
+  *mode = stx.stx_mode;
+  if (want_time) {
+    switch (file_browser_config.sorting_time) {
+    case FB_MTIME:
+      *time = stx.stx_mtime.tv_sec;
+      break;
+    case FB_ATIME:
+      *time = stx.stx_atime.tv_sec;
+      break;
+    case FB_CTIME:
+      *time = stx.stx_ctime.tv_sec;
+      break;
+    default:
+      *time = 0;
+      break;
+    }
+  }
+#else
+  (void)want_type;
   GStatBuf statbuf;
+  if (fstatat(dfd, name, &statbuf, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0) {
+    return FALSE;
+  }
+  *mode = statbuf.st_mode;
+  if (want_time) {
+    switch (file_browser_config.sorting_time) {
+    case FB_MTIME:
+      *time = statbuf.st_mtim.tv_sec;
+      break;
+    case FB_ATIME:
+      *time = statbuf.st_atim.tv_sec;
+      break;
+    case FB_CTIME:
+      *time = statbuf.st_ctim.tv_sec;
+      break;
+    default:
+      *time = 0;
+      break;
+    }
+  }
+#endif
+  return TRUE;
+}
+
+static void fb_wake(FileBrowserModePrivateData *pd, char command) {
+  if (write(pd->pipefd2[1], &command, 1) != 1) {
+    g_warning("Failed to wake up the main loop: %s", g_strerror(errno));
+  }
+}
+
+/**
+ * @param pd The private data.
+ * @param block The block to send, replaced by a new one.
+ *
+ * Sort the block and hand it to the UI thread.
+ */
+static void fb_block_push(FileBrowserModePrivateData *pd, FBBlock **block) {
+  FBBlock *b = *block;
+  g_qsort_with_data(b->files, b->length, sizeof(FBFile), compare, NULL);
+  g_async_queue_push(pd->async_queue, b);
+  fb_wake(pd, 'r');
+  // Grow the blocks, so merging them stays cheap on large directories.
+  *block = fb_block_new(MIN(b->size * 2, FB_BLOCK_SIZE_MAX));
+}
 
-  if (g_lstat(file->path, &statbuf) == 0) {
-    file->time = get_time(&statbuf);
+/**
+ * @param pd The private data.
+ * @param dfd The directory.
+ * @param name The name of the entry.
+ * @param d_type The type of the entry, from the directory.
+ * @param block The block to add to.
+ *
+ * Add a directory entry to the listing.
+ */
+static void fb_add_entry(FileBrowserModePrivateData *pd, int dfd,
+                         const char *name, unsigned char d_type,
+                         FBBlock **block) {
+  if (g_strcmp0(name, ".") == 0) {
+    return;
+  }
+  if (name[0] == '.' && g_strcmp0(name, "..") != 0 &&
+      file_browser_config.show_hidden == FALSE) {
+    return;
+  }
+  if (d_type != DT_REG && d_type != DT_DIR && d_type != DT_LNK) {
+    return;
+  }
+  FBFile *f = &((*block)->files[(*block)->length]);
+  f->icon_fetch_uid = 0;
+  f->icon_fetch_size = 0;
+  f->icon_fetch_scale = 0;
+  f->link = FALSE;
+  f->time = -1;
+  if (g_strcmp0(name, "..") == 0) {
+    f->name = g_strdup("..");
+    f->path = NULL;
+    f->type = UP;
   } else {
-    g_warning("Failed to stat file: %s, %s", file->path, strerror(errno));
+    // Rofi expects utf-8, so lets convert the filename.
+    f->name = g_filename_to_utf8(name, -1, NULL, NULL, NULL);
+    if (f->name == NULL) {
+      f->name = rofi_force_utf8(name, -1);
+    }
+    f->path = g_build_filename(pd->listing_dir, name, NULL);
+    // Default to file.
+    f->type = (d_type == DT_DIR) ? DIRECTORY : RFILE;
+    f->link = (d_type == DT_LNK);
+    mode_t mode = 0;
+    // Only stat links, to find out what they point to, or when the time is
+    // needed for sorting.
+    if (f->link || file_browser_config.sorting_method == FB_SORT_TIME) {
+      // If we fail on a link, we mark it as file.
+      // TODO have a 'broken link' mode?
+      if (fb_stat(dfd, name, f->link, f->link, &mode, &(f->time))) {
+        if (f->link && S_ISDIR(mode)) {
+          f->type = DIRECTORY;
+        }
+      } else {
+        g_warning("Failed to stat file: %s, %s", f->path, strerror(errno));
+      }
+    }
+  }
+  (*block)->length++;
+  if ((*block)->length == (*block)->size) {
+    fb_block_push(pd, block);
   }
+}
+
+/**
+ * List the directory on a thread, sending the files in blocks to the UI.
+ */
+static gpointer file_browser_list_thread(gpointer userdata) {
+  FileBrowserModePrivateData *pd = (FileBrowserModePrivateData *)userdata;
+  FBBlock *block = fb_block_new(FB_BLOCK_SIZE_MIN);
+  int dfd = open(pd->listing_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dfd >= 0) {
+#ifdef FB_USE_GETDENTS64
+    struct fb_dirent64 {
+      uint64_t d_ino;
+      int64_t d_off;
+      unsigned short d_reclen;
+      unsigned char d_type;
+      char d_name[];
+    };
+    char *buffer = g_malloc(FB_GETDENTS_BUFFER_SIZE);
+    long n = 0;
+    while (!g_atomic_int_get(&(pd->end_thread)) &&
+           (n = syscall(SYS_getdents64, dfd, buffer,
+                        FB_GETDENTS_BUFFER_SIZE)) > 0) {
+      for (long offset = 0; offset < n;) {
+        struct fb_dirent64 *d = (struct fb_dirent64 *)(buffer + offset);
+        offset += d->d_reclen;
+        fb_add_entry(pd, dfd, d->d_name, d->d_type, &block);
+      }
+    }
+    g_free(buffer);
+    close(dfd);
+#else
+    DIR *dir = fdopendir(dfd);
+    if (dir) {
+      struct dirent *rd = NULL;
+      while (!g_atomic_int_get(&(pd->end_thread)) &&
+             (rd = readdir(dir)) != NULL) {
+        fb_add_entry(pd, dfd, rd->d_name, rd->d_type, &block);
+      }
+      closedir(dir);
+    } else {
+      close(dfd);
+    }
+#endif
+  }
+  block->last = TRUE;
+  g_qsort_with_data(block->files, block->length, sizeof(FBFile), compare,
+                    NULL);
+  g_async_queue_push(pd->async_queue, block);
+  fb_wake(pd, 'r');
+  return NULL;
+}
+
+/**
+ * @param pd The private data.
+ * @param block The sorted block.
+ *
+ * Merge a block into the sorted list.
+ */
+static void file_browser_take_block(FileBrowserModePrivateData *pd,
+                                    FBBlock *block) {
+  if (block->last) {
+    pd->loading = FALSE;
+  }
+  if (block->length > 0) {
+    unsigned int length = pd->array_length + block->length;
+    FBFile *array = g_malloc((length + 1) * sizeof(FBFile));
+    unsigned int i = 0, j = 0, k = 0;
+    while (i < pd->array_length && j < block->length) {
+      if (compare(&(pd->array[i]), &(block->files[j]), NULL) <= 0) {
+        array[k++] = pd->array[i++];
+      } else {
+        array[k++] = block->files[j++];
+      }
+    }
+    while (i < pd->array_length) {
+      array[k++] = pd->array[i++];
+    }
+    while (j < block->length) {
+      array[k++] = block->files[j++];
+    }
+    g_free(pd->array);
+    pd->array = array;
+    pd->array_length = length;
+    pd->array_length_real = length;
+    // The files are owned by the list now.
+    block->length = 0;
+  }
+  fb_block_free(block);
+}
 
-  //  g_free(path);
+static gboolean file_browser_async_read_proc(gint fd, GIOCondition condition,
+                                             gpointer user_data) {
+  FileBrowserModePrivateData *pd = (FileBrowserModePrivateData *)user_data;
+  char command;
+  // Only interrested in read events.
+  if ((condition & G_IO_IN) != G_IO_IN) {
+    return G_SOURCE_CONTINUE;
+  }
+  // Read the entry from the pipe that was used to signal this action.
+  if (read(fd, &command, 1) == 1 && command == 'r') {
+    FBBlock *block = NULL;
+    gboolean changed = FALSE;
+    // Empty out the AsyncQueue (that is thread safe) from all blocks pushed
+    // into it.
+    while ((block = g_async_queue_try_pop(pd->async_queue)) != NULL) {
+      file_browser_take_block(pd, block);
+      changed = TRUE;
+    }
+    if (changed) {
+      rofi_view_reload();
+    }
+  }
+  return G_SOURCE_CONTINUE;
 }
 
-inline static void fb_resize_array(FileBrowserModePrivateData *pd) {
-  if ((pd->array_length + 1) > pd->array_length_real) {
-    pd->array_length_real += 256;
-    pd->array =
-        g_realloc(pd->array, (pd->array_length_real + 1) * sizeof(FBFile));
+/**
+ * Stop a running listing and drop its results.
+ */
+static void file_browser_stop_listing(FileBrowserModePrivateData *pd) {
+  if (pd->reading_thread) {
+    g_atomic_int_set(&(pd->end_thread), TRUE);
+    g_thread_join(pd->reading_thread);
+    pd->reading_thread = NULL;
+  }
+  if (pd->async_queue) {
+    FBBlock *block = NULL;
+    while ((block = g_async_queue_try_pop(pd->async_queue)) != NULL) {
+      fb_block_free(block);
+    }
   }
+  g_free(pd->listing_dir);
+  pd->listing_dir = NULL;
+  pd->loading = FALSE;
 }
 
 static void get_file_browser(Mode *sw) {
@@ -238,117 +550,33 @@ static void get_file_browser(Mode *sw) {
    * Get the entries to display.
    * this gets called on plugin initialization.
    */
-  char *cdir = g_file_get_path(pd->current_dir);
-  DIR *dir = opendir(cdir);
-  if (dir) {
-    struct dirent *rd = NULL;
-    while ((rd = readdir(dir)) != NULL) {
-      if (g_strcmp0(rd->d_name, "..") == 0) {
-        fb_resize_array(pd);
-        // Rofi expects utf-8, so lets convert the filename.
-        pd->array[pd->array_length].name = g_strdup("..");
-        pd->array[pd->array_length].path = NULL;
-        pd->array[pd->array_length].type = UP;
-        pd->array[pd->array_length].icon_fetch_uid = 0;
-        pd->array[pd->array_length].icon_fetch_size = 0;
-        pd->array[pd->array_length].icon_fetch_scale = 0;
-        pd->array[pd->array_length].link = FALSE;
-        pd->array[pd->array_length].time = -1;
-        pd->array_length++;
-        continue;
-      }
-      if (g_strcmp0(rd->d_name, ".") == 0) {
-        continue;
-      }
-      if (rd->d_name[0] == '.' && file_browser_config.show_hidden == FALSE) {
-        continue;
-      }
-
-      switch (rd->d_type) {
-      case DT_BLK:
-      case DT_CHR:
-      case DT_FIFO:
-      case DT_UNKNOWN:
-      case DT_SOCK:
-      default:
-        break;
-      case DT_REG:
-      case DT_DIR:
-        fb_resize_array(pd);
-        // Rofi expects utf-8, so lets convert the filename.
-        pd->array[pd->array_length].name =
-            g_filename_to_utf8(rd->d_name, -1, NULL, NULL, NULL);
-        if (pd->array[pd->array_length].name == NULL) {
-          pd->array[pd->array_length].name = rofi_force_utf8(rd->d_name, -1);
-        }
-        pd->array[pd->array_length].path =
-            g_build_filename(cdir, rd->d_name, NULL);
-        pd->array[pd->array_length].type =
-            (rd->d_type == DT_DIR) ? DIRECTORY : RFILE;
-        pd->array[pd->array_length].icon_fetch_uid = 0;
-        pd->array[pd->array_length].icon_fetch_size = 0;
-        pd->array[pd->array_length].icon_fetch_scale = 0;
-        pd->array[pd->array_length].link = FALSE;
-
-        if (file_browser_config.sorting_method == FB_SORT_TIME) {
-          set_time(&pd->array[pd->array_length]);
-        }
-
-        pd->array_length++;
-        break;
-      case DT_LNK:
-        fb_resize_array(pd);
-        // Rofi expects utf-8, so lets convert the filename.
-        pd->array[pd->array_length].name =
-            g_filename_to_utf8(rd->d_name, -1, NULL, NULL, NULL);
-        if (pd->array[pd->array_length].name == NULL) {
-          pd->array[pd->array_length].name = rofi_force_utf8(rd->d_name, -1);
-        }
-        pd->array[pd->array_length].path =
-            g_build_filename(cdir, rd->d_name, NULL);
-        pd->array[pd->array_length].icon_fetch_uid = 0;
-        pd->array[pd->array_length].icon_fetch_size = 0;
-        pd->array[pd->array_length].icon_fetch_scale = 0;
-        pd->array[pd->array_length].link = TRUE;
-        // Default to file.
-        pd->array[pd->array_length].type = RFILE;
-        {
-          // If we have link, use a stat to fine out what it is, if we fail, we
-          // mark it as file.
-          // TODO have a 'broken link' mode?
-          // Convert full path to right encoding.
-          // DD: Path should be in file encoding, not utf-8
-          //          char *file =
-          //          g_filename_from_utf8(pd->array[pd->array_length].path,
-          //                                            -1, NULL, NULL, NULL);
-          if (pd->array[pd->array_length].path) {
-            GStatBuf statbuf;
-            if (g_stat(pd->array[pd->array_length].path, &statbuf) == 0) {
-              if (S_ISDIR(statbuf.st_mode)) {
-                pd->array[pd->array_length].type = DIRECTORY;
-              } else if (S_ISREG(statbuf.st_mode)) {
-                pd->array[pd->array_length].type = RFILE;
-              }
-
-              if (file_browser_config.sorting_method == FB_SORT_TIME) {
-                pd->array[pd->array_length].time = get_time(&statbuf);
-              }
-            } else {
-              g_warning("Failed to stat file: %s, %s",
-                        pd->array[pd->array_length].path, strerror(errno));
-            }
-
-            //            g_free(file);
-          }
-        }
-        pd->array_length++;
-        break;
-      }
+  file_browser_stop_listing(pd);
+  if (pd->async_queue == NULL) {
+    if (pipe(pd->pipefd2) == -1) {
+      g_error("Failed to create pipe");
     }
-    closedir(dir);
+    pd->wake_source = g_unix_fd_add(pd->pipefd2[0], G_IO_IN,
+                                    file_browser_async_read_proc, pd);
+    // Create the message passing queue to the UI thread.
+    pd->async_queue = g_async_queue_new();
+  }
+  pd->listing_dir = g_file_get_path(pd->current_dir);
+  g_atomic_int_set(&(pd->end_thread), FALSE);
+  pd->loading = TRUE;
+  pd->reading_thread =
+      g_thread_new("filebrowser-read", file_browser_list_thread, pd);
+
+  // Show small directories complete, large ones stream in.
+  gint64 deadline = g_get_monotonic_time() + FB_SYNC_LOAD_TIME;
+  while (pd->loading) {
+    gint64 left = deadline - g_get_monotonic_time();
+    FBBlock *block =
+        left > 0 ? g_async_queue_timeout_pop(pd->async_queue, left) : NULL;
+    if (block == NULL) {
+      break;
+    }
+    file_browser_take_block(pd, block);
   }
-  g_free(cdir);
-  g_qsort_with_data(pd->array, pd->array_length, sizeof(FBFile), compare, NULL);
 }
 
 static void file_browser_mode_init_config(Mode *sw) {
@@ -556,6 +784,13 @@ static void file_browser_mode_destroy(Mode *sw) {
   FileBrowserModePrivateData *pd =
       (FileBrowserModePrivateData *)mode_get_private_data(sw);
   if (pd != NULL) {
+    file_browser_stop_listing(pd);
+    if (pd->async_queue != NULL) {
+      g_source_remove(pd->wake_source);
+      close(pd->pipefd2[0]);
+      close(pd->pipefd2[1]);
+      g_async_queue_unref(pd->async_queue);
+    }
     g_object_unref(pd->current_dir);
     g_free(pd->command);
     free_list(pd);
@@ -43,9 +43,12 @@
 #include <signal.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <glib/gstdio.h>
+
 #include "display.h"
 #include "helper.h"
 #include "history.h"
@@ -62,6 +65,16 @@
  * Name of the history file where previously chosen commands are stored.
  */
 #define RUN_CACHE_FILE "rofi-4.runcache"
+/**
+ * Name of the file holding the index of the executables in the PATH.
+ */
+#define RUN_INDEX_FILE "rofi-run.index"
+/** Version of the run index file format. */
+#define RUN_INDEX_VERSION 1
+
+#if defined(__APPLE__)
+#define st_mtim st_mtimespec
+#endif
 
 typedef struct {
   char *entry;
@@ -239,6 +252,373 @@ static RunEntry *get_apps_external(RunEntry *retv, unsigned int *length,
   return retv;
 }
 
+/*******************************************
+ * Executable index                        *
+ *******************************************/
+
+/**
+ * A directory in the PATH, with the executables found in it.
+ */
+typedef struct {
+  /** The directory, as listed in the PATH. */
+  char *path;
+  /** Fingerprint, all 0 when the directory does not exist. */
+  int64_t mtime;
+  int64_t mtime_nsec;
+  uint64_t inode;
+  /** The executables (UTF-8). */
+  GPtrArray *names;
+} RunIndexDir;
+
+static void run_index_dir_free(RunIndexDir *dir) {
+  if (dir == NULL) {
+    return;
+  }
+  g_free(dir->path);
+  if (dir->names != NULL) {
+    g_ptr_array_free(dir->names, TRUE);
+  }
+  g_free(dir);
+}
+
+static void run_index_write_str(FILE *fd, const char *str) {
+  uint32_t l = (uint32_t)strlen(str);
+  fwrite(&l, sizeof(l), 1, fd);
+  fwrite(str, 1, l, fd);
+}
+
+static gboolean run_index_read_str(FILE *fd, char **str) {
+  uint32_t l = 0;
+  // Sanity check, before allocating.
+  if (fread(&l, sizeof(l), 1, fd) != 1 || l > (1 << 20)) {
+    return FALSE;
+  }
+  *str = g_malloc(l + 1);
+  if (fread(*str, 1, l, fd) != l) {
+    g_free(*str);
+    *str = NULL;
+    return FALSE;
+  }
+  (*str)[l] = '\0';
+  return TRUE;
+}
+
+static gboolean run_index_read_strv(FILE *fd, GPtrArray *array) {
+  uint32_t n = 0;
+  if (fread(&n, sizeof(n), 1, fd) != 1) {
+    return FALSE;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    char *str = NULL;
+    if (!run_index_read_str(fd, &str)) {
+      return FALSE;
+    }
+    g_ptr_array_add(array, str);
+  }
+  return TRUE;
+}
+
+static void run_index_write_strv(FILE *fd, GPtrArray *array) {
+  uint32_t n = array->len;
+  fwrite(&n, sizeof(n), 1, fd);
+  for (guint i = 0; i < array->len; i++) {
+    run_index_write_str(fd, g_ptr_array_index(array, i));
+  }
+}
+
+/**
+ * @param dir The directory to fingerprint.
+ *
+ * Set the fingerprint of the directory, a change of its content changes its
+ * modification time.
+ */
+static void run_index_dir_stat(RunIndexDir *dir) {
+  char *fpath = rofi_expand_path(dir->path);
+  GStatBuf st;
+  if (g_stat(fpath, &st) == 0 && S_ISDIR(st.st_mode)) {
+    dir->mtime = st.st_mtim.tv_sec;
+    dir->mtime_nsec = st.st_mtim.tv_nsec;
+    dir->inode = st.st_ino;
+  } else {
+    dir->mtime = dir->mtime_nsec = 0;
+    dir->inode = 0;
+  }
+  g_free(fpath);
+}
+
+/**
+ * @param index_file The index file.
+ * @param dirs Filled with the directories in the index, by path.
+ * @param entries Filled with the sorted and deduplicated executables.
+ *
+ * Read the index.
+ *
+ * @returns the PATH the index was made for, or NULL when there is no valid
+ * index.
+ */
+static char *run_index_read(const char *index_file, GHashTable *dirs,
+                            GPtrArray *entries) {
+  FILE *fd = g_fopen(index_file, "rb");
+  if (fd == NULL) {
+    return NULL;
+  }
+  char *env_path = NULL;
+  uint8_t version = 0;
+  uint32_t num_dirs = 0;
+  gboolean valid = fread(&version, sizeof(version), 1, fd) == 1 &&
+                   version == RUN_INDEX_VERSION &&
+                   run_index_read_str(fd, &env_path) &&
+                   fread(&num_dirs, sizeof(num_dirs), 1, fd) == 1;
+  for (uint32_t i = 0; valid && i < num_dirs; i++) {
+    RunIndexDir *dir = g_malloc0(sizeof(*dir));
+    dir->names = g_ptr_array_new_with_free_func(g_free);
+    valid = run_index_read_str(fd, &(dir->path)) &&
+            fread(&(dir->mtime), sizeof(dir->mtime), 1, fd) == 1 &&
+            fread(&(dir->mtime_nsec), sizeof(dir->mtime_nsec), 1, fd) == 1 &&
+            fread(&(dir->inode), sizeof(dir->inode), 1, fd) == 1 &&
+            run_index_read_strv(fd, dir->names);
+    if (valid) {
+      g_hash_table_replace(dirs, dir->path, dir);
+    } else {
+      run_index_dir_free(dir);
+    }
+  }
+  valid = valid && run_index_read_strv(fd, entries);
+  fclose(fd);
+  if (!valid) {
+    g_warning("Run index corrupt, ignoring.");
+    g_hash_table_remove_all(dirs);
+    g_ptr_array_set_size(entries, 0);
+    g_free(env_path);
+    return NULL;
+  }
+  return env_path;
+}
+
+static void run_index_write(const char *index_file, const char *env_path,
+                            GPtrArray *dirs, GPtrArray *entries) {
+  TICK_N("Run index write: start");
+  char *tmp_file = g_strdup_printf("%s.XXXXXX", index_file);
+  int tfd = g_mkstemp(tmp_file);
+  FILE *fd = tfd >= 0 ? fdopen(tfd, "wb") : NULL;
+  if (fd == NULL) {
+    g_warning("Failed to write run index: '%s'", g_strerror(errno));
+    if (tfd >= 0) {
+      close(tfd);
+      g_unlink(tmp_file);
+    }
+    g_free(tmp_file);
+    return;
+  }
+  uint8_t version = RUN_INDEX_VERSION;
+  fwrite(&version, sizeof(version), 1, fd);
+  run_index_write_str(fd, env_path);
+  uint32_t num_dirs = dirs->len;
+  fwrite(&num_dirs, sizeof(num_dirs), 1, fd);
+  for (guint i = 0; i < dirs->len; i++) {
+    RunIndexDir *dir = g_ptr_array_index(dirs, i);
+    run_index_write_str(fd, dir->path);
+    fwrite(&(dir->mtime), sizeof(dir->mtime), 1, fd);
+    fwrite(&(dir->mtime_nsec), sizeof(dir->mtime_nsec), 1, fd);
+    fwrite(&(dir->inode), sizeof(dir->inode), 1, fd);
+    run_index_write_strv(fd, dir->names);
+  }
+  run_index_write_strv(fd, entries);
+  gboolean failed = ferror(fd) != 0;
+  failed = (fclose(fd) != 0) || failed;
+  // Replace the index in one go, other instances might be reading it.
+  if (failed || g_rename(tmp_file, index_file) != 0) {
+    g_warning("Failed to write run index: '%s'", g_strerror(errno));
+    g_unlink(tmp_file);
+  }
+  g_free(tmp_file);
+  TICK_N("Run index write: stop");
+}
+
+/**
+ * @param dir The directory to scan.
+ * @param homedir The home directory (UTF-8).
+ *
+ * Fill the names of dir with the executables in it.
+ */
+static void run_index_dir_scan(RunIndexDir *dir, const char *homedir) {
+  GError *error = NULL;
+  dir->names = g_ptr_array_new_with_free_func(g_free);
+  if (dir->inode == 0) {
+    // Does not exist.
+    return;
+  }
+  char *fpath = rofi_expand_path(dir->path);
+  DIR *d = opendir(fpath);
+  g_debug("Checking path %s for executable.", fpath);
+  if (d == NULL) {
+    g_free(fpath);
+    return;
+  }
+  gsize dirn_len = 0;
+  gchar *dirn = g_locale_to_utf8(dir->path, -1, NULL, &dirn_len, &error);
+  if (error != NULL) {
+    g_debug("Failed to convert directory name to UTF-8: %s", error->message);
+    g_clear_error(&error);
+    closedir(d);
+    g_free(fpath);
+    return;
+  }
+  gboolean is_homedir = g_str_has_prefix(dirn, homedir);
+  g_free(dirn);
+
+  struct dirent *dent;
+  while ((dent = readdir(d)) != NULL) {
+    if (dent->d_type != DT_REG && dent->d_type != DT_LNK &&
+        dent->d_type != DT_UNKNOWN) {
+      continue;
+    }
+    // Skip dot files.
+    if (dent->d_name[0] == '.') {
+      continue;
+    }
+    if (is_homedir) {
+      gchar *full_path = g_build_filename(fpath, dent->d_name, NULL);
+      gboolean b = g_file_test(full_path, G_FILE_TEST_IS_EXECUTABLE);
+      g_free(full_path);
+      if (!b) {
+        continue;
+      }
+    }
+
+    gsize name_len;
+    gchar *name = g_filename_to_utf8(dent->d_name, -1, NULL, &name_len, &error);
+    if (error != NULL) {
+      g_debug("Failed to convert filename to UTF-8: %s", error->message);
+      g_clear_error(&error);
+      g_free(name);
+      continue;
+    }
+    g_ptr_array_add(dir->names, name);
+  }
+  closedir(d);
+  g_free(fpath);
+}
+
+static gint run_index_sort_func(gconstpointer a, gconstpointer b) {
+  return g_strcmp0(*(const char *const *)a, *(const char *const *)b);
+}
+
+/**
+ * @param path The directory, as listed in the PATH.
+ * @param homedir The home directory (UTF-8).
+ *
+ * Executables in the home directory are checked for the executable bit. A
+ * chmod does not change the directory's fingerprint, so these directories are
+ * read again every time.
+ *
+ * @returns TRUE when the directory is in the home directory.
+ */
+static gboolean run_index_dir_in_home(const char *path, const char *homedir) {
+  gchar *dirn = g_locale_to_utf8(path, -1, NULL, NULL, NULL);
+  gboolean retv = dirn != NULL && g_str_has_prefix(dirn, homedir);
+  g_free(dirn);
+  return retv;
+}
+
+static gboolean run_index_names_equal(GPtrArray *a, GPtrArray *b) {
+  if (a->len != b->len) {
+    return FALSE;
+  }
+  for (guint i = 0; i < a->len; i++) {
+    if (g_strcmp0(g_ptr_array_index(a, i), g_ptr_array_index(b, i)) != 0) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/**
+ * @param homedir The home directory (UTF-8).
+ *
+ * Get the sorted and deduplicated executables in the PATH. Directories that
+ * did not change since the index was written are not read again, except for
+ * those in the home directory.
+ *
+ * @returns the executables.
+ */
+static GPtrArray *run_index_get(const char *homedir) {
+  const char *env_path = g_getenv("PATH");
+  char *index_file = g_build_filename(cache_dir, RUN_INDEX_FILE, NULL);
+  GHashTable *cached = g_hash_table_new_full(
+      g_str_hash, g_str_equal, NULL, (GDestroyNotify)run_index_dir_free);
+  GPtrArray *entries = g_ptr_array_new_with_free_func(g_free);
+  char *cached_env_path = run_index_read(index_file, cached, entries);
+  TICK_N("Run index read");
+
+  gboolean changed = g_strcmp0(cached_env_path, env_path) != 0;
+  g_free(cached_env_path);
+  GPtrArray *dirs =
+      g_ptr_array_new_with_free_func((GDestroyNotify)run_index_dir_free);
+  GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+  char **paths = g_strsplit(env_path, ":", -1);
+  for (char **iter = paths; *iter != NULL; iter++) {
+    // Repeated directories add nothing.
+    if ((*iter)[0] == '\0' || !g_hash_table_add(seen, *iter)) {
+      continue;
+    }
+    RunIndexDir *dir = g_malloc0(sizeof(*dir));
+    dir->path = g_strdup(*iter);
+    run_index_dir_stat(dir);
+    RunIndexDir *old = g_hash_table_lookup(cached, dir->path);
+    if (run_index_dir_in_home(dir->path, homedir)) {
+      run_index_dir_scan(dir, homedir);
+      g_ptr_array_sort(dir->names, run_index_sort_func);
+      if (old == NULL || old->names == NULL ||
+          !run_index_names_equal(old->names, dir->names)) {
+        changed = TRUE;
+      }
+    } else if (old != NULL && old->names != NULL &&
+               old->mtime == dir->mtime &&
+               old->mtime_nsec == dir->mtime_nsec &&
+               old->inode == dir->inode) {
+      dir->names = old->names;
+      old->names = NULL;
+    } else {
+      run_index_dir_scan(dir, homedir);
+      changed = TRUE;
+    }
+    g_ptr_array_add(dirs, dir);
+  }
+  g_hash_table_destroy(seen);
+  g_strfreev(paths);
+  g_hash_table_destroy(cached);
+  TICK_N("Run index check directories");
+
+  if (changed) {
+    g_ptr_array_set_size(entries, 0);
+    for (guint i = 0; i < dirs->len; i++) {
+      RunIndexDir *dir = g_ptr_array_index(dirs, i);
+      for (guint j = 0; j < dir->names->len; j++) {
+        g_ptr_array_add(entries, g_strdup(g_ptr_array_index(dir->names, j)));
+      }
+    }
+    g_ptr_array_sort(entries, run_index_sort_func);
+    // Strip duplicates, the list is sorted.
+    guint length = 0;
+    for (guint i = 0; i < entries->len; i++) {
+      char *name = g_ptr_array_index(entries, i);
+      if (length > 0 &&
+          g_strcmp0(g_ptr_array_index(entries, length - 1), name) == 0) {
+        g_free(name);
+        continue;
+      }
+      entries->pdata[length++] = name;
+    }
+    entries->len = length;
+    TICK_N("Run index sort");
+    run_index_write(index_file, env_path, dirs, entries);
+  }
+  g_ptr_array_free(dirs, TRUE);
+  g_free(index_file);
+  return entries;
+}
+
 /**
  * Internal spider used to get list of executables.
  */
@@ -270,8 +650,6 @@ static RunEntry *get_apps(unsigned int *length) {
   // Keep track of how many where loaded as favorite.
   num_favorites = (*length);
 
-  path = g_strdup(g_getenv("PATH"));
-
   gsize l = 0;
   gchar *homedir = g_locale_to_utf8(g_get_home_dir(), -1, NULL, &l, &error);
   if (error != NULL) {
@@ -286,95 +664,40 @@ static RunEntry *get_apps(unsigned int *length) {
     return NULL;
   }
 
-  const char *const sep = ":";
-  char *strtok_savepointer = NULL;
-  for (const char *dirname = strtok_r(path, sep, &strtok_savepointer);
-       dirname != NULL; dirname = strtok_r(NULL, sep, &strtok_savepointer)) {
-    char *fpath = rofi_expand_path(dirname);
-    DIR *dir = opendir(fpath);
-    g_debug("Checking path %s for executable.", fpath);
-    g_free(fpath);
-
-    if (dir != NULL) {
-      struct dirent *dent;
-      gsize dirn_len = 0;
-      gchar *dirn = g_locale_to_utf8(dirname, -1, NULL, &dirn_len, &error);
-      if (error != NULL) {
-        g_debug("Failed to convert directory name to UTF-8: %s",
-                error->message);
-        g_clear_error(&error);
-        closedir(dir);
-        continue;
-      }
-      gboolean is_homedir = g_str_has_prefix(dirn, homedir);
-      g_free(dirn);
-
-      while ((dent = readdir(dir)) != NULL) {
-        if (dent->d_type != DT_REG && dent->d_type != DT_LNK &&
-            dent->d_type != DT_UNKNOWN) {
-          continue;
-        }
-        // Skip dot files.
-        if (dent->d_name[0] == '.') {
-          continue;
-        }
-        if (is_homedir) {
-          gchar *full_path = g_build_filename(dirname, dent->d_name, NULL);
-          gboolean b = g_file_test(full_path, G_FILE_TEST_IS_EXECUTABLE);
-          g_free(full_path);
-          if (!b) {
-            continue;
-          }
-        }
-
-        gsize name_len;
-        gchar *name =
-            g_filename_to_utf8(dent->d_name, -1, NULL, &name_len, &error);
-        if (error != NULL) {
-          g_debug("Failed to convert filename to UTF-8: %s", error->message);
-          g_clear_error(&error);
-          g_free(name);
-          continue;
-        }
-        // This is a nice little penalty, but doable? time will tell.
-        // given num_favorites is max 25.
-        int found = 0;
-        for (unsigned int j = 0; found == 0 && j < num_favorites; j++) {
-          if (g_strcmp0(name, retv[j].entry) == 0) {
-            found = 1;
-          }
-        }
-
-        if (found == 1) {
-          g_free(name);
-          continue;
-        }
-
-        retv = g_realloc(retv, ((*length) + 2) * sizeof(RunEntry));
-        retv[(*length)].entry = name;
-        retv[(*length)].exec = g_shell_quote(name);
-        retv[(*length)].from_history = FALSE;
-        retv[(*length)].icon = NULL;
-        retv[(*length)].icon_fetch_uid = 0;
-        retv[(*length)].icon_fetch_size = 0;
-        retv[(*length) + 1].entry = NULL;
-        retv[(*length) + 1].exec = NULL;
-        retv[(*length) + 1].from_history = FALSE;
-        retv[(*length) + 1].icon = NULL;
-        retv[(*length) + 1].icon_fetch_uid = 0;
-        retv[(*length) + 1].icon_fetch_size = 0;
-        (*length)++;
-      }
+  GPtrArray *entries = run_index_get(homedir);
+  g_free(homedir);
 
-      closedir(dir);
+  GHashTable *favorites = g_hash_table_new(g_str_hash, g_str_equal);
+  for (unsigned int j = 0; j < num_favorites; j++) {
+    g_hash_table_add(favorites, retv[j].entry);
+  }
+  retv = g_realloc(retv, ((*length) + entries->len + 1) * sizeof(RunEntry));
+  for (guint i = 0; i < entries->len; i++) {
+    char *name = g_ptr_array_index(entries, i);
+    if (g_hash_table_contains(favorites, name)) {
+      continue;
     }
+    retv[(*length)].entry = g_strdup(name);
+    retv[(*length)].exec = g_shell_quote(name);
+    retv[(*length)].from_history = FALSE;
+    retv[(*length)].icon = NULL;
+    retv[(*length)].icon_fetch_uid = 0;
+    retv[(*length)].icon_fetch_size = 0;
+    (*length)++;
   }
-  g_free(homedir);
+  memset(&(retv[(*length)]), 0, sizeof(RunEntry));
+  g_hash_table_destroy(favorites);
+  g_ptr_array_free(entries, TRUE);
 
   // Get external apps.
-  if (config.run_list_command != NULL && config.run_list_command[0] != '\0') {
-    retv = get_apps_external(retv, length, num_favorites);
+  // The executables from the index are sorted and unique, only the external
+  // apps need merging.
+  if (config.run_list_command == NULL || config.run_list_command[0] == '\0') {
+    TIMINGS_COUNTER("run entries loaded", *length);
+    TICK_N("stop");
+    return retv;
   }
+  retv = get_apps_external(retv, length, num_favorites);
   // No sorting needed.
   if ((*length) == 0) {
     return retv;
@@ -384,7 +707,6 @@ static RunEntry *get_apps(unsigned int *length) {
     g_qsort_with_data(&(retv[num_favorites]), (*length) - num_favorites,
                       sizeof(RunEntry), sort_func, NULL);
   }
-  g_free(path);
 
   unsigned int removed = 0;
   for (unsigned int index = num_favorites; index < ((*length) - 1); index++) {
@@ -404,6 +726,7 @@ static RunEntry *get_apps(unsigned int *length) {
   // Reduce array length;
   (*length) -= removed;
 
+  TIMINGS_COUNTER("run entries loaded", *length);
   TICK_N("stop");
   return retv;
 }
@@ -614,5 +937,5 @@ Mode run_mode = {.name = "run",
                  ._preprocess_input = NULL,
                  .private_data = NULL,
                  .free = NULL,
-                 .type = MODE_TYPE_SWITCHER};
+                 .type = MODE_TYPE_SWITCHER | MODE_TYPE_THREADED_INIT};
 /** @}*/
@@ -28,6 +28,7 @@
 /** The log domain of this dialog. */
 #define G_LOG_DOMAIN "Modes.Script"
 
+#include "config.h"
 #include "modes/script.h"
 #include "display.h"
 #include "helper.h"
@@ -35,6 +36,9 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <glib-unix.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -49,6 +53,36 @@
 
 #include "modes/dmenuscriptshared.h"
 
+/**
+ * A script kept running between interactions, see script_coprocess_start().
+ */
+typedef struct {
+  /** PID of the script, 0 when not running. */
+  GPid pid;
+  /** Write end of the script's stdin. */
+  int in;
+  /** Read end of the script's stdout (non-blocking). */
+  int out;
+  /** Watch on out. */
+  guint watch;
+  /** Unparsed output. */
+  GString *buffer;
+  /** Rows of the frame being read. */
+  DmenuScriptEntry *list;
+  unsigned int length;
+  size_t size;
+  /** Rows of the frame are added to the list, not replacing it. */
+  gboolean append;
+  /** Id of the next request. */
+  guint64 next_id;
+  /** Id of the request waited on. */
+  guint64 sync_id;
+  /** A request is waited on. */
+  gboolean sync;
+  /** The answer to the request waited on is read. */
+  gboolean done;
+} ScriptCoprocess;
+
 typedef struct {
   /** ID of the current script. */
   unsigned int id;
@@ -77,6 +111,14 @@ typedef struct {
   gboolean keep_filter;
 
   gboolean use_hot_keys;
+
+  /** Keep the script running and talk to it over stdin/stdout. */
+  gboolean coprocess;
+  ScriptCoprocess cp;
+  /** Send the script the input on each change. */
+  gboolean input_change;
+  /** The input last sent to the script. */
+  char *last_input;
 } ScriptModePrivateData;
 
 /**
@@ -164,6 +206,8 @@ static void parse_header_entry(Mode *sw, char *line, ssize_t length) {
       pd->keep_filter = (strcasecmp(value, "true") == 0);
     } else if (strcasecmp(line, "new-selection") == 0) {
       pd->new_selection = (int64_t)g_ascii_strtoll(value, NULL, 0);
+    } else if (strcasecmp(line, "input-change") == 0) {
+      pd->input_change = (strcasecmp(value, "true") == 0);
     } else if (strcasecmp(line, "data") == 0) {
       g_free(pd->data);
       pd->data = g_strdup(value);
@@ -176,6 +220,403 @@ static void parse_header_entry(Mode *sw, char *line, ssize_t length) {
   }
 }
 
+/**
+ * @param sw The script mode.
+ * @param list The list to add to.
+ * @param length The length of the list.
+ * @param actual_size The allocated size of the list.
+ * @param buffer The row, with its extras.
+ * @param read_length The length of the row, including the delimiter.
+ *
+ * Parse a row of script output and add it to the list.
+ */
+static void script_add_entry(Mode *sw, DmenuScriptEntry **list,
+                             unsigned int *length, size_t *actual_size,
+                             char *buffer, ssize_t read_length) {
+  if ((*actual_size) < ((*length) + 2)) {
+    (*actual_size) += 256;
+    *list = g_realloc(*list, (*actual_size) * sizeof(DmenuScriptEntry));
+  }
+  DmenuScriptEntry *retv = *list;
+  size_t buf_length = strlen(buffer) + 1;
+#if GLIB_CHECK_VERSION(2, 68, 0)
+  retv[(*length)].entry = g_memdup2(buffer, buf_length);
+#else
+  retv[(*length)].entry = g_memdup(buffer, buf_length);
+#endif
+  retv[(*length)].icon_name = NULL;
+  retv[(*length)].display = NULL;
+  retv[(*length)].meta = NULL;
+  retv[(*length)].info = NULL;
+  retv[(*length)].active = FALSE;
+  retv[(*length)].urgent = FALSE;
+  retv[(*length)].icon_fetch_uid = 0;
+  retv[(*length)].icon_fetch_size = 0;
+  retv[(*length)].icon_fetch_scale = 0;
+  retv[(*length)].nonselectable = FALSE;
+  retv[(*length)].permanent = FALSE;
+  if (buf_length > 0 && (read_length > (ssize_t)buf_length)) {
+    dmenuscript_parse_entry_extras(sw, &(retv[(*length)]), buffer + buf_length,
+                                   read_length - buf_length);
+  }
+  memset(&(retv[(*length) + 1]), 0, sizeof(DmenuScriptEntry));
+  (*length)++;
+}
+
+static void script_free_entries(DmenuScriptEntry *list, unsigned int length) {
+  for (unsigned int i = 0; i < length; i++) {
+    g_free(list[i].entry);
+    g_free(list[i].icon_name);
+    g_free(list[i].display);
+    g_free(list[i].meta);
+    g_free(list[i].info);
+  }
+  g_free(list);
+}
+
+/**
+ * Coprocess protocol.
+ *
+ * The script is started once, with ROFI_COPROCESS set. Each interaction is
+ * written to its stdin as a request: the fields id, retv, argument, info and
+ * data, separated by '\x1f' and terminated by '\0'. The script answers with a
+ * frame: the normal script output, terminated by the line "\0end\x1f<id>".
+ * Frames can also be sent unasked, terminated by "\0end", for example to show
+ * results while the user types. Only the answer ends a request waited on.
+ */
+
+static void script_coprocess_stop(Mode *sw) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  if (cp->watch > 0) {
+    g_source_remove(cp->watch);
+    cp->watch = 0;
+  }
+  // The script should exit when its stdin is closed.
+  if (cp->in >= 0) {
+    close(cp->in);
+    cp->in = -1;
+  }
+  if (cp->out >= 0) {
+    close(cp->out);
+    cp->out = -1;
+  }
+  if (cp->buffer != NULL) {
+    g_string_free(cp->buffer, TRUE);
+    cp->buffer = NULL;
+  }
+  script_free_entries(cp->list, cp->length);
+  cp->list = NULL;
+  cp->length = 0;
+  cp->size = 0;
+  cp->append = FALSE;
+  cp->pid = 0;
+}
+
+static void script_coprocess_exited(GPid pid, G_GNUC_UNUSED gint status,
+                                    G_GNUC_UNUSED gpointer data) {
+  g_spawn_close_pid(pid);
+}
+
+/**
+ * @param sw The script mode.
+ *
+ * Add the rows of the frame just read to the list and update the view.
+ */
+static void script_coprocess_apply(Mode *sw) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  if (cp->append) {
+    pd->cmd_list =
+        g_realloc(pd->cmd_list, (pd->cmd_list_length + cp->length + 1) *
+                                    sizeof(DmenuScriptEntry));
+    if (cp->length > 0) {
+      memcpy(&(pd->cmd_list[pd->cmd_list_length]), cp->list,
+             cp->length * sizeof(DmenuScriptEntry));
+    }
+    pd->cmd_list_length += cp->length;
+    memset(&(pd->cmd_list[pd->cmd_list_length]), 0, sizeof(DmenuScriptEntry));
+    g_free(cp->list);
+  } else {
+    script_free_entries(pd->cmd_list, pd->cmd_list_length);
+    pd->cmd_list = cp->list;
+    pd->cmd_list_length = cp->length;
+  }
+  cp->list = NULL;
+  cp->length = 0;
+  cp->size = 0;
+  cp->append = FALSE;
+  rofi_view_reload();
+}
+
+/**
+ * @param sw The script mode.
+ *
+ * Parse the complete lines in the read buffer.
+ */
+static void script_coprocess_parse(Mode *sw) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  gsize start = 0;
+  while (start < cp->buffer->len) {
+    // The delimiter can change half way the buffer.
+    char *line = cp->buffer->str + start;
+    char *end = memchr(line, pd->delim, cp->buffer->len - start);
+    if (end == NULL) {
+      break;
+    }
+    *end = '\0';
+    ssize_t read_length = (end - line) + 1;
+    start += read_length;
+    if (line[0] != '\0') {
+      script_add_entry(sw, &(cp->list), &(cp->length), &(cp->size), line,
+                       read_length);
+    } else if (strcmp(&line[1], "end") == 0 ||
+               strncmp(&line[1], "end\x1f", 4) == 0) {
+      // Answers carry the id of their request, frames sent unasked do not.
+      if (cp->sync && line[4] == '\x1f' &&
+          g_ascii_strtoull(&line[5], NULL, 10) == cp->sync_id) {
+        // Handed to the waiting request.
+        cp->done = TRUE;
+        break;
+      }
+      script_coprocess_apply(sw);
+    } else if (strcmp(&line[1], "append\x1ftrue") == 0) {
+      cp->append = TRUE;
+    } else {
+      parse_header_entry(sw, &line[1], read_length - 1);
+    }
+  }
+  g_string_erase(cp->buffer, 0, start);
+}
+
+/**
+ * @param sw The script mode.
+ *
+ * Read all available output of the script.
+ *
+ * @returns FALSE when the script closed its output.
+ */
+static gboolean script_coprocess_read(Mode *sw) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  char buffer[4096];
+  ssize_t r;
+  while ((r = read(cp->out, buffer, sizeof(buffer))) != 0) {
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      g_warning("Failed to read from script: '%s'", g_strerror(errno));
+      return FALSE;
+    }
+    g_string_append_len(cp->buffer, buffer, r);
+  }
+  script_coprocess_parse(sw);
+  return r != 0;
+}
+
+static gboolean script_coprocess_read_proc(G_GNUC_UNUSED gint fd,
+                                           G_GNUC_UNUSED GIOCondition condition,
+                                           gpointer user_data) {
+  Mode *sw = (Mode *)user_data;
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  if (!script_coprocess_read(sw)) {
+    // Frames are read by the watch, so this cannot be a request waited on.
+    pd->cp.watch = 0;
+    script_coprocess_stop(sw);
+    // Like returning no rows, the script exiting closes the view.
+    RofiViewState *state = rofi_view_get_active();
+    if (state != NULL && rofi_view_get_mode(state) == sw) {
+      rofi_view_trigger_action(state, SCOPE_GLOBAL, CANCEL);
+      rofi_view_maybe_update(state);
+    }
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean script_coprocess_start(Mode *sw) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  GError *error = NULL;
+  char **argv = NULL;
+  int argc = 0;
+  char **env = g_get_environ();
+  char *str_value = g_strdup_printf("%d", (int)getpid());
+  env = g_environ_setenv(env, "ROFI_OUTSIDE", str_value, TRUE);
+  g_free(str_value);
+  env = g_environ_setenv(env, "ROFI_COPROCESS", "1", TRUE);
+
+  if (g_shell_parse_argv(sw->ed, &argc, &argv, &error)) {
+    g_spawn_async_with_pipes(
+        NULL, argv, env, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL,
+        NULL, &(cp->pid), &(cp->in), &(cp->out), NULL, &error);
+  }
+  g_strfreev(env);
+  g_strfreev(argv);
+  if (error != NULL) {
+    char *msg = g_strdup_printf("Failed to execute: '%s'\nError: '%s'",
+                                (char *)sw->ed, error->message);
+    rofi_view_error_dialog(msg, FALSE);
+    g_free(msg);
+    g_error_free(error);
+    cp->pid = 0;
+    cp->in = cp->out = -1;
+    return FALSE;
+  }
+  g_child_watch_add(cp->pid, script_coprocess_exited, NULL);
+  g_unix_set_fd_nonblocking(cp->out, TRUE, NULL);
+  cp->buffer = g_string_sized_new(4096);
+  cp->watch = g_unix_fd_add(cp->out, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                            script_coprocess_read_proc, sw);
+  return TRUE;
+}
+
+/**
+ * @param fd The file descriptor.
+ * @param data The data to write.
+ * @param length The length of data.
+ *
+ * Write data, without getting killed by SIGPIPE when the script is gone.
+ *
+ * @returns TRUE when all data was written.
+ */
+static gboolean script_coprocess_write(int fd, const char *data,
+                                       size_t length) {
+  sigset_t set, old;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, &old);
+  gboolean retv = TRUE;
+  while (length > 0) {
+    ssize_t r = write(fd, data, length);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EPIPE) {
+        // Drop the pending signal.
+        struct timespec ts = {0, 0};
+        sigtimedwait(&set, NULL, &ts);
+      }
+      retv = FALSE;
+      break;
+    }
+    data += r;
+    length -= r;
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  return retv;
+}
+
+/**
+ * @param sw The script mode.
+ * @param arg The argument.
+ * @param value The ROFI_RETV value.
+ * @param entry The selected entry, or NULL.
+ *
+ * Send a request to the script, starting it if needed.
+ *
+ * @returns the id of the request, 0 when it could not be sent.
+ */
+static guint64 script_coprocess_send(Mode *sw, const char *arg, int value,
+                                     DmenuScriptEntry *entry) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  if (cp->pid == 0 && !script_coprocess_start(sw)) {
+    return 0;
+  }
+  guint64 id = ++(cp->next_id);
+  GString *request = g_string_new(NULL);
+  g_string_append_printf(request,
+                         "%" G_GUINT64_FORMAT "\x1f%d\x1f%s\x1f%s\x1f%s", id,
+                         value, arg ? arg : "",
+                         (entry && entry->info) ? entry->info : "",
+                         pd->data ? pd->data : "");
+  // Include the terminating '\0'.
+  gboolean retv =
+      script_coprocess_write(cp->in, request->str, request->len + 1);
+  g_string_free(request, TRUE);
+  if (!retv) {
+    g_warning("Failed to write to script: '%s'", g_strerror(errno));
+    script_coprocess_stop(sw);
+    return 0;
+  }
+  return id;
+}
+
+/**
+ * @param sw The script mode.
+ * @param arg The argument.
+ * @param length Set to the length of the returned list.
+ * @param value The ROFI_RETV value.
+ * @param entry The selected entry, or NULL.
+ *
+ * Send a request to the script and wait for the answer.
+ *
+ * @returns the new list, or NULL when the script sent no rows or exited.
+ */
+static DmenuScriptEntry *script_coprocess_request(Mode *sw, const char *arg,
+                                                  unsigned int *length,
+                                                  int value,
+                                                  DmenuScriptEntry *entry) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  ScriptCoprocess *cp = &(pd->cp);
+  DmenuScriptEntry *retv = NULL;
+  *length = 0;
+  cp->sync_id = script_coprocess_send(sw, arg, value, entry);
+  if (cp->sync_id == 0) {
+    return NULL;
+  }
+  cp->sync = TRUE;
+  cp->done = FALSE;
+  gboolean running = TRUE;
+  script_coprocess_parse(sw);
+  while (running && !cp->done) {
+    struct pollfd pfd = {.fd = cp->out, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      running = FALSE;
+      break;
+    }
+    running = script_coprocess_read(sw);
+  }
+  cp->sync = FALSE;
+  if (cp->done) {
+    cp->done = FALSE;
+    if (cp->append) {
+      // Hand over the current rows with the new ones.
+      script_coprocess_apply(sw);
+      retv = pd->cmd_list;
+      *length = pd->cmd_list_length;
+      pd->cmd_list = NULL;
+      pd->cmd_list_length = 0;
+    } else {
+      retv = cp->list;
+      *length = cp->length;
+      cp->list = NULL;
+      cp->length = 0;
+      cp->size = 0;
+    }
+    if (*length == 0) {
+      g_free(retv);
+      retv = NULL;
+    }
+    // Frames that arrived after the answer.
+    script_coprocess_parse(sw);
+  }
+  if (!running) {
+    script_coprocess_stop(sw);
+  }
+  return retv;
+}
+
 static DmenuScriptEntry *execute_executor(Mode *sw, char *arg,
                                           unsigned int *length, int value,
                                           DmenuScriptEntry *entry) {
@@ -190,6 +631,9 @@ static DmenuScriptEntry *execute_executor(Mode *sw, char *arg,
   pd->new_selection = -1;
   pd->keep_selection = 0;
   pd->keep_filter = 0;
+  if (pd->coprocess) {
+    return script_coprocess_request(sw, arg, length, value, entry);
+  }
   // Environment
   char **env = g_get_environ();
 
@@ -241,36 +685,8 @@ static DmenuScriptEntry *execute_executor(Mode *sw, char *arg,
         if (buffer[0] == '\0') {
           parse_header_entry(sw, &buffer[1], read_length - 1);
         } else {
-          if (actual_size < ((*length) + 2)) {
-            actual_size += 256;
-            retv = g_realloc(retv, (actual_size) * sizeof(DmenuScriptEntry));
-          }
-          if (retv) {
-            size_t buf_length = strlen(buffer) + 1;
-#if GLIB_CHECK_VERSION(2, 68, 0)
-            retv[(*length)].entry = g_memdup2(buffer, buf_length);
-#else
-            retv[(*length)].entry = g_memdup(buffer, buf_length);
-#endif
-            retv[(*length)].icon_name = NULL;
-            retv[(*length)].display = NULL;
-            retv[(*length)].meta = NULL;
-            retv[(*length)].info = NULL;
-            retv[(*length)].active = FALSE;
-            retv[(*length)].urgent = FALSE;
-            retv[(*length)].icon_fetch_uid = 0;
-            retv[(*length)].icon_fetch_size = 0;
-            retv[(*length)].icon_fetch_scale = 0;
-            retv[(*length)].nonselectable = FALSE;
-            retv[(*length)].permanent = FALSE;
-            if (buf_length > 0 && (read_length > (ssize_t)buf_length)) {
-              dmenuscript_parse_entry_extras(sw, &(retv[(*length)]),
-                                             buffer + buf_length,
-                                             read_length - buf_length);
-            }
-            memset(&(retv[(*length) + 1]), 0, sizeof(DmenuScriptEntry));
-            (*length)++;
-          }
+          script_add_entry(sw, &retv, length, &actual_size, buffer,
+                           read_length);
         }
       }
       if (buffer) {
@@ -299,7 +715,11 @@ static int script_mode_init(Mode *sw) {
   if (sw->private_data == NULL) {
     ScriptModePrivateData *pd = g_malloc0(sizeof(*pd));
     pd->delim = '\n';
+    pd->cp.in = pd->cp.out = -1;
     sw->private_data = (void *)pd;
+    ThemeWidget *wid = rofi_config_find_widget(sw->name, NULL, TRUE);
+    Property *p = rofi_theme_find_property(wid, P_BOOLEAN, "coprocess", TRUE);
+    pd->coprocess = (p != NULL && p->type == P_BOOLEAN && p->value.b);
     pd->cmd_list = execute_executor(sw, NULL, &(pd->cmd_list_length), 0, NULL);
   }
   return TRUE;
@@ -369,14 +789,7 @@ static ModeMode script_mode_result(Mode *sw, int mretv, char **input,
 
   // If a new list was generated, use that an loop around.
   if (new_list != NULL) {
-    for (unsigned int i = 0; i < rmpd->cmd_list_length; i++) {
-      g_free(rmpd->cmd_list[i].entry);
-      g_free(rmpd->cmd_list[i].icon_name);
-      g_free(rmpd->cmd_list[i].display);
-      g_free(rmpd->cmd_list[i].meta);
-      g_free(rmpd->cmd_list[i].info);
-    }
-    g_free(rmpd->cmd_list);
+    script_free_entries(rmpd->cmd_list, rmpd->cmd_list_length);
 
     rmpd->cmd_list = new_list;
     rmpd->cmd_list_length = new_length;
@@ -403,13 +816,9 @@ static ModeMode script_mode_result(Mode *sw, int mretv, char **input,
 static void script_mode_destroy(Mode *sw) {
   ScriptModePrivateData *rmpd = (ScriptModePrivateData *)sw->private_data;
   if (rmpd != NULL) {
-    for (unsigned int i = 0; i < rmpd->cmd_list_length; i++) {
-      g_free(rmpd->cmd_list[i].entry);
-      g_free(rmpd->cmd_list[i].icon_name);
-      g_free(rmpd->cmd_list[i].display);
-      g_free(rmpd->cmd_list[i].meta);
-    }
-    g_free(rmpd->cmd_list);
+    script_coprocess_stop(sw);
+    script_free_entries(rmpd->cmd_list, rmpd->cmd_list_length);
+    g_free(rmpd->last_input);
     g_free(rmpd->message);
     g_free(rmpd->prompt);
     g_free(rmpd->data);
@@ -505,6 +914,18 @@ static int script_token_match(const Mode *sw, rofi_int_matcher **tokens,
   }
   return FALSE;
 }
+static char *script_preprocess_input(Mode *sw, const char *input) {
+  ScriptModePrivateData *pd = (ScriptModePrivateData *)sw->private_data;
+  // No input is also sent, when the user clears it.
+  if (pd->coprocess && pd->input_change &&
+      g_strcmp0(pd->last_input ? pd->last_input : "", input) != 0) {
+    g_free(pd->last_input);
+    pd->last_input = g_strdup(input);
+    // The answer is picked up by the watch, do not block typing.
+    script_coprocess_send(sw, input, 3, NULL);
+  }
+  return g_strdup(input);
+}
 static char *script_get_message(const Mode *sw) {
   ScriptModePrivateData *pd = sw->private_data;
   return g_strdup(pd->message);
@@ -567,14 +988,22 @@ void script_mode_gather_user_scripts(void) {
     const char *file = NULL;
     while ((file = g_dir_read_name(sd)) != NULL) {
       char *sp = g_build_filename(cpath, "rofi", "scripts", file, NULL);
-      user_scripts =
-          g_realloc(user_scripts, sizeof(ScriptUser) * (num_scripts + 1));
-      user_scripts[num_scripts].path = sp;
-      user_scripts[num_scripts].name = g_strdup(file);
-      char *dot = strrchr(user_scripts[num_scripts].name, '.');
+      char *name = g_strdup(file);
+      char *dot = strrchr(name, '.');
       if (dot) {
         *dot = '\0';
       }
+      // Built-in and plugin modes win, also plugins that are not loaded yet.
+      if (rofi_collect_modes_provides(name)) {
+        g_debug("Ignoring script: %s, mode %s already exists.", sp, name);
+        g_free(name);
+        g_free(sp);
+        continue;
+      }
+      user_scripts =
+          g_realloc(user_scripts, sizeof(ScriptUser) * (num_scripts + 1));
+      user_scripts[num_scripts].path = sp;
+      user_scripts[num_scripts].name = name;
       num_scripts++;
     }
     g_dir_close(sd);
@@ -607,7 +1036,8 @@ Mode *script_mode_parse_setup(const char *str) {
     sw->_token_match = script_token_match;
     sw->_get_message = script_get_message;
     sw->_get_icon = script_get_icon;
-    sw->_get_completion = NULL, sw->_preprocess_input = NULL,
+    sw->_get_completion = NULL,
+    sw->_preprocess_input = script_preprocess_input,
     sw->_get_display_value = _get_display_value;
     sw->type = MODE_TYPE_SWITCHER;
     return sw;
@@ -631,7 +1061,8 @@ Mode *script_mode_parse_setup(const char *str) {
     sw->_token_match = script_token_match;
     sw->_get_message = script_get_message;
     sw->_get_icon = script_get_icon;
-    sw->_get_completion = NULL, sw->_preprocess_input = NULL,
+    sw->_get_completion = NULL,
+    sw->_preprocess_input = script_preprocess_input,
     sw->_get_display_value = _get_display_value;
     sw->type = MODE_TYPE_SWITCHER;
 
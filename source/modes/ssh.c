@@ -646,5 +646,5 @@ Mode ssh_mode = {.name = "ssh",
                  ._preprocess_input = NULL,
                  .private_data = NULL,
                  .free = NULL,
-		 .type = MODE_TYPE_SWITCHER };
+		 .type = MODE_TYPE_SWITCHER | MODE_TYPE_THREADED_INIT };
 /**@}*/
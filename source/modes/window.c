@@ -258,6 +258,25 @@ static int winlist_find(winlist *l, xcb_window_t w) {
 
   return -1;
 }
+/**
+ * @param l The winlist.
+ * @param idx The entry to remove.
+ *
+ * Remove the entry, without freeing its data. The order is not kept.
+ *
+ * @returns the data of the removed entry.
+ */
+static client *winlist_remove(winlist *l, int idx) {
+  client *c = l->data[idx];
+  l->len--;
+  l->array[idx] = l->array[l->len];
+  l->data[idx] = l->data[l->len];
+  return c;
+}
+
+/** We listen for property changes on the root window. */
+static gboolean x11_cache_root_events = FALSE;
+
 /**
  * Create empty X11 cache for windows and windows attributes.
  */
@@ -265,36 +284,40 @@ static void x11_cache_create(void) {
   if (cache_client == NULL) {
     cache_client = winlist_new();
   }
+  if (!x11_cache_root_events) {
+    // Updates of the client list, active window and desktops.
+    uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(xcb->connection, xcb_stuff_get_root_window(),
+                                 XCB_CW_EVENT_MASK, &mask);
+    x11_cache_root_events = TRUE;
+  }
 }
 
 /**
  * Free the cache.
  */
 static void x11_cache_free(void) {
+  if (cache_client != NULL) {
+    // Stop the events selected in window_client_request().
+    uint32_t mask = XCB_EVENT_MASK_NO_EVENT;
+    xcb_window_t own = rofi_view_get_window();
+    for (int i = 0; i < cache_client->len; i++) {
+      if (cache_client->array[i] != own) {
+        xcb_change_window_attributes(xcb->connection, cache_client->array[i],
+                                     XCB_CW_EVENT_MASK, &mask);
+      }
+    }
+  }
   winlist_free(cache_client);
   cache_client = NULL;
+  if (x11_cache_root_events) {
+    uint32_t mask = XCB_EVENT_MASK_NO_EVENT;
+    xcb_change_window_attributes(xcb->connection, xcb_stuff_get_root_window(),
+                                 XCB_CW_EVENT_MASK, &mask);
+    x11_cache_root_events = FALSE;
+  }
 }
 
-/**
- * @param d Display connection to X server
- * @param w window
- *
- * Get window attributes.
- * This functions uses caching.
- *
- * @returns a XWindowAttributes
- */
-static xcb_get_window_attributes_reply_t *
-window_get_attributes(xcb_window_t w) {
-  xcb_get_window_attributes_cookie_t c =
-      xcb_get_window_attributes(xcb->connection, w);
-  xcb_get_window_attributes_reply_t *r =
-      xcb_get_window_attributes_reply(xcb->connection, c, NULL);
-  if (r) {
-    return r;
-  }
-  return NULL;
-}
 // _NET_WM_STATE_*
 static int client_has_state(client *c, xcb_atom_t state) {
   for (int i = 0; i < c->states; i++) {
@@ -315,48 +338,115 @@ static int client_has_window_type(client *c, xcb_atom_t type) {
   return 0;
 }
 
-static client *window_client(WindowModePrivateData *pd, xcb_window_t win) {
-  if (win == XCB_WINDOW_NONE) {
-    return NULL;
-  }
-
-  int idx = winlist_find(cache_client, win);
+/**
+ * The outstanding requests for the properties of one client.
+ */
+typedef struct {
+  xcb_window_t window;
+  xcb_get_window_attributes_cookie_t attr;
+  xcb_get_property_cookie_t state;
+  xcb_get_property_cookie_t window_type;
+  xcb_get_property_cookie_t net_wm_name;
+  xcb_get_property_cookie_t wm_name;
+  xcb_get_property_cookie_t role;
+  xcb_get_property_cookie_t wm_class;
+  xcb_get_property_cookie_t hints;
+  xcb_get_property_cookie_t desktop;
+} client_request;
 
-  if (idx >= 0) {
-    return cache_client->data[idx];
+/**
+ * @param win The window to query.
+ * @param rq The requests to fill in.
+ *
+ * Send all requests needed to create the client for win, without waiting for
+ * any reply. Requests for many clients can be sent before collecting the
+ * replies with window_client_collect(), costing a single round trip.
+ */
+static void window_client_request(xcb_window_t win, client_request *rq) {
+  // Get told when the client changes or goes away, so it can be updated.
+  // Not for our own window (-normal-window), this would replace its mask.
+  if (win != rofi_view_get_window()) {
+    uint32_t mask =
+        XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_change_window_attributes(xcb->connection, win, XCB_CW_EVENT_MASK,
+                                 &mask);
   }
+  rq->window = win;
+  rq->attr = xcb_get_window_attributes(xcb->connection, win);
+  rq->state = xcb_ewmh_get_wm_state(&xcb->ewmh, win);
+  rq->window_type = xcb_ewmh_get_wm_window_type(&xcb->ewmh, win);
+  rq->net_wm_name = window_get_text_prop_cookie(win, xcb->ewmh._NET_WM_NAME);
+  rq->wm_name = window_get_text_prop_cookie(win, XCB_ATOM_WM_NAME);
+  rq->role = window_get_text_prop_cookie(win, netatoms[WM_WINDOW_ROLE]);
+  rq->wm_class = xcb_icccm_get_wm_class(xcb->connection, win);
+  rq->hints = xcb_icccm_get_wm_hints(xcb->connection, win);
+  rq->desktop =
+      xcb_get_property(xcb->connection, 0, win, xcb->ewmh._NET_WM_DESKTOP,
+                       XCB_ATOM_CARDINAL, 0, 1);
+}
 
-  // if this fails, we're up that creek
-  xcb_get_window_attributes_reply_t *attr = window_get_attributes(win);
+/**
+ * @param rq The requests to drop.
+ *
+ * Discard the replies of the property requests.
+ */
+static void window_client_discard(client_request *rq) {
+  xcb_discard_reply(xcb->connection, rq->state.sequence);
+  xcb_discard_reply(xcb->connection, rq->window_type.sequence);
+  xcb_discard_reply(xcb->connection, rq->net_wm_name.sequence);
+  xcb_discard_reply(xcb->connection, rq->wm_name.sequence);
+  xcb_discard_reply(xcb->connection, rq->role.sequence);
+  xcb_discard_reply(xcb->connection, rq->wm_class.sequence);
+  xcb_discard_reply(xcb->connection, rq->hints.sequence);
+  xcb_discard_reply(xcb->connection, rq->desktop.sequence);
+}
 
-  if (!attr) {
-    return NULL;
+/**
+ * @param pd The window mode private data.
+ * @param rq The requests sent by window_client_request().
+ *
+ * Collect the replies and add the client to the cache.
+ *
+ * @returns the client, or NULL when the window is gone.
+ */
+static client *window_client_collect(WindowModePrivateData *pd,
+                                     client_request *rq) {
+  // if this fails, we're up that creek
+  xcb_get_window_attributes_reply_t *attr =
+      xcb_get_window_attributes_reply(xcb->connection, rq->attr, NULL);
+  int idx = winlist_find(cache_client, rq->window);
+  if (!attr || idx >= 0) {
+    // Gone, or listed twice.
+    window_client_discard(rq);
+    free(attr);
+    return (idx >= 0) ? cache_client->data[idx] : NULL;
   }
   client *c = g_malloc0(sizeof(client));
-  c->window = win;
+  c->window = rq->window;
 
   // copy xattr so we don't have to care when stuff is freed
   memmove(&c->xattr, attr, sizeof(xcb_get_window_attributes_reply_t));
 
-  xcb_get_property_cookie_t cky = xcb_ewmh_get_wm_state(&xcb->ewmh, win);
   xcb_ewmh_get_atoms_reply_t states;
-  if (xcb_ewmh_get_wm_state_reply(&xcb->ewmh, cky, &states, NULL)) {
+  if (xcb_ewmh_get_wm_state_reply(&xcb->ewmh, rq->state, &states, NULL)) {
     c->states = MIN(CLIENTSTATE, states.atoms_len);
     memcpy(c->state, states.atoms,
            MIN(CLIENTSTATE, states.atoms_len) * sizeof(xcb_atom_t));
     xcb_ewmh_get_atoms_reply_wipe(&states);
   }
-  cky = xcb_ewmh_get_wm_window_type(&xcb->ewmh, win);
-  if (xcb_ewmh_get_wm_window_type_reply(&xcb->ewmh, cky, &states, NULL)) {
+  if (xcb_ewmh_get_wm_window_type_reply(&xcb->ewmh, rq->window_type, &states,
+                                        NULL)) {
     c->window_types = MIN(CLIENTWINDOWTYPE, states.atoms_len);
     memcpy(c->window_type, states.atoms,
            MIN(CLIENTWINDOWTYPE, states.atoms_len) * sizeof(xcb_atom_t));
     xcb_ewmh_get_atoms_reply_wipe(&states);
   }
 
-  char *tmp_title = window_get_text_prop(c->window, xcb->ewmh._NET_WM_NAME);
+  char *tmp_title = window_get_text_prop_reply(rq->net_wm_name);
   if (tmp_title == NULL) {
-    tmp_title = window_get_text_prop(c->window, XCB_ATOM_WM_NAME);
+    tmp_title = window_get_text_prop_reply(rq->wm_name);
+  } else {
+    xcb_discard_reply(xcb->connection, rq->wm_name.sequence);
   }
   if (tmp_title != NULL) {
     c->title = g_markup_escape_text(tmp_title, -1);
@@ -367,27 +457,37 @@ static client *window_client(WindowModePrivateData *pd, xcb_window_t win) {
       MAX(c->title ? g_utf8_strlen(c->title, -1) : 0, pd->title_len);
   g_free(tmp_title);
 
-  char *tmp_role = window_get_text_prop(c->window, netatoms[WM_WINDOW_ROLE]);
+  char *tmp_role = window_get_text_prop_reply(rq->role);
   c->role = g_markup_escape_text(tmp_role ? tmp_role : "", -1);
   pd->role_len = MAX(c->role ? g_utf8_strlen(c->role, -1) : 0, pd->role_len);
   g_free(tmp_role);
 
-  cky = xcb_icccm_get_wm_class(xcb->connection, c->window);
   xcb_icccm_get_wm_class_reply_t wcr;
-  if (xcb_icccm_get_wm_class_reply(xcb->connection, cky, &wcr, NULL)) {
+  if (xcb_icccm_get_wm_class_reply(xcb->connection, rq->wm_class, &wcr,
+                                   NULL)) {
     c->class = g_markup_escape_text(wcr.class_name, -1);
     c->name = g_markup_escape_text(wcr.instance_name, -1);
     pd->name_len = MAX(c->name ? g_utf8_strlen(c->name, -1) : 0, pd->name_len);
     xcb_icccm_get_wm_class_reply_wipe(&wcr);
   }
 
-  xcb_get_property_cookie_t cc =
-      xcb_icccm_get_wm_hints(xcb->connection, c->window);
   xcb_icccm_wm_hints_t r;
-  if (xcb_icccm_get_wm_hints_reply(xcb->connection, cc, &r, NULL)) {
+  if (xcb_icccm_get_wm_hints_reply(xcb->connection, rq->hints, &r, NULL)) {
     c->hint_flags = r.flags;
   }
 
+  // find client's desktop.
+  c->wmdesktop = 0xFFFFFFFF;
+  xcb_get_property_reply_t *dr =
+      xcb_get_property_reply(xcb->connection, rq->desktop, NULL);
+  if (dr) {
+    if (dr->type == XCB_ATOM_CARDINAL &&
+        xcb_get_property_value_length(dr) >= (int)sizeof(uint32_t)) {
+      c->wmdesktop = *((uint32_t *)xcb_get_property_value(dr));
+    }
+    free(dr);
+  }
+
   idx = winlist_append(cache_client, c->window, c);
   // Should never happen.
   if (idx < 0) {
@@ -395,34 +495,147 @@ static client *window_client(WindowModePrivateData *pd, xcb_window_t win) {
     g_free(c);
     c = NULL;
   }
-  g_free(attr);
+  free(attr);
   return c;
 }
 
+static client *window_client(WindowModePrivateData *pd, xcb_window_t win) {
+  if (win == XCB_WINDOW_NONE) {
+    return NULL;
+  }
+
+  int idx = winlist_find(cache_client, win);
+
+  if (idx >= 0) {
+    return cache_client->data[idx];
+  }
+  client_request rq;
+  window_client_request(win, &rq);
+  return window_client_collect(pd, &rq);
+}
+
+static void _window_mode_load_data(Mode *sw, unsigned int cd);
+
 guint window_reload_timeout = 0;
+/** Clients that changed since the last update. */
+static GArray *window_dirty_clients = NULL;
+
+/**
+ * @param old The client before the update.
+ * @param c The updated client.
+ *
+ * Keep the icon of the client, it is not affected by the tracked properties.
+ */
+static void window_client_keep_icon(client *old, client *c) {
+  c->icon = old->icon;
+  c->icon_checked = old->icon_checked;
+  c->icon_fetch_uid = old->icon_fetch_uid;
+  c->icon_fetch_size = old->icon_fetch_size;
+  c->icon_fetch_scale = old->icon_fetch_scale;
+  c->thumbnail_checked = old->thumbnail_checked;
+  c->icon_theme_checked = old->icon_theme_checked;
+  old->icon = NULL;
+}
+
+/**
+ * Update the window list after X events: only the changed and new clients
+ * are queried again, the others are reused from the cache.
+ */
 static gboolean window_client_reload(G_GNUC_UNUSED void *data) {
   window_reload_timeout = 0;
-  if (window_mode.private_data) {
-    window_mode._destroy(&window_mode);
-    window_mode._init(&window_mode);
+  if (cache_client == NULL ||
+      (window_mode.private_data == NULL && window_mode_cd.private_data == NULL)) {
+    g_array_set_size(window_dirty_clients, 0);
+    return G_SOURCE_REMOVE;
   }
-  if (window_mode_cd.private_data) {
-    window_mode_cd._destroy(&window_mode_cd);
-    window_mode_cd._init(&window_mode_cd);
+  TIMINGS_SPAN_BEGIN("window update");
+  // Take the changed clients out of the cache, so they are queried again.
+  GList *old = NULL;
+  for (guint i = 0; i < window_dirty_clients->len; i++) {
+    int idx = winlist_find(
+        cache_client, g_array_index(window_dirty_clients, xcb_window_t, i));
+    if (idx >= 0) {
+      old = g_list_prepend(old, winlist_remove(cache_client, idx));
+    }
+  }
+  g_array_set_size(window_dirty_clients, 0);
+
+  Mode *modes[] = {&window_mode, &window_mode_cd};
+  for (unsigned int i = 0; i < G_N_ELEMENTS(modes); i++) {
+    WindowModePrivateData *pd =
+        (WindowModePrivateData *)mode_get_private_data(modes[i]);
+    if (pd != NULL) {
+      winlist_free(pd->ids);
+      pd->ids = NULL;
+      _window_mode_load_data(modes[i], modes[i] == &window_mode_cd);
+    }
   }
-  if (window_mode.private_data || window_mode_cd.private_data) {
-    rofi_view_reload();
+
+  for (GList *iter = g_list_first(old); iter != NULL;
+       iter = g_list_next(iter)) {
+    client *c = (client *)iter->data;
+    int idx = winlist_find(cache_client, c->window);
+    if (idx >= 0) {
+      window_client_keep_icon(c, cache_client->data[idx]);
+    }
+    client_free(c);
+    g_free(c);
   }
+  g_list_free(old);
+  TIMINGS_SPAN_END("window update");
+  rofi_view_reload();
   return G_SOURCE_REMOVE;
 }
-void window_client_handle_signal(G_GNUC_UNUSED xcb_window_t win,
-                                 G_GNUC_UNUSED gboolean create) {
-  //  g_idle_add_full(G_PRIORITY_HIGH_IDLE, window_client_reload, NULL, NULL);
-  if (window_reload_timeout > 0) {
-    g_source_remove(window_reload_timeout);
-    window_reload_timeout = 0;
-  }
-  window_reload_timeout = g_timeout_add(100, window_client_reload, NULL);
+
+/**
+ * @param win The changed client, or XCB_WINDOW_NONE when only the list
+ * changed.
+ *
+ * Schedule an update of the window list.
+ */
+static void window_client_queue_update(xcb_window_t win) {
+  if (cache_client == NULL) {
+    return;
+  }
+  if (window_dirty_clients == NULL) {
+    window_dirty_clients = g_array_new(FALSE, FALSE, sizeof(xcb_window_t));
+  }
+  if (win != XCB_WINDOW_NONE && winlist_find(cache_client, win) >= 0) {
+    g_array_append_val(window_dirty_clients, win);
+  }
+  // Batch bursts of events.
+  if (window_reload_timeout == 0) {
+    window_reload_timeout = g_timeout_add(100, window_client_reload, NULL);
+  }
+}
+
+void window_client_handle_signal(xcb_window_t win, gboolean create) {
+  // A destroyed client is dropped, a created one is picked up when it shows
+  // up in the client list.
+  window_client_queue_update(create ? XCB_WINDOW_NONE : win);
+}
+
+void window_client_handle_property(xcb_window_t win, xcb_atom_t atom) {
+  if (cache_client == NULL) {
+    return;
+  }
+  if (win == xcb_stuff_get_root_window()) {
+    if (atom == xcb->ewmh._NET_CLIENT_LIST ||
+        atom == xcb->ewmh._NET_CLIENT_LIST_STACKING ||
+        atom == xcb->ewmh._NET_ACTIVE_WINDOW ||
+        atom == xcb->ewmh._NET_CURRENT_DESKTOP ||
+        atom == xcb->ewmh._NET_DESKTOP_NAMES) {
+      window_client_queue_update(XCB_WINDOW_NONE);
+    }
+    return;
+  }
+  if (atom == xcb->ewmh._NET_WM_NAME || atom == XCB_ATOM_WM_NAME ||
+      atom == XCB_ATOM_WM_CLASS || atom == netatoms[WM_WINDOW_ROLE] ||
+      atom == xcb->ewmh._NET_WM_STATE || atom == XCB_ATOM_WM_HINTS ||
+      atom == xcb->ewmh._NET_WM_DESKTOP ||
+      atom == xcb->ewmh._NET_WM_WINDOW_TYPE) {
+    window_client_queue_update(win);
+  }
 }
 static int window_match(const Mode *sw, rofi_int_matcher **tokens,
                         unsigned int index) {
@@ -548,26 +761,32 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
   // Create cache
 
   x11_cache_create();
+  // Send the requests up front, so the replies arrive in one round trip.
   xcb_get_property_cookie_t c =
       xcb_ewmh_get_active_window(&(xcb->ewmh), xcb->screen_nbr);
+  xcb_get_property_cookie_t desktop_cookie =
+      xcb_ewmh_get_current_desktop(&xcb->ewmh, xcb->screen_nbr);
+  xcb_get_property_cookie_t list_cookie =
+      xcb_ewmh_get_client_list_stacking(&xcb->ewmh, xcb->screen_nbr);
+  xcb_get_property_cookie_t prop_cookie =
+      xcb_ewmh_get_desktop_names(&xcb->ewmh, xcb->screen_nbr);
   if (!xcb_ewmh_get_active_window_reply(&xcb->ewmh, c, &curr_win_id, NULL)) {
     curr_win_id = 0;
   }
 
   // Get the current desktop.
   unsigned int current_desktop = 0;
-  c = xcb_ewmh_get_current_desktop(&xcb->ewmh, xcb->screen_nbr);
-  if (!xcb_ewmh_get_current_desktop_reply(&xcb->ewmh, c, &current_desktop,
-                                          NULL)) {
+  if (!xcb_ewmh_get_current_desktop_reply(&xcb->ewmh, desktop_cookie,
+                                          &current_desktop, NULL)) {
     current_desktop = 0;
   }
 
   g_debug("Get list from: %d", xcb->screen_nbr);
-  c = xcb_ewmh_get_client_list_stacking(&xcb->ewmh, xcb->screen_nbr);
   xcb_ewmh_get_windows_reply_t clients = {
       0,
   };
-  if (xcb_ewmh_get_client_list_stacking_reply(&xcb->ewmh, c, &clients, NULL)) {
+  if (xcb_ewmh_get_client_list_stacking_reply(&xcb->ewmh, list_cookie,
+                                              &clients, NULL)) {
     found = 1;
   } else {
     c = xcb_ewmh_get_client_list(&xcb->ewmh, xcb->screen_nbr);
@@ -575,7 +794,21 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
       found = 1;
     }
   }
+
+  int has_names = FALSE;
+  ssize_t ws_names_length = 0;
+  char *ws_names = NULL;
+  xcb_ewmh_get_utf8_strings_reply_t names;
+  if (xcb_ewmh_get_desktop_names_reply(&xcb->ewmh, prop_cookie, &names,
+                                       NULL)) {
+    ws_names_length = names.strings_len;
+    ws_names = g_malloc0_n(names.strings_len + 1, sizeof(char));
+    memcpy(ws_names, names.strings, names.strings_len);
+    has_names = TRUE;
+    xcb_ewmh_get_utf8_strings_reply_wipe(&names);
+  }
   if (!found) {
+    g_free(ws_names);
     return;
   }
 
@@ -586,20 +819,23 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
     // we're working...
     pd->ids = winlist_new();
 
-    int has_names = FALSE;
-    ssize_t ws_names_length = 0;
-    char *ws_names = NULL;
-    xcb_get_property_cookie_t prop_cookie =
-        xcb_ewmh_get_desktop_names(&xcb->ewmh, xcb->screen_nbr);
-    xcb_ewmh_get_utf8_strings_reply_t names;
-    if (xcb_ewmh_get_desktop_names_reply(&xcb->ewmh, prop_cookie, &names,
-                                         NULL)) {
-      ws_names_length = names.strings_len;
-      ws_names = g_malloc0_n(names.strings_len + 1, sizeof(char));
-      memcpy(ws_names, names.strings, names.strings_len);
-      has_names = TRUE;
-      xcb_ewmh_get_utf8_strings_reply_wipe(&names);
+    // Request the properties of all new clients before waiting on any reply.
+    TIMINGS_SPAN_BEGIN("window query clients");
+    client_request *requests =
+        g_malloc_n(clients.windows_len, sizeof(client_request));
+    unsigned int num_requests = 0;
+    for (i = clients.windows_len - 1; i > -1; i--) {
+      if (clients.windows[i] != XCB_WINDOW_NONE &&
+          winlist_find(cache_client, clients.windows[i]) < 0) {
+        window_client_request(clients.windows[i], &requests[num_requests++]);
+      }
+    }
+    for (unsigned int j = 0; j < num_requests; j++) {
+      window_client_collect(pd, &requests[j]);
     }
+    g_free(requests);
+    TIMINGS_SPAN_END("window query clients");
+
     // calc widths of fields
     for (i = clients.windows_len - 1; i > -1; i--) {
       client *winclient = window_client(pd, clients.windows[i]);
@@ -615,32 +851,16 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
                                  ? (g_utf8_strlen(winclient->class, -1))
                                  : 0);
 
-        if (client_has_state(winclient,
-                             xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION)) {
-          winclient->demands = TRUE;
-        }
-        if ((winclient->hint_flags & XCB_ICCCM_WM_HINT_X_URGENCY) != 0) {
-          winclient->demands = TRUE;
-        }
-
-        if (winclient->window == curr_win_id) {
-          winclient->active = TRUE;
-        }
-        // find client's desktop.
-        xcb_get_property_cookie_t cookie;
-        xcb_get_property_reply_t *r;
+        // Cached clients are reused on updates, so (re)set these.
+        winclient->demands =
+            client_has_state(winclient,
+                             xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION) ||
+            (winclient->hint_flags & XCB_ICCCM_WM_HINT_X_URGENCY) != 0;
 
-        winclient->wmdesktop = 0xFFFFFFFF;
-        cookie = xcb_get_property(xcb->connection, 0, winclient->window,
-                                  xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL,
-                                  0, 1);
-        r = xcb_get_property_reply(xcb->connection, cookie, NULL);
-        if (r) {
-          if (r->type == XCB_ATOM_CARDINAL) {
-            winclient->wmdesktop = *((uint32_t *)xcb_get_property_value(r));
-          }
-          free(r);
-        }
+        winclient->active = (winclient->window == curr_win_id);
+        // The client's desktop was fetched with its other properties.
+        g_free(winclient->wmdesktopstr);
+        winclient->wmdesktopstr = NULL;
         if (winclient->wmdesktop != 0xFFFFFFFF) {
           if (has_names) {
             if ((current_window_manager & WM_PANGO_WORKSPACE_NAMES) ==
@@ -691,11 +911,8 @@ static void _window_mode_load_data(Mode *sw, unsigned int cd) {
         }
       }
     }
-
-    if (has_names) {
-      g_free(ws_names);
-    }
   }
+  g_free(ws_names);
   xcb_ewmh_get_windows_reply_wipe(&clients);
 }
 static int window_mode_init(Mode *sw) {
@@ -868,6 +1085,14 @@ static void window_mode_destroy(Mode *sw) {
   if (rmpd != NULL) {
     winlist_free(rmpd->ids);
     x11_cache_free();
+    if (window_reload_timeout > 0) {
+      g_source_remove(window_reload_timeout);
+      window_reload_timeout = 0;
+    }
+    if (window_dirty_clients != NULL) {
+      g_array_free(window_dirty_clients, TRUE);
+      window_dirty_clients = NULL;
+    }
     g_free(rmpd->cache);
     g_regex_unref(rmpd->window_regex);
     g_free(rmpd);
@@ -0,0 +1,480 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2023 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/** The log domain of this Helper. */
+#define G_LOG_DOMAIN "Helpers.Daemon"
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+
+#include "helper.h"
+#include "rofi-daemon.h"
+
+/** Name of the daemon socket in the user runtime directory. */
+#define DAEMON_SOCKET_NAME "rofi-daemon.sock"
+/** Name of the daemon lock file in the user runtime directory. */
+#define DAEMON_PID_NAME "rofi-daemon.pid"
+/** Upper limit on the size of a request. */
+#define DAEMON_MAX_REQUEST 16384
+
+/** Environment of the client applied to the commands launched for it. */
+static const char *const daemon_forward_env[] = {
+    "PWD",
+    "DISPLAY",
+    "WAYLAND_DISPLAY",
+    "XDG_ACTIVATION_TOKEN",
+    "DESKTOP_STARTUP_ID",
+    NULL,
+};
+
+/**
+ * A connected client.
+ */
+typedef struct {
+  /** Socket of the connection. */
+  int fd;
+  /** Watch while the request is being read. */
+  guint watch;
+  /** The request read so far. */
+  GString *buffer;
+  /** The requested mode. */
+  char *mode;
+  /** The requested filter, or NULL. */
+  char *filter;
+  /** Working directory of the client, or NULL. */
+  char *cwd;
+  /** Forwarded environment of the client, see #daemon_forward_env. */
+  char **env;
+} DaemonClient;
+
+/**
+ * State of the daemon.
+ */
+typedef struct {
+  /** Lock file, see create_pid_file(). */
+  int pid_fd;
+  /** Listening socket. */
+  int listen_fd;
+  /** Watch on the listening socket. */
+  guint listen_watch;
+  /** Path of the listening socket. */
+  char *socket_path;
+  /** Called for each request. */
+  RofiDaemonShowFunc show;
+  /** Clients that are still sending their request. */
+  GList *reading;
+  /** Clients waiting for their window to be shown. */
+  GQueue pending;
+  /** Client that requested the current window. */
+  DaemonClient *active;
+  /** Idle source that starts the next pending request. */
+  guint next_source;
+} DaemonState;
+
+static DaemonState daemon_state = {
+    .pid_fd = -1,
+    .listen_fd = -1,
+    .listen_watch = 0,
+    .socket_path = NULL,
+    .show = NULL,
+    .reading = NULL,
+    .pending = G_QUEUE_INIT,
+    .active = NULL,
+    .next_source = 0,
+};
+
+static char *rofi_daemon_path(const char *name) {
+  return g_build_filename(g_get_user_runtime_dir(), name, NULL);
+}
+
+static gboolean rofi_daemon_set_flags(int fd) {
+  if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+    return FALSE;
+  }
+  int flags = fcntl(fd, F_GETFL);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+static void rofi_daemon_client_free(DaemonClient *client) {
+  if (client->watch > 0) {
+    g_source_remove(client->watch);
+  }
+  if (client->fd >= 0) {
+    close(client->fd);
+  }
+  g_string_free(client->buffer, TRUE);
+  g_free(client->mode);
+  g_free(client->filter);
+  g_free(client->cwd);
+  g_strfreev(client->env);
+  g_free(client);
+}
+
+static void rofi_daemon_client_reply(DaemonClient *client, int exit_code) {
+  char buffer[32];
+  int length = snprintf(buffer, sizeof(buffer), "%d\n", exit_code);
+  // The client might have gone away, do not get killed by SIGPIPE.
+  if (send(client->fd, buffer, length, MSG_NOSIGNAL) != length) {
+    g_debug("Failed to reply to client: %s", g_strerror(errno));
+  }
+}
+
+static gboolean rofi_daemon_env_forwarded(const char *name) {
+  for (unsigned int i = 0; daemon_forward_env[i] != NULL; i++) {
+    if (g_strcmp0(daemon_forward_env[i], name) == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+ * @param client The client to show the window for.
+ *
+ * Launch commands from the working directory and environment of the client.
+ * Variables the client did not set are removed, so nothing leaks from the
+ * previous client.
+ */
+static void rofi_daemon_client_apply(DaemonClient *client) {
+  if (client->cwd != NULL && g_chdir(client->cwd) != 0) {
+    g_warning("Failed to change to the client directory '%s': %s",
+              client->cwd, g_strerror(errno));
+  }
+  for (unsigned int i = 0; daemon_forward_env[i] != NULL; i++) {
+    const char *value = g_environ_getenv(client->env, daemon_forward_env[i]);
+    if (value != NULL) {
+      g_setenv(daemon_forward_env[i], value, TRUE);
+    } else {
+      g_unsetenv(daemon_forward_env[i]);
+    }
+  }
+}
+
+static gboolean rofi_daemon_next(G_GNUC_UNUSED gpointer data) {
+  daemon_state.next_source = 0;
+  if (daemon_state.active != NULL || g_queue_is_empty(&daemon_state.pending)) {
+    return G_SOURCE_REMOVE;
+  }
+  daemon_state.active = g_queue_pop_head(&daemon_state.pending);
+  g_debug("Show mode '%s' for client.", daemon_state.active->mode);
+  rofi_daemon_client_apply(daemon_state.active);
+  daemon_state.show(daemon_state.active->mode, daemon_state.active->filter);
+  return G_SOURCE_REMOVE;
+}
+
+static void rofi_daemon_schedule_next(void) {
+  if (daemon_state.next_source == 0) {
+    daemon_state.next_source = g_idle_add(rofi_daemon_next, NULL);
+  }
+}
+
+/**
+ * Parse the request: a `show <mode>` line, an optional `filter <text>` line,
+ * an optional `cwd <path>` line and `env <name>=<value>` lines, terminated by
+ * an empty line.
+ *
+ * @returns TRUE when the request is complete.
+ */
+static gboolean rofi_daemon_client_parse(DaemonClient *client) {
+  if (!g_str_has_suffix(client->buffer->str, "\n\n")) {
+    return FALSE;
+  }
+  char **lines = g_strsplit(client->buffer->str, "\n", -1);
+  for (int i = 0; lines[i] != NULL; i++) {
+    if (g_str_has_prefix(lines[i], "show ")) {
+      g_free(client->mode);
+      client->mode = g_strdup(lines[i] + strlen("show "));
+    } else if (g_str_has_prefix(lines[i], "filter ")) {
+      g_free(client->filter);
+      client->filter = g_strdup(lines[i] + strlen("filter "));
+    } else if (g_str_has_prefix(lines[i], "cwd ")) {
+      g_free(client->cwd);
+      client->cwd = g_strdup(lines[i] + strlen("cwd "));
+    } else if (g_str_has_prefix(lines[i], "env ")) {
+      char **kv = g_strsplit(lines[i] + strlen("env "), "=", 2);
+      // Only the variables that are meant for the launched commands.
+      if (kv[0] != NULL && kv[1] != NULL && rofi_daemon_env_forwarded(kv[0])) {
+        client->env = g_environ_setenv(client->env, kv[0], kv[1], TRUE);
+      }
+      g_strfreev(kv);
+    }
+  }
+  g_strfreev(lines);
+  return TRUE;
+}
+
+static gboolean rofi_daemon_client_read(int fd,
+                                        G_GNUC_UNUSED GIOCondition condition,
+                                        gpointer user_data) {
+  DaemonClient *client = (DaemonClient *)user_data;
+  char buffer[512];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  if (length < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return G_SOURCE_CONTINUE;
+  }
+  if (length > 0) {
+    g_string_append_len(client->buffer, buffer, length);
+  }
+  gboolean complete = rofi_daemon_client_parse(client);
+  if (!complete && length > 0 && client->buffer->len < DAEMON_MAX_REQUEST) {
+    return G_SOURCE_CONTINUE;
+  }
+
+  client->watch = 0;
+  daemon_state.reading = g_list_remove(daemon_state.reading, client);
+  if (!complete || client->mode == NULL) {
+    g_warning("Dropping malformed daemon request.");
+    rofi_daemon_client_reply(client, EXIT_FAILURE);
+    rofi_daemon_client_free(client);
+    return G_SOURCE_REMOVE;
+  }
+  g_queue_push_tail(&daemon_state.pending, client);
+  rofi_daemon_schedule_next();
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean rofi_daemon_accept(int fd, G_GNUC_UNUSED GIOCondition condition,
+                                   G_GNUC_UNUSED gpointer user_data) {
+  int cfd = accept(fd, NULL, NULL);
+  if (cfd < 0) {
+    if (errno != EAGAIN && errno != EINTR) {
+      g_warning("Failed to accept daemon client: %s", g_strerror(errno));
+    }
+    return G_SOURCE_CONTINUE;
+  }
+  if (!rofi_daemon_set_flags(cfd)) {
+    g_warning("Failed to set flags on daemon client: %s", g_strerror(errno));
+    close(cfd);
+    return G_SOURCE_CONTINUE;
+  }
+  DaemonClient *client = g_malloc0(sizeof(DaemonClient));
+  client->fd = cfd;
+  client->buffer = g_string_new(NULL);
+  client->watch = g_unix_fd_add(cfd, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                rofi_daemon_client_read, client);
+  daemon_state.reading = g_list_prepend(daemon_state.reading, client);
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean rofi_daemon_lock(gboolean replace) {
+  char *path = rofi_daemon_path(DAEMON_PID_NAME);
+  daemon_state.pid_fd = create_pid_file(path, replace);
+  g_free(path);
+  return daemon_state.pid_fd >= 0;
+}
+
+gboolean rofi_daemon_start(RofiDaemonShowFunc show) {
+  g_return_val_if_fail(daemon_state.pid_fd >= 0, FALSE);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  daemon_state.show = show;
+  daemon_state.socket_path = rofi_daemon_path(DAEMON_SOCKET_NAME);
+  if (strlen(daemon_state.socket_path) >= sizeof(addr.sun_path)) {
+    g_warning("Daemon socket path is too long: '%s'", daemon_state.socket_path);
+    return FALSE;
+  }
+  g_strlcpy(addr.sun_path, daemon_state.socket_path, sizeof(addr.sun_path));
+
+  daemon_state.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (daemon_state.listen_fd < 0 ||
+      !rofi_daemon_set_flags(daemon_state.listen_fd)) {
+    g_warning("Failed to create daemon socket: %s", g_strerror(errno));
+    return FALSE;
+  }
+  // We hold the lock, so a socket left behind is from a daemon that died.
+  g_unlink(daemon_state.socket_path);
+  if (bind(daemon_state.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) <
+          0 ||
+      listen(daemon_state.listen_fd, 8) < 0) {
+    g_warning("Failed to listen on '%s': %s", daemon_state.socket_path,
+              g_strerror(errno));
+    return FALSE;
+  }
+  daemon_state.listen_watch = g_unix_fd_add(daemon_state.listen_fd, G_IO_IN,
+                                            rofi_daemon_accept, NULL);
+  g_debug("Daemon listening on '%s'", daemon_state.socket_path);
+  return TRUE;
+}
+
+void rofi_daemon_stop(void) {
+  if (daemon_state.next_source > 0) {
+    g_source_remove(daemon_state.next_source);
+    daemon_state.next_source = 0;
+  }
+  if (daemon_state.listen_watch > 0) {
+    g_source_remove(daemon_state.listen_watch);
+    daemon_state.listen_watch = 0;
+  }
+  if (daemon_state.listen_fd >= 0) {
+    close(daemon_state.listen_fd);
+    daemon_state.listen_fd = -1;
+    g_unlink(daemon_state.socket_path);
+  }
+  g_free(daemon_state.socket_path);
+  daemon_state.socket_path = NULL;
+
+  g_list_free_full(daemon_state.reading,
+                   (GDestroyNotify)rofi_daemon_client_free);
+  daemon_state.reading = NULL;
+  DaemonClient *client = NULL;
+  while ((client = g_queue_pop_head(&daemon_state.pending)) != NULL) {
+    rofi_daemon_client_reply(client, EXIT_FAILURE);
+    rofi_daemon_client_free(client);
+  }
+  if (daemon_state.active != NULL) {
+    rofi_daemon_client_reply(daemon_state.active, EXIT_FAILURE);
+    rofi_daemon_client_free(daemon_state.active);
+    daemon_state.active = NULL;
+  }
+
+  remove_pid_file(daemon_state.pid_fd);
+  daemon_state.pid_fd = -1;
+}
+
+gboolean rofi_daemon_session_active(void) {
+  return daemon_state.active != NULL;
+}
+
+void rofi_daemon_session_finish(int exit_code) {
+  if (daemon_state.active == NULL) {
+    return;
+  }
+  rofi_daemon_client_reply(daemon_state.active, exit_code);
+  rofi_daemon_client_free(daemon_state.active);
+  daemon_state.active = NULL;
+  rofi_daemon_schedule_next();
+}
+
+int rofi_daemon_forward(int argc, char **argv) {
+  const char *mode = NULL;
+  const char *filter = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (mode == NULL && (i + 1) < argc && g_strcmp0(argv[i], "-show") == 0) {
+      mode = argv[++i];
+    } else if (filter == NULL && (i + 1) < argc &&
+               g_strcmp0(argv[i], "-filter") == 0) {
+      filter = argv[++i];
+    } else {
+      // Anything else needs a full rofi.
+      return -1;
+    }
+  }
+  if (mode == NULL || strchr(mode, '\n') != NULL ||
+      (filter != NULL && strchr(filter, '\n') != NULL)) {
+    return -1;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  char *path = rofi_daemon_path(DAEMON_SOCKET_NAME);
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    g_free(path);
+    return -1;
+  }
+  g_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+  g_free(path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    // No daemon running.
+    close(fd);
+    return -1;
+  }
+
+  GString *request = g_string_new(NULL);
+  g_string_append_printf(request, "show %s\n", mode);
+  if (filter != NULL) {
+    g_string_append_printf(request, "filter %s\n", filter);
+  }
+  // Commands launched by the daemon should run like they were launched here.
+  char *cwd = g_get_current_dir();
+  if (strchr(cwd, '\n') == NULL) {
+    g_string_append_printf(request, "cwd %s\n", cwd);
+  }
+  g_free(cwd);
+  for (unsigned int i = 0; daemon_forward_env[i] != NULL; i++) {
+    const char *value = g_getenv(daemon_forward_env[i]);
+    if (value != NULL && strchr(value, '\n') == NULL) {
+      g_string_append_printf(request, "env %s=%s\n", daemon_forward_env[i],
+                             value);
+    }
+  }
+  g_string_append_c(request, '\n');
+  gsize offset = 0;
+  while (offset < request->len) {
+    ssize_t l = send(fd, request->str + offset, request->len - offset,
+                     MSG_NOSIGNAL);
+    if (l < 0 && errno == EINTR) {
+      continue;
+    }
+    if (l <= 0) {
+      g_string_free(request, TRUE);
+      close(fd);
+      return -1;
+    }
+    offset += l;
+  }
+  g_string_free(request, TRUE);
+
+  // Wait for the window to be closed.
+  char buffer[32] = {
+      0,
+  };
+  size_t length = 0;
+  while (length < (sizeof(buffer) - 1)) {
+    ssize_t l = read(fd, buffer + length, sizeof(buffer) - 1 - length);
+    if (l < 0 && errno == EINTR) {
+      continue;
+    }
+    if (l <= 0) {
+      break;
+    }
+    length += l;
+  }
+  close(fd);
+  if (length == 0) {
+    g_warning("Rofi daemon closed the connection without reply.");
+    return EXIT_FAILURE;
+  }
+  return (int)g_ascii_strtoll(buffer, NULL, 10);
+}
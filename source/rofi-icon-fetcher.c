@@ -29,12 +29,16 @@
 #define G_LOG_DOMAIN "Helpers.IconFetcher"
 
 #include "config.h"
+#include <errno.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "helper.h"
 #include "rofi-icon-fetcher.h"
 #include "rofi-types.h"
 #include "settings.h"
+#include "timings.h"
 #include <cairo.h>
 #include <pango/pangocairo.h>
 
@@ -49,6 +53,7 @@
 
 #include "helper.h"
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib/gstdio.h>
 
 // thumbnailers key file's group and file extension
 #define THUMBNAILER_ENTRY_GROUP "Thumbnailer Entry"
@@ -69,6 +74,30 @@ typedef struct {
   
   // thumbnailers per mime-types hashmap
   GHashTable *thumbnailers;
+
+  // Thumbnail generation pool, protected by thumbnail_lock.
+  GMutex thumbnail_lock;
+  // In-flight and queued jobs on output path.
+  GHashTable *thumbnail_jobs;
+  // Jobs waiting for a free slot.
+  GQueue thumbnail_queue;
+  // Number of running thumbnailer processes.
+  unsigned int thumbnail_running;
+  // Idle source that starts queued jobs.
+  guint thumbnail_dispatch;
+  // Jobs handed to rofi_icon_fetcher_thumbnail_finalize() not released yet.
+  unsigned int thumbnail_finalizing;
+  // Signalled when such a job is released.
+  GCond thumbnail_cond;
+
+  // Loaded surfaces, most recently used first, protected by cache_lock.
+  GMutex cache_lock;
+  GQueue cache_lru;
+  // Bytes used by the surfaces in cache_lru.
+  size_t cache_size;
+  // Maximum bytes, 0 is unlimited.
+  size_t cache_budget;
+  RofiIconFetcherStats stats;
 } IconFetcher;
 
 typedef struct {
@@ -90,10 +119,40 @@ typedef struct {
   cairo_surface_t *surface;
   gboolean query_done;
   gboolean query_started;
+  // Thumbnailer already ran for this entry (successful or not).
+  gboolean thumbnail_done;
+  // Surface was dropped to stay within the cache budget.
+  gboolean evicted;
+  // Position in the lru list, NULL when no surface.
+  GList *lru_link;
+  size_t surface_size;
 
   IconFetcherNameEntry *entry;
 } IconFetcherEntry;
 
+typedef struct {
+  // Used to run the post-processing on the thread pool.
+  thread_state state;
+
+  gchar **command_args;
+  // Final location in the thumbnail cache.
+  gchar *output_path;
+  // Location the thumbnailer writes to.
+  gchar *tmp_path;
+  // Source uri and file, NULL for custom preview commands.
+  gchar *uri;
+  gchar *filename;
+
+  GPid pid;
+  guint watch;
+  gboolean success;
+  // Handed to rofi_icon_fetcher_thumbnail_finalize(), which frees it.
+  gboolean finalizing;
+
+  // IconFetcherEntry's waiting on this thumbnail.
+  GList *waiters;
+} ThumbnailJob;
+
 // Free method.
 static void rofi_icon_fetch_entry_free(gpointer data);
 /**
@@ -201,48 +260,410 @@ static gchar** setup_thumbnailer_command(const gchar *command,
   return command_args;
 }
 
-static gboolean exec_thumbnailer_command(gchar **command_args) {
-  // launch and wait thumbnailers process
-  gint wait_status;
+/*
+ * Thumbnail generation.
+ *
+ * Thumbnailers are external processes, they are started from the main loop and
+ * tracked with a child watch so no thread of the pool is blocked waiting on
+ * them. Requests for the same output file are merged, and at most
+ * config.max_thumbnailers processes run at the same time.
+ */
+static gchar *rofi_icon_fetcher_thumbnail_tmp_path(const gchar *output_path) {
+  // Keep the extension, some thumbnailers pick the format based on it.
+  return g_strdup_printf("%s.rofi-%d.tmp.png", output_path, (int)getpid());
+}
+
+static void rofi_icon_fetcher_thumbnail_job_free(ThumbnailJob *job) {
+  g_strfreev(job->command_args);
+  g_free(job->output_path);
+  g_free(job->tmp_path);
+  g_free(job->uri);
+  g_free(job->filename);
+  g_list_free(job->waiters);
+  g_free(job);
+}
+
+// Move the generated thumbnail into the cache, adding the metadata the
+// freedesktop thumbnail specification requires for file thumbnails.
+static gboolean rofi_icon_fetcher_thumbnail_store(ThumbnailJob *job) {
+  if (!g_file_test(job->tmp_path, G_FILE_TEST_EXISTS)) {
+    return FALSE;
+  }
+  if (job->uri == NULL) {
+    // Custom preview command, there is no source file to describe.
+    return g_rename(job->tmp_path, job->output_path) == 0;
+  }
+
   GError *error = NULL;
+  GdkPixbuf *pb = gdk_pixbuf_new_from_file(job->tmp_path, &error);
+  if (pb == NULL) {
+    g_warning("Failed to load thumbnail %s: %s", job->tmp_path,
+              error->message);
+    g_error_free(error);
+    return FALSE;
+  }
+  gchar *mtime = NULL;
+  GStatBuf st;
+  if (g_stat(job->filename, &st) == 0) {
+    mtime = g_strdup_printf("%" G_GINT64_FORMAT, (gint64)st.st_mtime);
+  }
+  gboolean retv = gdk_pixbuf_save(pb, job->tmp_path, "png", &error,
+                                  "tEXt::Software", "rofi", "tEXt::Thumb::URI",
+                                  job->uri, "tEXt::Thumb::MTime", mtime, NULL);
+  if (!retv) {
+    g_warning("Failed to store thumbnail %s: %s", job->output_path,
+              error->message);
+    g_error_free(error);
+  } else {
+    // Atomic replace, so readers never see a partial file.
+    retv = g_rename(job->tmp_path, job->output_path) == 0;
+  }
+  g_free(mtime);
+  g_object_unref(pb);
+  return retv;
+}
+
+// Remove job from the pool and hand the waiting entries back.
+static void rofi_icon_fetcher_thumbnail_release(ThumbnailJob *job,
+                                                gboolean requeue) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  g_hash_table_remove(rofi_icon_fetcher_data->thumbnail_jobs,
+                      job->output_path);
+  GList *waiters = job->waiters;
+  job->waiters = NULL;
+  g_mutex_unlock(&(rofi_icon_fetcher_data->thumbnail_lock));
+
+  for (GList *iter = g_list_first(waiters); iter; iter = g_list_next(iter)) {
+    IconFetcherEntry *sentry = (IconFetcherEntry *)iter->data;
+    if (requeue && tpool) {
+      // Picks up the new thumbnail, or falls back to the mime-type icon.
+      sentry->thumbnail_done = TRUE;
+      g_thread_pool_push(tpool, sentry, NULL);
+    } else {
+      // Re-fetched on next query.
+      sentry->query_started = FALSE;
+    }
+  }
+  g_list_free(waiters);
+  g_unlink(job->tmp_path);
+  if (job->finalizing) {
+    // Done with the entries, let rofi_icon_fetcher_destroy() continue.
+    g_mutex_lock(&(rofi_icon_fetcher_data->thumbnail_lock));
+    rofi_icon_fetcher_data->thumbnail_finalizing--;
+    g_cond_broadcast(&(rofi_icon_fetcher_data->thumbnail_cond));
+    g_mutex_unlock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  }
+  rofi_icon_fetcher_thumbnail_job_free(job);
+}
+
+static void rofi_icon_fetcher_thumbnail_finalize(thread_state *ts,
+                                                 G_GNUC_UNUSED gpointer data) {
+  ThumbnailJob *job = (ThumbnailJob *)ts;
+  if (job->success) {
+    job->success = rofi_icon_fetcher_thumbnail_store(job);
+  }
+  rofi_icon_fetcher_thumbnail_release(job, TRUE);
+}
 
-  gboolean spawned = g_spawn_sync(NULL, command_args,
-    NULL, G_SPAWN_DEFAULT | G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, NULL, &wait_status, &error);
+static void rofi_icon_fetcher_thumbnail_discard(gpointer data) {
+  rofi_icon_fetcher_thumbnail_release((ThumbnailJob *)data, FALSE);
+}
+
+static gboolean rofi_icon_fetcher_thumbnail_dispatch(gpointer data);
 
-  if (spawned) {
-    return g_spawn_check_wait_status(wait_status, NULL);
+// Needs thumbnail_lock to be held.
+static void rofi_icon_fetcher_thumbnail_schedule(void) {
+  if (rofi_icon_fetcher_data->thumbnail_dispatch == 0) {
+    rofi_icon_fetcher_data->thumbnail_dispatch =
+        g_idle_add(rofi_icon_fetcher_thumbnail_dispatch, NULL);
+  }
+}
+
+static void rofi_icon_fetcher_thumbnail_exited(GPid pid, gint status,
+                                               gpointer data) {
+  ThumbnailJob *job = (ThumbnailJob *)data;
+  g_spawn_close_pid(pid);
+  job->watch = 0;
+  job->success = g_spawn_check_wait_status(status, NULL);
+
+  g_mutex_lock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  rofi_icon_fetcher_data->thumbnail_running--;
+  if (!g_queue_is_empty(&(rofi_icon_fetcher_data->thumbnail_queue))) {
+    rofi_icon_fetcher_thumbnail_schedule();
+  }
+  // From here on the job is freed by whoever finalizes it.
+  job->finalizing = TRUE;
+  rofi_icon_fetcher_data->thumbnail_finalizing++;
+  g_mutex_unlock(&(rofi_icon_fetcher_data->thumbnail_lock));
+
+  // Decoding and re-encoding the png should not happen on the main loop.
+  if (tpool) {
+    job->state.callback = rofi_icon_fetcher_thumbnail_finalize;
+    job->state.free = rofi_icon_fetcher_thumbnail_discard;
+    job->state.priority = G_PRIORITY_LOW;
+    g_thread_pool_push(tpool, job, NULL);
   } else {
-    g_warning("Error calling thumbnailer: %s", error->message);
-    g_error_free(error);
+    rofi_icon_fetcher_thumbnail_finalize((thread_state *)job, NULL);
+  }
+}
 
-    return FALSE;
+static gboolean
+rofi_icon_fetcher_thumbnail_dispatch(G_GNUC_UNUSED gpointer data) {
+  GList *failed = NULL;
+  const unsigned int max_jobs = MAX(1, config.max_thumbnailers);
+
+  g_mutex_lock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  rofi_icon_fetcher_data->thumbnail_dispatch = 0;
+  while (rofi_icon_fetcher_data->thumbnail_running < max_jobs &&
+         !g_queue_is_empty(&(rofi_icon_fetcher_data->thumbnail_queue))) {
+    ThumbnailJob *job =
+        g_queue_pop_head(&(rofi_icon_fetcher_data->thumbnail_queue));
+    GError *error = NULL;
+    gboolean spawned = g_spawn_async(
+        NULL, job->command_args, NULL,
+        G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+            G_SPAWN_STDOUT_TO_DEV_NULL,
+        NULL, NULL, &(job->pid), &error);
+    if (spawned) {
+      TIMINGS_COUNTER("thumbnailers spawned", 1);
+      rofi_icon_fetcher_data->thumbnail_running++;
+      job->watch =
+          g_child_watch_add(job->pid, rofi_icon_fetcher_thumbnail_exited, job);
+    } else {
+      g_warning("Error calling thumbnailer: %s", error->message);
+      g_error_free(error);
+      failed = g_list_prepend(failed, job);
+    }
   }
+  g_mutex_unlock(&(rofi_icon_fetcher_data->thumbnail_lock));
+
+  for (GList *iter = g_list_first(failed); iter; iter = g_list_next(iter)) {
+    rofi_icon_fetcher_thumbnail_release((ThumbnailJob *)iter->data, TRUE);
+  }
+  g_list_free(failed);
+  return G_SOURCE_REMOVE;
 }
 
-static gboolean rofi_icon_fetcher_create_thumbnail(const gchar *mime_type,
-                                                   const gchar *filename,
-                                                   const gchar *encoded_uri,
-                                                   const gchar *output_path,
-                                                   int size) {
-  gboolean thumbnail_created = FALSE;
+/**
+ * Queue a thumbnailer run for sentry, takes ownership of command_args.
+ * Returns TRUE when sentry will be pushed back on the thread pool once the
+ * thumbnailer finished.
+ */
+static gboolean rofi_icon_fetcher_thumbnail_request(
+    IconFetcherEntry *sentry, gchar **command_args, const gchar *output_path,
+    gchar *tmp_path, const gchar *uri, const gchar *filename) {
+  if (command_args == NULL) {
+    g_free(tmp_path);
+    return FALSE;
+  }
+  g_mutex_lock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  ThumbnailJob *job =
+      g_hash_table_lookup(rofi_icon_fetcher_data->thumbnail_jobs, output_path);
+  if (job != NULL) {
+    // Already being generated for another entry.
+    g_strfreev(command_args);
+    g_free(tmp_path);
+  } else {
+    job = g_new0(ThumbnailJob, 1);
+    job->command_args = command_args;
+    job->output_path = g_strdup(output_path);
+    job->tmp_path = tmp_path;
+    job->uri = g_strdup(uri);
+    job->filename = g_strdup(filename);
+    g_hash_table_insert(rofi_icon_fetcher_data->thumbnail_jobs,
+                        job->output_path, job);
+    g_queue_push_tail(&(rofi_icon_fetcher_data->thumbnail_queue), job);
+    rofi_icon_fetcher_thumbnail_schedule();
+  }
+  job->waiters = g_list_prepend(job->waiters, sentry);
+  g_mutex_unlock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  return TRUE;
+}
 
+static gboolean rofi_icon_fetcher_queue_thumbnail(IconFetcherEntry *sentry,
+                                                  const gchar *mime_type,
+                                                  const gchar *filename,
+                                                  const gchar *encoded_uri,
+                                                  const gchar *output_path,
+                                                  int size) {
   gchar *command = g_hash_table_lookup(
     rofi_icon_fetcher_data->thumbnailers, mime_type);
 
   if (!command) {
-    return thumbnail_created;
+    return FALSE;
   }
 
-  // split command string to isolate arguments and expand them in a list  
+  gchar *tmp_path = rofi_icon_fetcher_thumbnail_tmp_path(output_path);
+  // split command string to isolate arguments and expand them in a list
   gchar **command_args = setup_thumbnailer_command(
-    command, filename, encoded_uri, output_path, size);
-  
-  if (command_args) {
-    thumbnail_created = exec_thumbnailer_command(command_args);    
-    g_strfreev(command_args);
+    command, filename, encoded_uri, tmp_path, size);
+
+  return rofi_icon_fetcher_thumbnail_request(
+      sentry, command_args, output_path, tmp_path, encoded_uri, filename);
+}
+
+// Reaps a thumbnailer that was terminated, its job is gone.
+static void rofi_icon_fetcher_thumbnail_reap(GPid pid,
+                                             G_GNUC_UNUSED gint status,
+                                             G_GNUC_UNUSED gpointer data) {
+  g_spawn_close_pid(pid);
+}
+
+static void rofi_icon_fetcher_thumbnail_pool_destroy(void) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->thumbnail_lock));
+  if (rofi_icon_fetcher_data->thumbnail_dispatch > 0) {
+    g_source_remove(rofi_icon_fetcher_data->thumbnail_dispatch);
+    rofi_icon_fetcher_data->thumbnail_dispatch = 0;
+  }
+  g_queue_clear(&(rofi_icon_fetcher_data->thumbnail_queue));
+
+  GHashTableIter iter;
+  gpointer value;
+  g_hash_table_iter_init(&iter, rofi_icon_fetcher_data->thumbnail_jobs);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    ThumbnailJob *job = (ThumbnailJob *)value;
+    if (job->finalizing) {
+      // Owned by a worker thread, it releases the job itself.
+      continue;
+    }
+    if (job->watch > 0) {
+      // Do not leave half written thumbnails behind.
+      g_source_remove(job->watch);
+      kill(job->pid, SIGTERM);
+      // Still reap it, a daemon keeps running after this.
+      g_child_watch_add(job->pid, rofi_icon_fetcher_thumbnail_reap, NULL);
+      g_unlink(job->tmp_path);
+    }
+    g_hash_table_iter_remove(&iter);
+    rofi_icon_fetcher_thumbnail_job_free(job);
+  }
+  // The pool was freed without waiting, jobs it dropped are released already.
+  // Wait for the ones still running, they use the lock and the entries.
+  while (rofi_icon_fetcher_data->thumbnail_finalizing > 0) {
+    g_cond_wait(&(rofi_icon_fetcher_data->thumbnail_cond),
+                &(rofi_icon_fetcher_data->thumbnail_lock));
+  }
+  g_mutex_unlock(&(rofi_icon_fetcher_data->thumbnail_lock));
+
+  g_hash_table_unref(rofi_icon_fetcher_data->thumbnail_jobs);
+  g_cond_clear(&(rofi_icon_fetcher_data->thumbnail_cond));
+  g_mutex_clear(&(rofi_icon_fetcher_data->thumbnail_lock));
+}
+
+/**
+ * Parse a size like 64M, 512K or 1G, plain numbers are bytes.
+ */
+static size_t rofi_icon_fetcher_parse_size(const char *str) {
+  if (str == NULL || *str == '\0') {
+    return 0;
+  }
+  char *end = NULL;
+  errno = 0;
+  guint64 val = g_ascii_strtoull(str, &end, 10);
+  gboolean overflow = (errno == ERANGE);
+  unsigned int shift = 0;
+  switch (g_ascii_toupper(*end)) {
+  case 'G':
+    shift += 10;
+    /* FALLTHRU */
+  case 'M':
+    shift += 10;
+    /* FALLTHRU */
+  case 'K':
+    shift += 10;
+    end++;
+    break;
+  default:
+    break;
+  }
+  if (val > (SIZE_MAX >> shift)) {
+    overflow = TRUE;
+  }
+  if (overflow) {
+    g_warning("Icon cache size is too large: '%s', cache is unlimited.", str);
+    return 0;
+  }
+  val <<= shift;
+  if (end == str || *end != '\0') {
+    g_warning("Invalid icon cache size: '%s', cache is unlimited.", str);
+    return 0;
+  }
+  return (size_t)val;
+}
+
+// Called from the worker threads when a surface is loaded.
+static void rofi_icon_fetcher_cache_add(IconFetcherEntry *sentry,
+                                        cairo_surface_t *surface) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
+  sentry->surface = surface;
+  sentry->evicted = FALSE;
+  if (surface != NULL) {
+    TIMINGS_COUNTER("icons resolved", 1);
+    sentry->surface_size = (size_t)cairo_image_surface_get_stride(surface) *
+                           cairo_image_surface_get_height(surface);
+    rofi_icon_fetcher_data->cache_size += sentry->surface_size;
+    g_queue_push_head(&(rofi_icon_fetcher_data->cache_lru), sentry);
+    sentry->lru_link = rofi_icon_fetcher_data->cache_lru.head;
+  }
+  g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
+}
+
+/**
+ * @param keep Entry that is being looked up, never dropped.
+ *
+ * Drop least recently used surfaces until we are within budget.
+ * Only called from the main thread, so no surface is released between a
+ * rofi_icon_fetcher_get and the caller taking a reference.
+ * Needs cache_lock to be held.
+ */
+static void rofi_icon_fetcher_cache_trim(IconFetcherEntry *keep) {
+  IconFetcher *data = rofi_icon_fetcher_data;
+  if (data->cache_budget == 0) {
+    return;
+  }
+  GList *iter = data->cache_lru.tail;
+  while (data->cache_size > data->cache_budget && iter != NULL) {
+    GList *prev = iter->prev;
+    IconFetcherEntry *sentry = (IconFetcherEntry *)iter->data;
+    // Referenced by a widget or mode, it is visible and would not free memory.
+    // The entry looked up is not referenced by the caller yet.
+    if (sentry != keep &&
+        cairo_surface_get_reference_count(sentry->surface) == 1) {
+      g_queue_delete_link(&(data->cache_lru), iter);
+      sentry->lru_link = NULL;
+      data->cache_size -= sentry->surface_size;
+      cairo_surface_destroy(sentry->surface);
+      sentry->surface = NULL;
+      sentry->surface_size = 0;
+      sentry->evicted = TRUE;
+      data->stats.evictions++;
+    }
+    iter = prev;
   }
-  
-  return thumbnail_created;
+}
+
+/**
+ * Look up the surface for sentry, reloading it when it was evicted.
+ * Needs cache_lock to be held.
+ */
+static cairo_surface_t *
+rofi_icon_fetcher_cache_lookup(IconFetcherEntry *sentry) {
+  IconFetcher *data = rofi_icon_fetcher_data;
+  if (sentry->surface != NULL) {
+    data->stats.hits++;
+    if (sentry->lru_link != data->cache_lru.head) {
+      g_queue_unlink(&(data->cache_lru), sentry->lru_link);
+      g_queue_push_head_link(&(data->cache_lru), sentry->lru_link);
+    }
+  } else if (sentry->evicted) {
+    data->stats.misses++;
+    sentry->evicted = FALSE;
+    sentry->query_done = FALSE;
+    sentry->query_started = TRUE;
+    g_thread_pool_push(tpool, sentry, NULL);
+  }
+  rofi_icon_fetcher_cache_trim(sentry);
+  return sentry->surface;
 }
 
 static void rofi_icon_fetch_thread_pool_entry_remove(gpointer data) {
@@ -315,6 +736,17 @@ void rofi_icon_fetcher_init(void) {
   for (i = 0; system_data_dirs[i] != NULL; i++) {
       rofi_icon_fetcher_load_thumbnailers(system_data_dirs[i]);
   }
+
+  g_mutex_init(&(rofi_icon_fetcher_data->cache_lock));
+  g_queue_init(&(rofi_icon_fetcher_data->cache_lru));
+  rofi_icon_fetcher_data->cache_budget =
+      rofi_icon_fetcher_parse_size(config.icon_cache_size);
+
+  g_mutex_init(&(rofi_icon_fetcher_data->thumbnail_lock));
+  g_cond_init(&(rofi_icon_fetcher_data->thumbnail_cond));
+  rofi_icon_fetcher_data->thumbnail_jobs =
+      g_hash_table_new(g_str_hash, g_str_equal);
+  g_queue_init(&(rofi_icon_fetcher_data->thumbnail_queue));
 }
 
 static void free_wrapper(gpointer data, G_GNUC_UNUSED gpointer user_data) {
@@ -326,12 +758,22 @@ void rofi_icon_fetcher_destroy(void) {
     return;
   }
   
+  rofi_icon_fetcher_thumbnail_pool_destroy();
   g_hash_table_unref(rofi_icon_fetcher_data->thumbnailers);
 
   nk_xdg_theme_context_free(rofi_icon_fetcher_data->xdg_context);
 
+  g_debug("Icon cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT
+          " misses, %" G_GUINT64_FORMAT " evictions, %zu bytes in use.",
+          rofi_icon_fetcher_data->stats.hits,
+          rofi_icon_fetcher_data->stats.misses,
+          rofi_icon_fetcher_data->stats.evictions,
+          rofi_icon_fetcher_data->cache_size);
+
   g_hash_table_unref(rofi_icon_fetcher_data->icon_cache_uid);
   g_hash_table_unref(rofi_icon_fetcher_data->icon_cache);
+  g_queue_clear(&(rofi_icon_fetcher_data->cache_lru));
+  g_mutex_clear(&(rofi_icon_fetcher_data->cache_lock));
 
   g_list_foreach(rofi_icon_fetcher_data->supported_extensions, free_wrapper,
                  NULL);
@@ -525,8 +967,7 @@ static gchar* rofi_icon_fetcher_get_desktop_icon(const gchar* file_path) {
   return icon_key;
 }
 
-static void rofi_icon_fetcher_worker(thread_state *sdata,
-                                     G_GNUC_UNUSED gpointer user_data) {
+static void rofi_icon_fetcher_resolve(thread_state *sdata) {
   g_debug("starting up icon fetching thread.");
   // as long as dr->icon is updated atomicly.. (is a pointer write atomic?)
   // this should be fine running in another thread.
@@ -554,21 +995,26 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
       icon_path = icon_path_ = rofi_icon_fetcher_get_thumbnail(
           entry_name, requested_size, &thumb_size);
       
-      if (!g_file_test(icon_path, G_FILE_TEST_EXISTS)) {
+      if (!sentry->thumbnail_done &&
+          !g_file_test(icon_path, G_FILE_TEST_EXISTS)) {
         char **command_args = NULL;
         int argsv = 0;
         gchar *size_str = g_strdup_printf("%d", thumb_size);
+        gchar *tmp_path = rofi_icon_fetcher_thumbnail_tmp_path(icon_path_);
         
         helper_parse_setup(
           config.preview_cmd, &command_args, &argsv,
           "{input}", entry_name,
-          "{output}", icon_path_, "{size}", size_str, NULL);
+          "{output}", tmp_path, "{size}", size_str, NULL);
 
         g_free(size_str);
         
-        if (command_args) {
-          exec_thumbnailer_command(command_args);
-          g_strfreev(command_args);
+        if (rofi_icon_fetcher_thumbnail_request(sentry, command_args,
+                                                icon_path_, tmp_path, NULL,
+                                                NULL)) {
+          // Worker is re-queued when the thumbnail is generated.
+          g_free(icon_path_);
+          return;
         }
       }
     } else if (g_path_is_absolute(entry_name)) {
@@ -611,27 +1057,36 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
           char *mime_type = g_content_type_get_mime_type(content_type);
           
           if (mime_type) {
-            gboolean created = rofi_icon_fetcher_create_thumbnail(
-              mime_type, entry_name, encoded_uri, icon_path_, thumb_size);
-
-            if (!created) {
-              // replace forward slashes with minus sign to get the icon's name
-              int index = 0;
-
-              while(mime_type[index]) {
-                 if(mime_type[index] == '/')
-                    mime_type[index] = '-';
-                 index++;
-              }
-              
+            gboolean queued = !sentry->thumbnail_done &&
+                rofi_icon_fetcher_queue_thumbnail(
+                  sentry, mime_type, entry_name, encoded_uri, icon_path_,
+                  thumb_size);
+
+            if (queued) {
+              // Worker is re-queued when the thumbnail is generated.
+              g_free(mime_type);
+              g_free(content_type);
+              g_free(encoded_uri);
               g_free(icon_path_);
+              return;
+            }
+
+            // replace forward slashes with minus sign to get the icon's name
+            int index = 0;
 
-              // try to fetch the mime-type icon
-              icon_path = icon_path_ = nk_xdg_theme_get_icon(
-                rofi_icon_fetcher_data->xdg_context, themes, NULL, mime_type,
-                MIN(sentry->wsize, sentry->hsize), 1, TRUE);
+            while(mime_type[index]) {
+               if(mime_type[index] == '/')
+                  mime_type[index] = '-';
+               index++;
             }
             
+            g_free(icon_path_);
+
+            // try to fetch the mime-type icon
+            icon_path = icon_path_ = nk_xdg_theme_get_icon(
+              rofi_icon_fetcher_data->xdg_context, themes, NULL, mime_type,
+              MIN(sentry->wsize, sentry->hsize), 1, TRUE);
+            
             g_free(mime_type);
             g_free(content_type);
           }
@@ -671,7 +1126,7 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
     pango_cairo_show_layout(cr, layout);
     g_object_unref(layout);
     cairo_destroy(cr);
-    sentry->surface = surface;
+    rofi_icon_fetcher_cache_add(sentry, surface);
     sentry->query_done = TRUE;
     rofi_view_reload();
     return;
@@ -744,12 +1199,19 @@ static void rofi_icon_fetcher_worker(thread_state *sdata,
     g_object_unref(pb);
   }
 
-  sentry->surface = icon_surf;
+  rofi_icon_fetcher_cache_add(sentry, icon_surf);
   g_free(icon_path_);
   sentry->query_done = TRUE;
   rofi_view_reload();
 }
 
+static void rofi_icon_fetcher_worker(thread_state *sdata,
+                                     G_GNUC_UNUSED gpointer user_data) {
+  TIMINGS_SPAN_BEGIN("icon fetch");
+  rofi_icon_fetcher_resolve(sdata);
+  TIMINGS_SPAN_END("icon fetch");
+}
+
 uint32_t rofi_icon_fetcher_query_advanced(const char *name, const int wsize,
                                           const int hsize) {
   g_debug("Query: %s(%dx%d)", name, wsize, hsize);
@@ -768,6 +1230,7 @@ uint32_t rofi_icon_fetcher_query_advanced(const char *name, const int wsize,
     if (sentry->wsize == wsize && sentry->hsize == hsize &&
         sentry->scale == scale) {
       if (!sentry->query_started) {
+        sentry->query_started = TRUE;
         g_thread_pool_push(tpool, sentry, NULL);
       }
       return sentry->uid;
@@ -814,6 +1277,7 @@ uint32_t rofi_icon_fetcher_query(const char *name, const int size) {
     if (sentry->wsize == size && sentry->hsize == size &&
         sentry->scale == scale) {
       if (!sentry->query_started) {
+        sentry->query_started = TRUE;
         g_thread_pool_push(tpool, sentry, NULL);
       }
       return sentry->uid;
@@ -848,7 +1312,10 @@ cairo_surface_t *rofi_icon_fetcher_get(const uint32_t uid) {
   IconFetcherEntry *sentry = g_hash_table_lookup(
       rofi_icon_fetcher_data->icon_cache_uid, GINT_TO_POINTER(uid));
   if (sentry) {
-    return sentry->surface;
+    g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
+    cairo_surface_t *surface = rofi_icon_fetcher_cache_lookup(sentry);
+    g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
+    return surface;
   }
   g_warning("Querying an non-existing uid");
   return NULL;
@@ -860,9 +1327,19 @@ gboolean rofi_icon_fetcher_get_ex(const uint32_t uid,
       rofi_icon_fetcher_data->icon_cache_uid, GINT_TO_POINTER(uid));
   *surface = NULL;
   if (sentry) {
-    *surface = sentry->surface;
+    g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
+    *surface = rofi_icon_fetcher_cache_lookup(sentry);
+    g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
     return sentry->query_done;
   }
   g_warning("Querying an non-existing uid");
   return FALSE;
 }
+
+void rofi_icon_fetcher_get_stats(RofiIconFetcherStats *stats) {
+  g_mutex_lock(&(rofi_icon_fetcher_data->cache_lock));
+  *stats = rofi_icon_fetcher_data->stats;
+  stats->size = rofi_icon_fetcher_data->cache_size;
+  stats->budget = rofi_icon_fetcher_data->cache_budget;
+  g_mutex_unlock(&(rofi_icon_fetcher_data->cache_lock));
+}
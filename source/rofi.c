@@ -66,6 +66,7 @@
 #include "view-internal.h"
 #include "view.h"
 
+#include "rofi-daemon.h"
 #include "rofi-icon-fetcher.h"
 #include "theme.h"
 
@@ -75,6 +76,12 @@
 // TODO: move this check to mode.c
 #include "mode-private.h"
 
+/** Name of the theme cache in the cache directory. */
+#define THEME_CACHE_FILE "rofi-theme.cache"
+
+/** Supported theme file extensions, defined by the theme lexer. */
+extern const char *rasi_theme_file_extensions[];
+
 /** Location of pidfile for this instance. */
 char *pidfile = NULL;
 /** Location of Cache directory. */
@@ -87,6 +94,7 @@ GList *list_of_error_msgs = NULL;
 GList *list_of_warning_msgs = NULL;
 
 static void rofi_collectmodes_destroy(void);
+static void rofi_collectmodes_load_all(void);
 void rofi_add_error_message(GString *str) {
   list_of_error_msgs = g_list_append(list_of_error_msgs, str);
 }
@@ -179,11 +187,89 @@ static const Mode *mode_available_lookup(const char *name) {
   return NULL;
 }
 
+/** Thread initializing the shown mode, while the window is created. */
+static GThread *mode_init_thread = NULL;
+
+/**
+ * @param mode The mode that failed to initialize.
+ *
+ * Show an error dialog for a mode that failed to initialize.
+ */
+static void rofi_mode_init_error(const Mode *mode) {
+  GString *str = g_string_new("Failed to initialize the mode: ");
+  g_string_append(str, mode->name);
+  g_string_append(str, "\n");
+
+  rofi_view_error_dialog(str->str, ERROR_MSG_MARKUP);
+  g_string_free(str, FALSE);
+}
+
+/**
+ * Wait for the mode initialized on the worker thread.
+ */
+static void rofi_mode_init_thread_join(void) {
+  if (mode_init_thread != NULL) {
+    TICK_N("Wait for mode init thread");
+    g_thread_join(mode_init_thread);
+    mode_init_thread = NULL;
+  }
+}
+
+static gboolean rofi_mode_init_thread_ready(gpointer data) {
+  Mode *mode = (Mode *)data;
+  if (mode_init_thread == NULL) {
+    return G_SOURCE_REMOVE;
+  }
+  gboolean failed = GPOINTER_TO_INT(g_thread_join(mode_init_thread));
+  mode_init_thread = NULL;
+  TICK_N("Mode init thread ready");
+  if (failed) {
+    rofi_mode_init_error(mode);
+    return G_SOURCE_REMOVE;
+  }
+  // The view was created without entries, add them.
+  rofi_view_reload();
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer rofi_mode_init_thread(gpointer data) {
+  Mode *mode = (Mode *)data;
+  TIMINGS_SPAN_BEGIN("mode init (threaded)");
+  gboolean failed = !mode_init_claimed(mode);
+  TIMINGS_SPAN_END("mode init (threaded)");
+  g_idle_add(rofi_mode_init_thread_ready, mode);
+  return GINT_TO_POINTER(failed);
+}
+
+/**
+ * Start loading the data of the mode to show on a worker thread, when it has
+ * MODE_TYPE_THREADED_INIT, so it overlaps with creating the window and loading
+ * fonts. The view shows the prompt first and the entries when loaded.
+ */
+static void rofi_mode_init_thread_start(void) {
+  char *sname = NULL;
+  int index = -1;
+  if (find_arg_str("-show", &sname) == TRUE) {
+    index = mode_lookup(sname);
+  } else if (num_modes > 0) {
+    index = 0;
+  }
+  if (index < 0 || (modes[index]->type & MODE_TYPE_THREADED_INIT) !=
+                       MODE_TYPE_THREADED_INIT) {
+    return;
+  }
+  // Claim it here, so the view never queries it before it is loaded.
+  mode_init_claim(modes[index]);
+  mode_init_thread =
+      g_thread_new("mode init", rofi_mode_init_thread, modes[index]);
+}
+
 /**
  * Teardown the gui.
  */
 static void teardown(int pfd) {
   g_debug("Teardown");
+  rofi_mode_init_thread_join();
   // Cleanup font setup.
   textbox_cleanup();
 
@@ -194,27 +280,26 @@ static void teardown(int pfd) {
 
   // Cleanup pid file.
   remove_pid_file(pfd);
+  rofi_daemon_stop();
 }
-static void run_mode_index(ModeMode mode) {
-  // Otherwise check if requested mode is enabled.
-  for (unsigned int i = 0; i < num_modes; i++) {
-    if (!mode_init(modes[i])) {
-      GString *str = g_string_new("Failed to initialize the mode: ");
-      g_string_append(str, modes[i]->name);
-      g_string_append(str, "\n");
-
-      rofi_view_error_dialog(str->str, ERROR_MSG_MARKUP);
-      g_string_free(str, FALSE);
-      break;
-    }
-  }
+static void run_mode_index(ModeMode mode, const char *filter) {
+  TIMINGS_SPAN_BEGIN("mode init");
+  // Only the shown mode is initialized, the others when switched to. This
+  // lets combi load its sub-modes on its own threads.
+  // A mode still loading on a worker thread reloads the view when ready.
+  if (!mode_init_pending(modes[mode]) && !mode_init(modes[mode])) {
+    rofi_mode_init_error(modes[mode]);
+  }
+  TIMINGS_SPAN_END("mode init");
   // Error dialog must have been created.
   if (rofi_view_get_active() != NULL) {
     return;
   }
   curr_mode = mode;
+  TIMINGS_SPAN_BEGIN("view create");
   RofiViewState *state =
-      rofi_view_create(modes[mode], config.filter, 0, process_result);
+      rofi_view_create(modes[mode], filter, 0, process_result);
+  TIMINGS_SPAN_END("view create");
 
   // User can pre-select a row.
   if (find_arg("-selected-row") >= 0) {
@@ -226,7 +311,7 @@ static void run_mode_index(ModeMode mode) {
     rofi_view_set_active(state);
   }
   if (rofi_view_get_active() == NULL) {
-    g_main_loop_quit(main_loop);
+    rofi_quit_main_loop();
   }
 }
 void process_result(RofiViewState *state) {
@@ -270,6 +355,13 @@ void process_result(RofiViewState *state) {
       mode = retv;
     }
     if (mode != MODE_EXIT) {
+      // Modes are initialized when first shown, a mode loading on a worker
+      // thread reloads the view when ready.
+      if (mode != curr_mode && !mode_init_pending(modes[mode]) &&
+          !mode_init(modes[mode])) {
+        rofi_mode_init_error(modes[mode]);
+        return;
+      }
       /**
        * Load in the new mode.
        */
@@ -291,6 +383,7 @@ void process_result(RofiViewState *state) {
  * Help function.
  */
 static void print_list_of_modes(int is_term) {
+  rofi_collectmodes_load_all();
   for (unsigned int i = 0; i < num_available_modes; i++) {
     gboolean active = FALSE;
     for (unsigned int j = 0; j < num_modes; j++) {
@@ -330,6 +423,9 @@ static void print_main_application_options(int is_term) {
   print_help_msg("-show", "[mode]",
                  "Show the mode 'mode' and exit. The mode has to be enabled.",
                  NULL, is_term);
+  print_help_msg("-daemon", "",
+                 "Stay resident and show windows on request of 'rofi -show'.",
+                 NULL, is_term);
   print_help_msg("-no-lazy-grab", "",
                  "Disable lazy grab that, when fail to grab keyboard, does not "
                  "block but retry later.",
@@ -348,6 +444,12 @@ static void print_main_application_options(int is_term) {
   print_help_msg("-list-keybindings", "",
                  "Print a list of current keybindings and exit.", NULL,
                  is_term);
+  print_help_msg("-profile-out", "[file]",
+                 "Write a profile trace (JSON, or CSV for *.csv) on exit.",
+                 NULL, is_term);
+  print_help_msg("-latency-out", "[file]",
+                 "Write input latency histograms on exit ('-' for stderr).",
+                 NULL, is_term);
 }
 static void help(G_GNUC_UNUSED int argc, char **argv) {
   int is_term = isatty(fileno(stdout));
@@ -464,6 +566,7 @@ static void help_print_mode_not_found(const char *mode) {
   GString *str = g_string_new("");
   g_string_printf(
       str, "Mode %s is not found.\nThe following modes are known:\n", mode);
+  rofi_collectmodes_load_all();
   for (unsigned int i = 0; i < num_available_modes; i++) {
     gboolean active = FALSE;
     for (unsigned int j = 0; j < num_modes; j++) {
@@ -490,6 +593,7 @@ static void help_print_no_arguments(void) {
                            modes[j]->name);
   }
   g_string_append(emesg, "\nThe following modes can be enabled:\n");
+  rofi_collectmodes_load_all();
   for (unsigned int i = 0; i < num_available_modes; i++) {
     gboolean active = FALSE;
     for (unsigned int j = 0; j < num_modes; j++) {
@@ -557,11 +661,61 @@ static void cleanup(void) {
   }
 }
 
+/**
+ * The cache directory is only known after the commandline is parsed, look it
+ * up so the theme cache can be used before that.
+ *
+ * @returns the path of the theme cache file.
+ */
+static char *rofi_theme_cache_file(void) {
+  char *dir = config.cache_dir;
+  find_arg_str("-cache-dir", &dir);
+  if (dir == NULL) {
+    return g_build_filename(g_get_user_cache_dir(), THEME_CACHE_FILE, NULL);
+  }
+  char *expanded = rofi_expand_path(dir);
+  char *retv = g_build_filename(expanded, THEME_CACHE_FILE, NULL);
+  g_free(expanded);
+  return retv;
+}
+
 /**
  * Collected modes
  */
 
-Mode *rofi_collect_modes_search(const char *name) {
+/** Name of the plugin manifest in the cache directory. */
+#define PLUGIN_MANIFEST_FILE "rofi-plugins.cache"
+
+/**
+ * A plugin found in the plugin path. Its mode name and ABI version come from
+ * the manifest, so it is only opened when the mode is used.
+ */
+typedef struct {
+  /** Full path of the plugin. */
+  char *path;
+  /** Modification time of the plugin. */
+  gint64 mtime;
+  /** Size of the plugin. */
+  gint64 size;
+  /** Name of the mode it provides, NULL when not known (yet). */
+  char *name;
+  /** ABI version of the mode it provides. */
+  unsigned int abi_version;
+  /** The plugin was opened (or failed to open). */
+  gboolean opened;
+} PluginEntry;
+
+/** Plugins found in the plugin path, in search order. */
+static GPtrArray *plugin_entries = NULL;
+
+static void plugin_entry_free(gpointer data) {
+  PluginEntry *e = (PluginEntry *)data;
+  g_free(e->path);
+  g_free(e->name);
+  g_free(e);
+}
+
+static Mode *rofi_collectmodes_lookup(const char *name) {
   for (unsigned int i = 0; i < num_available_modes; i++) {
     if (g_strcmp0(name, available_modes[i]->name) == 0) {
       return available_modes[i];
@@ -575,7 +729,7 @@ Mode *rofi_collect_modes_search(const char *name) {
  * @returns TRUE when success.
  */
 static gboolean rofi_collectmodes_add(Mode *mode) {
-  Mode *m = rofi_collect_modes_search(mode->name);
+  Mode *m = rofi_collectmodes_lookup(mode->name);
   if (m == NULL) {
     available_modes =
         g_realloc(available_modes, sizeof(Mode *) * (num_available_modes + 1));
@@ -587,6 +741,121 @@ static gboolean rofi_collectmodes_add(Mode *mode) {
   return FALSE;
 }
 
+/**
+ * @param e The plugin to open.
+ *
+ * Open the plugin, record its mode name and ABI version in the entry and add
+ * the mode to the list of available modes.
+ *
+ * @returns the added mode, or NULL on failure.
+ */
+static Mode *rofi_collectmodes_open(PluginEntry *e) {
+  Mode *retv = NULL;
+  const char *dn = strrchr(e->path, G_DIR_SEPARATOR);
+  dn = (dn != NULL) ? dn + 1 : e->path;
+  e->opened = TRUE;
+  g_debug("Trying to open: %s plugin", e->path);
+  TIMINGS_SPAN_BEGIN("open plugin");
+  GModule *mod =
+      g_module_open(e->path, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+  TIMINGS_SPAN_END("open plugin");
+  if (mod) {
+    Mode *m = NULL;
+    if (g_module_symbol(mod, "mode", (gpointer *)&m)) {
+      g_free(e->name);
+      e->name = g_strdup(m->name);
+      e->abi_version = m->abi_version;
+      if (m->abi_version != ABI_VERSION) {
+        g_warning("ABI version of plugin: '%s' does not match: %08X "
+                  "expecting: %08X",
+                  dn, m->abi_version, ABI_VERSION);
+        g_module_close(mod);
+      } else {
+        m->module = mod;
+        if (rofi_collectmodes_add(m)) {
+          // Options from the configuration are kept until registered.
+          mode_set_config(m);
+          retv = m;
+        } else {
+          g_module_close(mod);
+        }
+      }
+    } else {
+      g_warning("Symbol 'mode' not found in module: %s", dn);
+      g_module_close(mod);
+    }
+  } else {
+    g_warning("Failed to open 'mode' plugin: '%s', error: %s", dn,
+              g_module_error());
+  }
+  return retv;
+}
+
+/**
+ * @param name The name of the mode.
+ *
+ * Open the first not yet opened plugin that provides mode name.
+ *
+ * @returns the mode, or NULL when no plugin provides it.
+ */
+static Mode *rofi_collectmodes_load_lazy(const char *name) {
+  if (plugin_entries == NULL) {
+    return NULL;
+  }
+  for (unsigned int i = 0; i < plugin_entries->len; i++) {
+    PluginEntry *e = g_ptr_array_index(plugin_entries, i);
+    if (!e->opened && e->abi_version == ABI_VERSION &&
+        g_strcmp0(e->name, name) == 0) {
+      Mode *m = rofi_collectmodes_open(e);
+      if (m != NULL && g_strcmp0(m->name, name) == 0) {
+        return m;
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Open all plugins that are not opened yet, so the list of available modes
+ * is complete. Used when listing the modes.
+ */
+static void rofi_collectmodes_load_all(void) {
+  if (plugin_entries == NULL) {
+    return;
+  }
+  for (unsigned int i = 0; i < plugin_entries->len; i++) {
+    PluginEntry *e = g_ptr_array_index(plugin_entries, i);
+    if (!e->opened && e->abi_version == ABI_VERSION) {
+      rofi_collectmodes_open(e);
+    }
+  }
+}
+
+Mode *rofi_collect_modes_search(const char *name) {
+  Mode *m = rofi_collectmodes_lookup(name);
+  if (m == NULL) {
+    m = rofi_collectmodes_load_lazy(name);
+  }
+  return m;
+}
+
+gboolean rofi_collect_modes_provides(const char *name) {
+  if (rofi_collectmodes_lookup(name) != NULL) {
+    return TRUE;
+  }
+  if (plugin_entries == NULL) {
+    return FALSE;
+  }
+  for (unsigned int i = 0; i < plugin_entries->len; i++) {
+    PluginEntry *e = g_ptr_array_index(plugin_entries, i);
+    if (!e->opened && e->abi_version == ABI_VERSION &&
+        g_strcmp0(e->name, name) == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
 static void rofi_collectmodes_dir(const char *base_dir) {
   g_debug("Looking into: %s for plugins", base_dir);
   GDir *dir = g_dir_open(base_dir, 0, NULL);
@@ -597,37 +866,106 @@ static void rofi_collectmodes_dir(const char *base_dir) {
         continue;
       }
       char *fn = g_build_filename(base_dir, dn, NULL);
-      g_debug("Trying to open: %s plugin", fn);
-      GModule *mod =
-          g_module_open(fn, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
-      if (mod) {
-        Mode *m = NULL;
-        if (g_module_symbol(mod, "mode", (gpointer *)&m)) {
-          if (m->abi_version != ABI_VERSION) {
-            g_warning("ABI version of plugin: '%s' does not match: %08X "
-                      "expecting: %08X",
-                      dn, m->abi_version, ABI_VERSION);
-            g_module_close(mod);
-          } else {
-            m->module = mod;
-            if (!rofi_collectmodes_add(m)) {
-              g_module_close(mod);
-            }
-          }
-        } else {
-          g_warning("Symbol 'mode' not found in module: %s", dn);
-          g_module_close(mod);
-        }
-      } else {
-        g_warning("Failed to open 'mode' plugin: '%s', error: %s", dn,
-                  g_module_error());
+      struct stat st;
+      if (stat(fn, &st) != 0) {
+        g_free(fn);
+        continue;
+      }
+      PluginEntry *e = g_malloc0(sizeof(PluginEntry));
+      e->path = fn;
+      e->mtime = (gint64)st.st_mtime;
+      e->size = (gint64)st.st_size;
+      if (plugin_entries == NULL) {
+        plugin_entries = g_ptr_array_new_with_free_func(plugin_entry_free);
       }
-      g_free(fn);
+      g_ptr_array_add(plugin_entries, e);
     }
     g_dir_close(dir);
   }
 }
 
+/**
+ * Resolve the plugins found by rofi_collectmodes_dir() against the manifest
+ * in the cache directory. Plugins that are unchanged since they were recorded
+ * are only opened when their mode is requested, the others are opened now.
+ * The manifest is rewritten when it changed.
+ */
+static void rofi_collectmodes_manifest(void) {
+  if (plugin_entries == NULL) {
+    return;
+  }
+  TIMINGS_SPAN_BEGIN("plugin manifest");
+  char *path = g_build_filename(cache_dir, PLUGIN_MANIFEST_FILE, NULL);
+  char *old_data = NULL;
+  GKeyFile *old_kf = g_key_file_new();
+  if (g_file_get_contents(path, &old_data, NULL, NULL)) {
+    if (!g_key_file_load_from_data(old_kf, old_data, -1, G_KEY_FILE_NONE,
+                                   NULL)) {
+      g_debug("Ignoring invalid plugin manifest: %s", path);
+    }
+  }
+
+  GKeyFile *kf = g_key_file_new();
+  for (unsigned int i = 0; i < plugin_entries->len; i++) {
+    PluginEntry *e = g_ptr_array_index(plugin_entries, i);
+    GError *error = NULL;
+    gint64 mtime = g_key_file_get_int64(old_kf, e->path, "mtime", &error);
+    gint64 size = 0;
+    if (error == NULL) {
+      size = g_key_file_get_int64(old_kf, e->path, "size", &error);
+    }
+    char *name = NULL;
+    if (error == NULL) {
+      name = g_key_file_get_string(old_kf, e->path, "mode", &error);
+    }
+    guint64 abi = 0;
+    if (error == NULL) {
+      abi = g_key_file_get_uint64(old_kf, e->path, "abi-version", &error);
+    }
+    if (error == NULL && mtime == e->mtime && size == e->size &&
+        name[0] != '\0') {
+      e->name = name;
+      e->abi_version = (unsigned int)abi;
+      if (e->abi_version != ABI_VERSION) {
+        g_warning("ABI version of plugin: '%s' does not match: %08X "
+                  "expecting: %08X",
+                  e->path, e->abi_version, ABI_VERSION);
+        e->opened = TRUE;
+      } else {
+        g_debug("Deferring plugin: %s providing mode: %s", e->path, e->name);
+      }
+    } else {
+      g_free(name);
+      g_clear_error(&error);
+      rofi_collectmodes_open(e);
+    }
+    // Plugins that failed to open are not recorded, so they are retried.
+    if (e->abi_version != 0) {
+      g_key_file_set_int64(kf, e->path, "mtime", e->mtime);
+      g_key_file_set_int64(kf, e->path, "size", e->size);
+      g_key_file_set_string(kf, e->path, "mode", e->name);
+      g_key_file_set_uint64(kf, e->path, "abi-version", e->abi_version);
+    }
+  }
+
+  gsize length = 0;
+  char *data = g_key_file_to_data(kf, &length, NULL);
+  if (g_strcmp0(data, old_data) != 0) {
+    GError *error = NULL;
+    if (!g_file_set_contents(path, data, length, &error)) {
+      g_warning("Failed to write plugin manifest: %s: %s", path,
+                error->message);
+      g_error_free(error);
+    }
+  }
+  g_free(data);
+  g_key_file_free(kf);
+  g_key_file_free(old_kf);
+  g_free(old_data);
+  g_free(path);
+  TIMINGS_SPAN_END("plugin manifest");
+}
+
 /**
  * Find all available modes.
  */
@@ -669,7 +1007,6 @@ static void rofi_collect_modes(void) {
       g_strfreev(paths);
     }
   }
-  script_mode_gather_user_scripts();
 }
 
 /**
@@ -693,6 +1030,10 @@ static void rofi_collectmodes_destroy(void) {
   }
   g_free(available_modes);
   available_modes = NULL;
+  if (plugin_entries != NULL) {
+    g_ptr_array_free(plugin_entries, TRUE);
+    plugin_entries = NULL;
+  }
   num_available_modes = 0;
 }
 
@@ -742,11 +1083,53 @@ static gboolean setup_modes(void) {
   return FALSE;
 }
 
+/**
+ * Hide the window shown for a daemon client and reply to it.
+ * The modes stay initialized, the next request only creates a new view with
+ * its own filter.
+ */
+static void rofi_daemon_hide(void) {
+  rofi_view_hide();
+  rofi_daemon_session_finish(return_code);
+}
+
+/**
+ * @param mode The name of the mode to show.
+ * @param filter The filter to pre-set, or NULL.
+ *
+ * Show a window on request of a daemon client.
+ */
+static void rofi_daemon_show(const char *mode, const char *filter) {
+  TICK_N("Daemon request");
+  rofi_set_return_code(EXIT_SUCCESS);
+  int index = mode_lookup(mode);
+  if (index < 0) {
+    index = add_mode(mode);
+  }
+  if (index < 0) {
+    g_warning("Mode '%s' requested by client not found.", mode);
+    rofi_daemon_session_finish(EX_USAGE);
+    return;
+  }
+  if (!display_resume()) {
+    g_warning("Failed to resume display for client.");
+    rofi_daemon_session_finish(EXIT_FAILURE);
+    return;
+  }
+  run_mode_index(index, filter);
+}
+
 /**
  * Quit rofi mainloop.
- * This will exit program.
+ * This will exit program, unless the window was shown for a daemon client.
  **/
-void rofi_quit_main_loop(void) { g_main_loop_quit(main_loop); }
+void rofi_quit_main_loop(void) {
+  if (rofi_daemon_session_active()) {
+    rofi_daemon_hide();
+    return;
+  }
+  g_main_loop_quit(main_loop);
+}
 
 static gboolean main_loop_signal_handler_int(G_GNUC_UNUSED gpointer data) {
   // Break out of loop.
@@ -787,7 +1170,9 @@ static gboolean startup(G_GNUC_UNUSED gpointer data) {
     window_flags |= MENU_TRANSIENT_WINDOW;
   }
   TICK_N("Grab keyboard");
+  TIMINGS_SPAN_BEGIN("create window");
   __create_window(window_flags);
+  TIMINGS_SPAN_END("create window");
   TICK_N("Create Window");
   // Parse the keybindings.
   TICK_N("Parse ABE");
@@ -806,6 +1191,15 @@ static gboolean startup(G_GNUC_UNUSED gpointer data) {
       fputs("\n", stderr);
     }
   }
+  // Daemon mode, stay hidden until a client requests a window.
+  if (find_arg("-daemon") >= 0) {
+    rofi_view_hide();
+    if (!rofi_daemon_start(rofi_daemon_show)) {
+      rofi_set_return_code(EXIT_FAILURE);
+      g_main_loop_quit(main_loop);
+    }
+    return G_SOURCE_REMOVE;
+  }
   // Dmenu mode.
   if (rofi_is_in_dmenu_mode == TRUE) {
     // force off sidebar mode:
@@ -854,14 +1248,14 @@ static gboolean startup(G_GNUC_UNUSED gpointer data) {
       // Run it anyway if found.
     }
     if (index >= 0) {
-      run_mode_index(index);
+      run_mode_index(index, config.filter);
     } else {
       help_print_mode_not_found(sname);
       show_error_dialog();
       return G_SOURCE_REMOVE;
     }
   } else if (find_arg("-show") >= 0 && num_modes > 0) {
-    run_mode_index(0);
+    run_mode_index(0, config.filter);
   } else {
     help_print_no_arguments();
 
@@ -967,6 +1361,15 @@ int main(int argc, char *argv[]) {
   }
   TICK();
 
+  // Let a running daemon show the window.
+  if (!rofi_is_in_dmenu_mode && find_arg("-daemon") < 0) {
+    int retv = rofi_daemon_forward(argc, argv);
+    if (retv >= 0) {
+      return retv;
+    }
+  }
+  TICK_N("Daemon forward");
+
   // Create pid file path.
   const char *path = g_get_user_runtime_dir();
   if (path) {
@@ -1047,7 +1450,9 @@ int main(int argc, char *argv[]) {
   }
 
   TICK_N("Setup Locale");
+  TIMINGS_SPAN_BEGIN("collect modes");
   rofi_collect_modes();
+  TIMINGS_SPAN_END("collect modes");
   TICK_N("Collect MODES");
   rofi_collectmodes_setup();
   TICK_N("Setup MODES");
@@ -1108,14 +1513,33 @@ int main(int argc, char *argv[]) {
   find_arg_str("-theme", &(config.theme));
   if (config.theme) {
     TICK_N("Parse theme");
-    rofi_theme_reset();
-    if (rofi_theme_parse_file(config.theme)) {
-      g_warning("Failed to parse theme: \"%s\"", config.theme);
-      // TODO: instantiate fallback theme.?
-      rofi_theme_free(rofi_theme);
-      rofi_theme = NULL;
+    char *theme_cache = rofi_theme_cache_file();
+    char *theme_path =
+        helper_get_theme_path(config.theme, rasi_theme_file_extensions, NULL);
+    if (rofi_theme_cache_load(theme_cache, theme_path)) {
+      TICK_N("Loaded theme from cache");
+    } else {
+      guint num_msgs = g_list_length(list_of_error_msgs) +
+                       g_list_length(list_of_warning_msgs);
+      rofi_theme_reset();
+      rofi_theme_cache_record_begin();
+      if (rofi_theme_parse_file(config.theme)) {
+        rofi_theme_cache_record_end(NULL, NULL);
+        g_warning("Failed to parse theme: \"%s\"", config.theme);
+        // TODO: instantiate fallback theme.?
+        rofi_theme_free(rofi_theme);
+        rofi_theme = NULL;
+      } else if (num_msgs != g_list_length(list_of_error_msgs) +
+                                 g_list_length(list_of_warning_msgs)) {
+        // Keep reporting the messages, do not cache.
+        rofi_theme_cache_record_end(NULL, NULL);
+      } else {
+        rofi_theme_cache_record_end(theme_cache, theme_path);
+      }
+      TICK_N("Parsed theme");
     }
-    TICK_N("Parsed theme");
+    g_free(theme_path);
+    g_free(theme_cache);
   }
   // Parse command line for settings, independent of other -no-config.
   if (list_of_error_msgs == NULL) {
@@ -1141,6 +1565,11 @@ int main(int argc, char *argv[]) {
     g_warning("Failed to create cache directory: %s", g_strerror(errno));
     return EXIT_FAILURE;
   }
+  rofi_collectmodes_manifest();
+  TICK_N("Plugin manifest");
+  // After the manifest, so scripts do not shadow plugins not loaded yet.
+  script_mode_gather_user_scripts();
+  TICK_N("Gather user scripts");
 
   /** dirty hack for dmenu compatibility */
   char *windowid = NULL;
@@ -1188,6 +1617,7 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
   }
   if (find_arg("-dump-config") >= 0) {
+    rofi_collectmodes_load_all();
     config_parse_dump_config_rasi_format(stdout, FALSE);
     cleanup();
     return EXIT_SUCCESS;
@@ -1217,23 +1647,35 @@ int main(int argc, char *argv[]) {
     config.benchmark_ui = TRUE;
   }
 
+  TIMINGS_SPAN_BEGIN("workers initialize");
   rofi_view_workers_initialize();
   TICK_N("Workers initialize");
   rofi_icon_fetcher_init();
+  TIMINGS_SPAN_END("workers initialize");
   TICK_N("Icon fetcher initialize");
 
   gboolean kill_running = FALSE;
   if (find_arg("-replace") >= 0) {
     kill_running = TRUE;
   }
-  // Create pid file
-  int pfd = create_pid_file(pidfile, kill_running);
-  TICK_N("Pid file created");
-  if (pfd < 0) {
-    cleanup();
-    return EXIT_FAILURE;
+  // Create pid file, the daemon has its own so it does not block normal use.
+  int pfd = -1;
+  if (find_arg("-daemon") >= 0) {
+    if (!rofi_daemon_lock(kill_running)) {
+      cleanup();
+      return EXIT_FAILURE;
+    }
+  } else {
+    pfd = create_pid_file(pidfile, kill_running);
+    if (pfd < 0) {
+      cleanup();
+      return EXIT_FAILURE;
+    }
   }
+  TICK_N("Pid file created");
+  TIMINGS_SPAN_BEGIN("textbox setup");
   textbox_setup();
+  TIMINGS_SPAN_END("textbox setup");
   TICK_N("Text box setup");
 
   if (!display_late_setup()) {
@@ -1248,6 +1690,13 @@ int main(int argc, char *argv[]) {
   rofi_theme_parse_process_links();
   TICK_N("Theme setup");
 
+  // The theme is final now, start loading mode data while the window is
+  // created.
+  if (!rofi_is_in_dmenu_mode && find_arg("-show") >= 0 &&
+      find_arg("-daemon") < 0) {
+    rofi_mode_init_thread_start();
+  }
+
   // Setup signal handling sources.
   // SIGINT
   g_unix_signal_add(SIGINT, main_loop_signal_handler_int, NULL);
@@ -45,12 +45,14 @@
 #include "view.h"
 #include "widgets/textbox.h"
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
 /**
  * list of config files we parsed.
  */
 GList *parsed_config_files = NULL;
 static disp_scale_func disp_scale = NULL;
+static void rofi_theme_style_cache_clear(void);
 
 /** cleanup (free) the list of parsed config files. */
 void rofi_theme_free_parsed_files(void) {
@@ -88,6 +90,7 @@ ThemeWidget *rofi_theme_find_or_create_name(ThemeWidget *base,
     }
   }
 
+  rofi_theme_style_cache_clear();
   base->widgets =
       g_realloc(base->widgets, sizeof(ThemeWidget *) * (base->num_widgets + 1));
   base->widgets[base->num_widgets] = g_slice_new0(ThemeWidget);
@@ -243,6 +246,7 @@ void rofi_theme_free(ThemeWidget *wid) {
   if (wid == NULL) {
     return;
   }
+  rofi_theme_style_cache_clear();
   if (wid->properties) {
     g_hash_table_destroy(wid->properties);
     wid->properties = NULL;
@@ -657,6 +661,7 @@ void rofi_theme_widget_add_properties(ThemeWidget *wid, GHashTable *table) {
   if (table == NULL) {
     return;
   }
+  rofi_theme_style_cache_clear();
   if (wid->properties == NULL) {
     wid->properties =
         g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
@@ -796,15 +801,139 @@ ThemeWidget *rofi_theme_find_widget(const char *name, const char *state,
   return wid;
 }
 
+/**
+ * Style cache.
+ *
+ * Resolving a widget name and state to a theme widget and walking its
+ * parents for a property is done on every theme lookup. The result only
+ * depends on the parsed theme, so it is resolved once per (name, state) and
+ * kept until the theme changes.
+ */
+G_STATIC_ASSERT(P_NUM_TYPES <= 32);
+
+/**
+ * Lookup result of one property name, per property type.
+ */
+typedef struct {
+  /** Bitmask of the property types that are resolved. */
+  guint32 resolved;
+  /** The resolved properties, NULL if not found. */
+  Property *p[P_NUM_TYPES];
+} ThemeStyleEntry;
+
+/**
+ * The resolved style of a widget name in a given state.
+ */
+struct _ThemeStyle {
+  /** The theme widget the name and state resolve to. */
+  ThemeWidget *wid;
+  /** The state the style is resolved for, owned by the cache. */
+  const char *state;
+  /** Property name -> ThemeStyleEntry. */
+  GHashTable *properties;
+};
+typedef struct _ThemeStyle ThemeStyle;
+
+/** Widget name -> (state -> ThemeStyle). */
+static GHashTable *theme_style_cache = NULL;
+/** Bumped when the cache is dropped, so widgets refetch their style. */
+static unsigned int theme_style_generation = 1;
+
+static void rofi_theme_style_free(ThemeStyle *style) {
+  g_hash_table_destroy(style->properties);
+  g_slice_free(ThemeStyle, style);
+}
+
+static void rofi_theme_style_cache_clear(void) {
+  if (theme_style_cache == NULL) {
+    return;
+  }
+  g_hash_table_destroy(theme_style_cache);
+  theme_style_cache = NULL;
+  theme_style_generation++;
+  // The distances themselves can have changed.
+  distance_bump_generation();
+}
+
+static ThemeStyle *rofi_theme_style_lookup(const char *name,
+                                           const char *state) {
+  if (theme_style_cache == NULL) {
+    theme_style_cache =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                              (GDestroyNotify)g_hash_table_destroy);
+  }
+  const char *name_key = name ? name : "";
+  GHashTable *states = g_hash_table_lookup(theme_style_cache, name_key);
+  if (states == NULL) {
+    states = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                   (GDestroyNotify)rofi_theme_style_free);
+    g_hash_table_insert(theme_style_cache, g_strdup(name_key), states);
+  }
+  const char *state_key = state ? state : "";
+  ThemeStyle *style = g_hash_table_lookup(states, state_key);
+  if (style == NULL) {
+    style = g_slice_new0(ThemeStyle);
+    style->wid = rofi_theme_find_widget(name, state, FALSE);
+    style->properties =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    style->state = g_strdup(state_key);
+    g_hash_table_insert(states, (gpointer)style->state, style);
+  }
+  return style;
+}
+
+static Property *rofi_theme_style_find_property(ThemeStyle *style,
+                                                PropertyType type,
+                                                const char *property) {
+  ThemeStyleEntry *entry = g_hash_table_lookup(style->properties, property);
+  if (entry == NULL) {
+    entry = g_new0(ThemeStyleEntry, 1);
+    g_hash_table_insert(style->properties, g_strdup(property), entry);
+  }
+  if ((entry->resolved & (1u << type)) == 0) {
+    entry->p[type] =
+        rofi_theme_find_property(style->wid, type, property, FALSE);
+    entry->resolved |= (1u << type);
+  }
+  return entry->p[type];
+}
+
+/**
+ * Find a property for the given widget name and state.
+ * Used when resolving inherited properties.
+ */
+static Property *rofi_theme_find_widget_property(const char *name,
+                                                 const char *state,
+                                                 PropertyType type,
+                                                 const char *property) {
+  return rofi_theme_style_find_property(rofi_theme_style_lookup(name, state),
+                                        type, property);
+}
+
+/**
+ * Find a property for the widget, using the style it keeps for its current
+ * state. The style is looked up again when the theme or the state changed.
+ */
+static Property *rofi_theme_widget_find_property(const widget *wid,
+                                                 PropertyType type,
+                                                 const char *property) {
+  if (wid->style == NULL || wid->style_generation != theme_style_generation ||
+      g_strcmp0(wid->style->state, wid->state ? wid->state : "") != 0) {
+    // The style is a cache, the widget itself is not modified.
+    widget *w = (widget *)wid;
+    w->style = rofi_theme_style_lookup(wid->name, wid->state);
+    w->style_generation = theme_style_generation;
+  }
+  return rofi_theme_style_find_property(wid->style, type, property);
+}
+
 static int rofi_theme_get_position_inside(Property *p, const widget *wid,
                                           const char *property, int def) {
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_POSITION, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_POSITION, property);
         return rofi_theme_get_position_inside(pv, wid->parent, property, def);
       }
       return def;
@@ -816,8 +945,7 @@ static int rofi_theme_get_position_inside(Property *p, const widget *wid,
   return def;
 }
 int rofi_theme_get_position(const widget *wid, const char *property, int def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_POSITION, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_POSITION, property);
   return rofi_theme_get_position_inside(p, wid, property, def);
 }
 static int rofi_theme_get_integer_inside(Property *p, const widget *wid,
@@ -825,10 +953,8 @@ static int rofi_theme_get_integer_inside(Property *p, const widget *wid,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_INTEGER, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_INTEGER, property);
         return rofi_theme_get_integer_inside(pv, wid->parent, property, def);
       }
       return def;
@@ -840,8 +966,7 @@ static int rofi_theme_get_integer_inside(Property *p, const widget *wid,
   return def;
 }
 int rofi_theme_get_integer(const widget *wid, const char *property, int def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_INTEGER, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_INTEGER, property);
   return (int)rofi_theme_get_integer_inside(p, wid, property, (double)def);
 }
 static RofiDistance rofi_theme_get_distance_inside(Property *p,
@@ -851,10 +976,8 @@ static RofiDistance rofi_theme_get_distance_inside(Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_PADDING, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_PADDING, property);
         return rofi_theme_get_distance_inside(pv, wid->parent, property, def);
       }
       return (RofiDistance){
@@ -876,8 +999,7 @@ static RofiDistance rofi_theme_get_distance_inside(Property *p,
 }
 RofiDistance rofi_theme_get_distance(const widget *wid, const char *property,
                                      int def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_PADDING, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_PADDING, property);
   return rofi_theme_get_distance_inside(p, wid, property, def);
 }
 
@@ -886,10 +1008,8 @@ static int rofi_theme_get_boolean_inside(Property *p, const widget *wid,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_BOOLEAN, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_BOOLEAN, property);
         return rofi_theme_get_boolean_inside(pv, wid->parent, property, def);
       }
       return def;
@@ -901,8 +1021,7 @@ static int rofi_theme_get_boolean_inside(Property *p, const widget *wid,
   return def;
 }
 int rofi_theme_get_boolean(const widget *wid, const char *property, int def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_BOOLEAN, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_BOOLEAN, property);
   return rofi_theme_get_boolean_inside(p, wid, property, def);
 }
 
@@ -913,10 +1032,8 @@ static RofiOrientation rofi_theme_get_orientation_inside(Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_ORIENTATION, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_ORIENTATION, property);
         return rofi_theme_get_orientation_inside(pv, wid->parent, property,
                                                  def);
       }
@@ -931,9 +1048,7 @@ static RofiOrientation rofi_theme_get_orientation_inside(Property *p,
 RofiOrientation rofi_theme_get_orientation(const widget *wid,
                                            const char *property,
                                            RofiOrientation def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p =
-      rofi_theme_find_property(wid_find, P_ORIENTATION, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_ORIENTATION, property);
   return rofi_theme_get_orientation_inside(p, wid, property, def);
 }
 
@@ -944,10 +1059,8 @@ static RofiCursorType rofi_theme_get_cursor_type_inside(Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_CURSOR, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_CURSOR, property);
         return rofi_theme_get_cursor_type_inside(pv, wid->parent, property,
                                                  def);
       }
@@ -962,8 +1075,7 @@ static RofiCursorType rofi_theme_get_cursor_type_inside(Property *p,
 RofiCursorType rofi_theme_get_cursor_type(const widget *wid,
                                           const char *property,
                                           RofiCursorType def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_CURSOR, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_CURSOR, property);
   return rofi_theme_get_cursor_type_inside(p, wid, property, def);
 }
 static const char *rofi_theme_get_string_inside(Property *p, const widget *wid,
@@ -972,10 +1084,8 @@ static const char *rofi_theme_get_string_inside(Property *p, const widget *wid,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_STRING, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_STRING, property);
         return rofi_theme_get_string_inside(pv, wid->parent, property, def);
       }
       return def;
@@ -988,8 +1098,7 @@ static const char *rofi_theme_get_string_inside(Property *p, const widget *wid,
 }
 const char *rofi_theme_get_string(const widget *wid, const char *property,
                                   const char *def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_STRING, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_STRING, property);
   return rofi_theme_get_string_inside(p, wid, property, def);
 }
 
@@ -1000,10 +1109,8 @@ static double rofi_theme_get_double_integer_fb_inside(Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_INTEGER, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_INTEGER, property);
         return rofi_theme_get_double_integer_fb_inside(pv, wid->parent,
                                                        property, def);
       }
@@ -1021,10 +1128,8 @@ static double rofi_theme_get_double_inside(const widget *orig, Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_DOUBLE, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_DOUBLE, property);
         return rofi_theme_get_double_inside(orig, pv, wid->parent, property,
                                             def);
       }
@@ -1032,15 +1137,14 @@ static double rofi_theme_get_double_inside(const widget *orig, Property *p,
     }
     return p->value.f;
   }
-  ThemeWidget *wid_find = rofi_theme_find_widget(orig->name, wid->state, FALSE);
   // Fallback to integer if double is not found.
-  p = rofi_theme_find_property(wid_find, P_INTEGER, property, FALSE);
+  p = rofi_theme_find_widget_property(orig->name, wid->state, P_INTEGER,
+                                      property);
   return rofi_theme_get_double_integer_fb_inside(p, wid, property, def);
 }
 double rofi_theme_get_double(const widget *wid, const char *property,
                              double def) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_DOUBLE, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_DOUBLE, property);
   return rofi_theme_get_double_inside(wid, p, wid, property, def);
 }
 static void rofi_theme_get_color_inside(const widget *wid, Property *p,
@@ -1048,10 +1152,8 @@ static void rofi_theme_get_color_inside(const widget *wid, Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_COLOR, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_COLOR, property);
         rofi_theme_get_color_inside(wid->parent, pv, property, d);
       }
       return;
@@ -1065,8 +1167,7 @@ static void rofi_theme_get_color_inside(const widget *wid, Property *p,
 }
 
 void rofi_theme_get_color(const widget *wid, const char *property, cairo_t *d) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_COLOR, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_COLOR, property);
   rofi_theme_get_color_inside(wid, p, property, d);
 }
 
@@ -1076,10 +1177,8 @@ static gboolean rofi_theme_get_image_inside(Property *p, const widget *wid,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_IMAGE, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_IMAGE, property);
         return rofi_theme_get_image_inside(pv, wid->parent, property, d);
       }
       return FALSE;
@@ -1173,8 +1272,7 @@ static gboolean rofi_theme_get_image_inside(Property *p, const widget *wid,
 }
 gboolean rofi_theme_get_image(const widget *wid, const char *property,
                               cairo_t *d) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_IMAGE, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_IMAGE, property);
   return rofi_theme_get_image_inside(p, wid, property, d);
 }
 static RofiPadding rofi_theme_get_padding_inside(Property *p, const widget *wid,
@@ -1183,10 +1281,8 @@ static RofiPadding rofi_theme_get_padding_inside(Property *p, const widget *wid,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_PADDING, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_PADDING, property);
         return rofi_theme_get_padding_inside(pv, wid->parent, property, pad);
       }
       return pad;
@@ -1207,8 +1303,7 @@ static RofiPadding rofi_theme_get_padding_inside(Property *p, const widget *wid,
 }
 RofiPadding rofi_theme_get_padding(const widget *wid, const char *property,
                                    RofiPadding pad) {
-  ThemeWidget *wid_find = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid_find, P_PADDING, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_PADDING, property);
   return rofi_theme_get_padding_inside(p, wid, property, pad);
 }
 
@@ -1218,10 +1313,8 @@ static GList *rofi_theme_get_list_inside(Property *p, const widget *wid,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_LIST, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_LIST, property);
         return rofi_theme_get_list_inside(pv, wid->parent, property,
                                           child_type);
       }
@@ -1232,8 +1325,7 @@ static GList *rofi_theme_get_list_inside(Property *p, const widget *wid,
   return NULL;
 }
 GList *rofi_theme_get_list_distance(const widget *wid, const char *property) {
-  ThemeWidget *wid2 = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid2, P_LIST, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_LIST, property);
   GList *list = rofi_theme_get_list_inside(p, wid, property, P_PADDING);
   GList *retv = NULL;
   for (GList *iter = g_list_first(list); iter != NULL;
@@ -1258,8 +1350,7 @@ GList *rofi_theme_get_list_distance(const widget *wid, const char *property) {
   return retv;
 }
 GList *rofi_theme_get_list_strings(const widget *wid, const char *property) {
-  ThemeWidget *wid2 = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p = rofi_theme_find_property(wid2, P_LIST, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_LIST, property);
   GList *list = rofi_theme_get_list_inside(p, wid, property, P_STRING);
   GList *retv = NULL;
   for (GList *iter = g_list_first(list); iter != NULL;
@@ -1280,10 +1371,8 @@ rofi_theme_get_highlight_inside(Property *p, widget *wid, const char *property,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid->parent->name, wid->state, FALSE);
-        Property *pv =
-            rofi_theme_find_property(parent, P_HIGHLIGHT, property, FALSE);
+        Property *pv = rofi_theme_find_widget_property(
+            wid->parent->name, wid->state, P_HIGHLIGHT, property);
         return rofi_theme_get_highlight_inside(pv, wid->parent, property, th);
       }
       return th;
@@ -1295,9 +1384,7 @@ rofi_theme_get_highlight_inside(Property *p, widget *wid, const char *property,
 
     return p->value.highlight;
   } else {
-    ThemeWidget *find_wid =
-        rofi_theme_find_widget(wid->name, wid->state, FALSE);
-    Property *p2 = rofi_theme_find_property(find_wid, P_COLOR, property, FALSE);
+    Property *p2 = rofi_theme_widget_find_property(wid, P_COLOR, property);
     if (p2 != NULL) {
       return rofi_theme_get_highlight_inside(p2, wid, property, th);
     }
@@ -1310,11 +1397,9 @@ rofi_theme_get_highlight_inside(Property *p, widget *wid, const char *property,
 RofiHighlightColorStyle rofi_theme_get_highlight(widget *wid,
                                                  const char *property,
                                                  RofiHighlightColorStyle th) {
-  ThemeWidget *found_wid = rofi_theme_find_widget(wid->name, wid->state, FALSE);
-  Property *p =
-      rofi_theme_find_property(found_wid, P_HIGHLIGHT, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid, P_HIGHLIGHT, property);
   if (p == NULL) {
-    p = rofi_theme_find_property(found_wid, P_COLOR, property, FALSE);
+    p = rofi_theme_widget_find_property(wid, P_COLOR, property);
   }
   return rofi_theme_get_highlight_inside(p, wid, property, th);
 }
@@ -1407,6 +1492,18 @@ int distance_get_pixel(RofiDistance d, RofiOrientation ori) {
   return distance_unit_get_pixel(&(d.base), ori);
 }
 
+/** Generation of the values distances are converted with, never 0. */
+static unsigned int distance_generation = 1;
+
+void distance_bump_generation(void) {
+  distance_generation++;
+  if (distance_generation == 0) {
+    distance_generation = 1;
+  }
+}
+
+unsigned int distance_get_generation(void) { return distance_generation; }
+
 void distance_get_linestyle(RofiDistance d, cairo_t *draw) {
   if (d.style == ROFI_HL_DASH) {
     const double dashes[1] = {4};
@@ -1604,6 +1701,7 @@ void rofi_theme_parse_process_conditionals(void) {
   workarea mon;
   monitor_active(&mon);
   rofi_theme_parse_process_conditionals_int(mon, rofi_theme);
+  rofi_theme_style_cache_clear();
 }
 
 ThemeMediaType rofi_theme_parse_media_type(const char *type) {
@@ -1640,10 +1738,8 @@ static gboolean rofi_theme_has_property_inside(Property *p,
   if (p) {
     if (p->type == P_INHERIT) {
       if (wid_in->parent) {
-        ThemeWidget *parent =
-            rofi_theme_find_widget(wid_in->parent->name, wid_in->state, FALSE);
-        Property *pp =
-            rofi_theme_find_property(parent, P_STRING, property, FALSE);
+        Property *pp = rofi_theme_find_widget_property(
+            wid_in->parent->name, wid_in->state, P_STRING, property);
         return rofi_theme_has_property_inside(pp, wid_in->parent, property);
       }
       return FALSE;
@@ -1653,9 +1749,542 @@ static gboolean rofi_theme_has_property_inside(Property *p,
   return FALSE;
 }
 gboolean rofi_theme_has_property(const widget *wid_in, const char *property) {
-  ThemeWidget *wid = rofi_theme_find_widget(wid_in->name, wid_in->state, FALSE);
-  Property *p = rofi_theme_find_property(wid, P_STRING, property, FALSE);
+  Property *p = rofi_theme_widget_find_property(wid_in, P_STRING, property);
   return rofi_theme_has_property_inside(p, wid_in, property);
 }
 
 void rofi_theme_set_disp_scale_func(disp_scale_func func) { disp_scale = func; }
+
+/**
+ * Theme cache
+ *
+ * The parsed theme tree (before conditionals and links are processed) is
+ * stored in a flat binary file, keyed on the files that were parsed and the
+ * environment variables that were read while parsing.
+ */
+
+/** Magic at the start of the theme cache file. */
+#define THEME_CACHE_MAGIC 0x43485452u
+/** Version of the theme cache format. */
+#define THEME_CACHE_VERSION 2u
+/** Limit nesting when reading, so a corrupt file cannot exhaust the stack. */
+#define THEME_CACHE_MAX_DEPTH 64
+
+/** State recorded while parsing a theme that can be cached. */
+static struct {
+  /** Recording is active. */
+  gboolean active;
+  /** Something was parsed that does not end up in the theme tree. */
+  gboolean uncacheable;
+  /** Length of parsed_config_files when recording started. */
+  guint num_files;
+  /** Names of environment variables read. */
+  GPtrArray *env_names;
+  /** Values of environment variables read (NULL when unset). */
+  GPtrArray *env_values;
+} theme_cache_record = {FALSE, FALSE, 0, NULL, NULL};
+
+/** Reader over the mapped cache file. */
+typedef struct {
+  /** The data. */
+  const guint8 *data;
+  /** Length of data. */
+  gsize len;
+  /** Read position. */
+  gsize pos;
+  /** Data was truncated or invalid. */
+  gboolean error;
+} ThemeCacheReader;
+
+static void theme_cache_put(GByteArray *b, const void *v, guint len) {
+  g_byte_array_append(b, (const guint8 *)v, len);
+}
+static void theme_cache_put_u32(GByteArray *b, guint32 v) {
+  theme_cache_put(b, &v, sizeof(v));
+}
+static void theme_cache_put_i64(GByteArray *b, gint64 v) {
+  theme_cache_put(b, &v, sizeof(v));
+}
+static void theme_cache_put_double(GByteArray *b, double v) {
+  theme_cache_put(b, &v, sizeof(v));
+}
+static void theme_cache_put_str(GByteArray *b, const char *s) {
+  if (s == NULL) {
+    theme_cache_put_u32(b, G_MAXUINT32);
+    return;
+  }
+  guint32 len = strlen(s);
+  theme_cache_put_u32(b, len);
+  theme_cache_put(b, s, len);
+}
+static void theme_cache_put_color(GByteArray *b, const ThemeColor *c) {
+  theme_cache_put_double(b, c->red);
+  theme_cache_put_double(b, c->green);
+  theme_cache_put_double(b, c->blue);
+  theme_cache_put_double(b, c->alpha);
+}
+static void theme_cache_put_distance_unit(GByteArray *b,
+                                          const RofiDistanceUnit *unit) {
+  theme_cache_put_double(b, unit->distance);
+  theme_cache_put_u32(b, unit->type);
+  theme_cache_put_u32(b, unit->modtype);
+  theme_cache_put_u32(b, unit->left != NULL);
+  if (unit->left) {
+    theme_cache_put_distance_unit(b, unit->left);
+  }
+  theme_cache_put_u32(b, unit->right != NULL);
+  if (unit->right) {
+    theme_cache_put_distance_unit(b, unit->right);
+  }
+}
+static void theme_cache_put_distance(GByteArray *b, const RofiDistance *d) {
+  theme_cache_put_distance_unit(b, &(d->base));
+  theme_cache_put_u32(b, d->style);
+}
+
+static void theme_cache_put_property(GByteArray *b, const Property *p) {
+  theme_cache_put_str(b, p->name);
+  theme_cache_put_u32(b, p->type);
+  switch (p->type) {
+  case P_INTEGER:
+  case P_POSITION:
+  case P_ORIENTATION:
+  case P_CURSOR:
+    theme_cache_put_u32(b, (guint32)p->value.i);
+    break;
+  case P_DOUBLE:
+    theme_cache_put_double(b, p->value.f);
+    break;
+  case P_STRING:
+    theme_cache_put_str(b, p->value.s);
+    break;
+  case P_CHAR:
+    theme_cache_put_u32(b, (guint8)p->value.c);
+    break;
+  case P_BOOLEAN:
+    theme_cache_put_u32(b, p->value.b);
+    break;
+  case P_COLOR:
+    theme_cache_put_color(b, &(p->value.color));
+    break;
+  case P_PADDING:
+    theme_cache_put_distance(b, &(p->value.padding.top));
+    theme_cache_put_distance(b, &(p->value.padding.right));
+    theme_cache_put_distance(b, &(p->value.padding.bottom));
+    theme_cache_put_distance(b, &(p->value.padding.left));
+    break;
+  case P_LINK:
+    theme_cache_put_str(b, p->value.link.name);
+    theme_cache_put_u32(b, p->value.link.def_value != NULL);
+    if (p->value.link.def_value) {
+      theme_cache_put_property(b, p->value.link.def_value);
+    }
+    break;
+  case P_HIGHLIGHT:
+    theme_cache_put_u32(b, p->value.highlight.style);
+    theme_cache_put_color(b, &(p->value.highlight.color));
+    break;
+  case P_IMAGE:
+    theme_cache_put_u32(b, p->value.image.type);
+    theme_cache_put_str(b, p->value.image.url);
+    theme_cache_put_u32(b, p->value.image.scaling);
+    theme_cache_put_u32(b, (guint32)p->value.image.wsize);
+    theme_cache_put_u32(b, (guint32)p->value.image.hsize);
+    theme_cache_put_u32(b, p->value.image.dir);
+    theme_cache_put_double(b, p->value.image.angle);
+    theme_cache_put_u32(b, g_list_length(p->value.image.colors));
+    for (GList *l = g_list_first(p->value.image.colors); l;
+         l = g_list_next(l)) {
+      theme_cache_put_color(b, (ThemeColor *)l->data);
+    }
+    break;
+  case P_LIST:
+    theme_cache_put_u32(b, g_list_length(p->value.list));
+    for (GList *l = g_list_first(p->value.list); l; l = g_list_next(l)) {
+      theme_cache_put_property(b, (Property *)l->data);
+    }
+    break;
+  case P_INHERIT:
+  default:
+    break;
+  }
+}
+
+static void theme_cache_put_widget(GByteArray *b, const ThemeWidget *wid) {
+  theme_cache_put_u32(b, wid->set);
+  theme_cache_put_str(b, wid->name);
+  theme_cache_put_u32(b, wid->media != NULL);
+  if (wid->media) {
+    theme_cache_put_u32(b, wid->media->type);
+    theme_cache_put_double(b, wid->media->value);
+    theme_cache_put_u32(b, wid->media->boolv);
+  }
+  theme_cache_put_u32(
+      b, wid->properties ? g_hash_table_size(wid->properties) : 0);
+  if (wid->properties) {
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, wid->properties);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+      theme_cache_put_property(b, (Property *)value);
+    }
+  }
+  theme_cache_put_u32(b, wid->num_widgets);
+  for (unsigned int i = 0; i < wid->num_widgets; i++) {
+    theme_cache_put_widget(b, wid->widgets[i]);
+  }
+}
+
+static gboolean theme_cache_get(ThemeCacheReader *r, void *v, gsize len) {
+  if (r->error || len > (r->len - r->pos)) {
+    r->error = TRUE;
+    memset(v, 0, len);
+    return FALSE;
+  }
+  memcpy(v, r->data + r->pos, len);
+  r->pos += len;
+  return TRUE;
+}
+static guint32 theme_cache_get_u32(ThemeCacheReader *r) {
+  guint32 v;
+  theme_cache_get(r, &v, sizeof(v));
+  return v;
+}
+static gint64 theme_cache_get_i64(ThemeCacheReader *r) {
+  gint64 v;
+  theme_cache_get(r, &v, sizeof(v));
+  return v;
+}
+static double theme_cache_get_double(ThemeCacheReader *r) {
+  double v;
+  theme_cache_get(r, &v, sizeof(v));
+  return v;
+}
+/** Read a count, it can not be larger then the remaining data. */
+static guint32 theme_cache_get_count(ThemeCacheReader *r) {
+  guint32 v = theme_cache_get_u32(r);
+  if (v > (r->len - r->pos)) {
+    r->error = TRUE;
+    return 0;
+  }
+  return v;
+}
+static char *theme_cache_get_str(ThemeCacheReader *r) {
+  guint32 len = theme_cache_get_u32(r);
+  if (r->error || len == G_MAXUINT32) {
+    return NULL;
+  }
+  if (len > (r->len - r->pos)) {
+    r->error = TRUE;
+    return NULL;
+  }
+  char *s = g_strndup((const char *)(r->data + r->pos), len);
+  r->pos += len;
+  return s;
+}
+static void theme_cache_get_color(ThemeCacheReader *r, ThemeColor *c) {
+  c->red = theme_cache_get_double(r);
+  c->green = theme_cache_get_double(r);
+  c->blue = theme_cache_get_double(r);
+  c->alpha = theme_cache_get_double(r);
+}
+static void theme_cache_get_distance_unit(ThemeCacheReader *r,
+                                          RofiDistanceUnit *unit, int depth) {
+  if (depth > THEME_CACHE_MAX_DEPTH) {
+    r->error = TRUE;
+    return;
+  }
+  unit->distance = theme_cache_get_double(r);
+  unit->type = theme_cache_get_u32(r);
+  unit->modtype = theme_cache_get_u32(r);
+  if (theme_cache_get_u32(r) && !r->error) {
+    unit->left = g_slice_new0(RofiDistanceUnit);
+    theme_cache_get_distance_unit(r, unit->left, depth + 1);
+  }
+  if (theme_cache_get_u32(r) && !r->error) {
+    unit->right = g_slice_new0(RofiDistanceUnit);
+    theme_cache_get_distance_unit(r, unit->right, depth + 1);
+  }
+}
+static void theme_cache_get_distance(ThemeCacheReader *r, RofiDistance *d) {
+  theme_cache_get_distance_unit(r, &(d->base), 0);
+  d->style = theme_cache_get_u32(r);
+}
+
+static Property *theme_cache_get_property(ThemeCacheReader *r, int depth) {
+  if (depth > THEME_CACHE_MAX_DEPTH) {
+    r->error = TRUE;
+    return NULL;
+  }
+  char *name = theme_cache_get_str(r);
+  guint32 type = theme_cache_get_u32(r);
+  if (r->error || type >= P_NUM_TYPES) {
+    r->error = TRUE;
+    g_free(name);
+    return NULL;
+  }
+  Property *p = rofi_theme_property_create(type);
+  p->name = name;
+  switch (p->type) {
+  case P_INTEGER:
+  case P_POSITION:
+  case P_ORIENTATION:
+  case P_CURSOR:
+    p->value.i = (int)theme_cache_get_u32(r);
+    break;
+  case P_DOUBLE:
+    p->value.f = theme_cache_get_double(r);
+    break;
+  case P_STRING:
+    p->value.s = theme_cache_get_str(r);
+    break;
+  case P_CHAR:
+    p->value.c = (char)theme_cache_get_u32(r);
+    break;
+  case P_BOOLEAN:
+    p->value.b = theme_cache_get_u32(r);
+    break;
+  case P_COLOR:
+    theme_cache_get_color(r, &(p->value.color));
+    break;
+  case P_PADDING:
+    theme_cache_get_distance(r, &(p->value.padding.top));
+    theme_cache_get_distance(r, &(p->value.padding.right));
+    theme_cache_get_distance(r, &(p->value.padding.bottom));
+    theme_cache_get_distance(r, &(p->value.padding.left));
+    break;
+  case P_LINK:
+    p->value.link.name = theme_cache_get_str(r);
+    if (theme_cache_get_u32(r) && !r->error) {
+      p->value.link.def_value = theme_cache_get_property(r, depth + 1);
+    }
+    break;
+  case P_HIGHLIGHT:
+    p->value.highlight.style = theme_cache_get_u32(r);
+    theme_cache_get_color(r, &(p->value.highlight.color));
+    break;
+  case P_IMAGE: {
+    p->value.image.type = theme_cache_get_u32(r);
+    p->value.image.url = theme_cache_get_str(r);
+    p->value.image.scaling = theme_cache_get_u32(r);
+    p->value.image.wsize = (int)theme_cache_get_u32(r);
+    p->value.image.hsize = (int)theme_cache_get_u32(r);
+    p->value.image.dir = theme_cache_get_u32(r);
+    p->value.image.angle = theme_cache_get_double(r);
+    guint32 n = theme_cache_get_count(r);
+    for (guint32 i = 0; i < n && !r->error; i++) {
+      ThemeColor *c = g_new0(ThemeColor, 1);
+      theme_cache_get_color(r, c);
+      p->value.image.colors = g_list_append(p->value.image.colors, c);
+    }
+    break;
+  }
+  case P_LIST: {
+    guint32 n = theme_cache_get_count(r);
+    for (guint32 i = 0; i < n && !r->error; i++) {
+      Property *e = theme_cache_get_property(r, depth + 1);
+      if (e != NULL) {
+        p->value.list = g_list_append(p->value.list, e);
+      }
+    }
+    break;
+  }
+  case P_INHERIT:
+  default:
+    break;
+  }
+  return p;
+}
+
+static ThemeWidget *theme_cache_get_widget(ThemeCacheReader *r,
+                                           ThemeWidget *parent, int depth) {
+  if (depth > THEME_CACHE_MAX_DEPTH) {
+    r->error = TRUE;
+    return NULL;
+  }
+  ThemeWidget *wid = g_slice_new0(ThemeWidget);
+  wid->parent = parent;
+  wid->set = theme_cache_get_u32(r);
+  wid->name = theme_cache_get_str(r);
+  if (theme_cache_get_u32(r) && !r->error) {
+    wid->media = g_slice_new0(ThemeMedia);
+    wid->media->type = theme_cache_get_u32(r);
+    wid->media->value = theme_cache_get_double(r);
+    wid->media->boolv = theme_cache_get_u32(r);
+  }
+  guint32 num_properties = theme_cache_get_count(r);
+  if (num_properties > 0) {
+    wid->properties =
+        g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                              (GDestroyNotify)rofi_theme_property_free);
+  }
+  for (guint32 i = 0; i < num_properties && !r->error; i++) {
+    Property *p = theme_cache_get_property(r, 0);
+    if (p != NULL) {
+      g_hash_table_replace(wid->properties, p->name, p);
+    }
+  }
+  guint32 num_widgets = theme_cache_get_count(r);
+  if (num_widgets > 0) {
+    wid->widgets = g_malloc0(num_widgets * sizeof(ThemeWidget *));
+  }
+  for (guint32 i = 0; i < num_widgets && !r->error; i++) {
+    ThemeWidget *child = theme_cache_get_widget(r, wid, depth + 1);
+    if (child != NULL) {
+      wid->widgets[wid->num_widgets++] = child;
+    }
+  }
+  return wid;
+}
+
+/**
+ * @param file The file to stat.
+ * @param mtime Set to the modification time, in nanoseconds.
+ * @param size Set to the size.
+ *
+ * @returns TRUE when the file could be stat'ed.
+ */
+static gboolean theme_cache_stat(const char *file, gint64 *mtime,
+                                 gint64 *size) {
+  GStatBuf st;
+  if (g_stat(file, &st) != 0) {
+    return FALSE;
+  }
+  // Seconds alone miss a save in the same second keeping the size.
+#if defined(__APPLE__)
+  *mtime = (gint64)st.st_mtimespec.tv_sec * G_GINT64_CONSTANT(1000000000) +
+           st.st_mtimespec.tv_nsec;
+#else
+  *mtime = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) +
+           st.st_mtim.tv_nsec;
+#endif
+  *size = (gint64)st.st_size;
+  return TRUE;
+}
+
+const char *rofi_theme_parse_getenv(const char *name) {
+  const char *val = g_getenv(name);
+  if (theme_cache_record.active) {
+    g_ptr_array_add(theme_cache_record.env_names, g_strdup(name));
+    g_ptr_array_add(theme_cache_record.env_values, g_strdup(val));
+  }
+  return val;
+}
+
+void rofi_theme_parse_uncacheable(void) {
+  if (theme_cache_record.active) {
+    theme_cache_record.uncacheable = TRUE;
+  }
+}
+
+void rofi_theme_cache_record_begin(void) {
+  rofi_theme_cache_record_end(NULL, NULL);
+  theme_cache_record.active = TRUE;
+  theme_cache_record.uncacheable = FALSE;
+  theme_cache_record.num_files = g_list_length(parsed_config_files);
+  theme_cache_record.env_names = g_ptr_array_new_with_free_func(g_free);
+  theme_cache_record.env_values = g_ptr_array_new_with_free_func(g_free);
+}
+
+void rofi_theme_cache_record_end(const char *cache_file, const char *file) {
+  if (!theme_cache_record.active) {
+    return;
+  }
+  theme_cache_record.active = FALSE;
+  GList *files = g_list_nth(parsed_config_files, theme_cache_record.num_files);
+  if (cache_file != NULL && file != NULL && rofi_theme != NULL &&
+      !theme_cache_record.uncacheable && files != NULL &&
+      g_strcmp0(files->data, file) == 0) {
+    GByteArray *b = g_byte_array_new();
+    gboolean valid = TRUE;
+    theme_cache_put_u32(b, THEME_CACHE_MAGIC);
+    theme_cache_put_u32(b, THEME_CACHE_VERSION);
+    theme_cache_put_u32(b, g_list_length(files));
+    for (GList *iter = files; valid && iter != NULL; iter = g_list_next(iter)) {
+      gint64 mtime = 0, size = 0;
+      valid = theme_cache_stat(iter->data, &mtime, &size);
+      theme_cache_put_str(b, iter->data);
+      theme_cache_put_i64(b, mtime);
+      theme_cache_put_i64(b, size);
+    }
+    theme_cache_put_u32(b, theme_cache_record.env_names->len);
+    for (guint i = 0; i < theme_cache_record.env_names->len; i++) {
+      theme_cache_put_str(b,
+                          g_ptr_array_index(theme_cache_record.env_names, i));
+      theme_cache_put_str(b,
+                          g_ptr_array_index(theme_cache_record.env_values, i));
+    }
+    theme_cache_put_widget(b, rofi_theme);
+    if (valid) {
+      GError *error = NULL;
+      if (!g_file_set_contents(cache_file, (const char *)b->data, b->len,
+                               &error)) {
+        g_debug("Failed to write theme cache: %s", error->message);
+        g_error_free(error);
+      }
+    }
+    g_byte_array_free(b, TRUE);
+  }
+  g_ptr_array_free(theme_cache_record.env_names, TRUE);
+  g_ptr_array_free(theme_cache_record.env_values, TRUE);
+  theme_cache_record.env_names = NULL;
+  theme_cache_record.env_values = NULL;
+}
+
+gboolean rofi_theme_cache_load(const char *cache_file, const char *file) {
+  if (cache_file == NULL || file == NULL) {
+    return FALSE;
+  }
+  GMappedFile *mf = g_mapped_file_new(cache_file, FALSE, NULL);
+  if (mf == NULL) {
+    return FALSE;
+  }
+  ThemeCacheReader r = {(const guint8 *)g_mapped_file_get_contents(mf),
+                        g_mapped_file_get_length(mf), 0, FALSE};
+  GList *files = NULL;
+  ThemeWidget *root = NULL;
+  gboolean valid = theme_cache_get_u32(&r) == THEME_CACHE_MAGIC &&
+                   theme_cache_get_u32(&r) == THEME_CACHE_VERSION;
+
+  // Every file that was parsed must be unchanged, the first is the theme.
+  guint32 num_files = valid ? theme_cache_get_count(&r) : 0;
+  valid = valid && num_files > 0;
+  for (guint32 i = 0; valid && i < num_files; i++) {
+    char *path = theme_cache_get_str(&r);
+    gint64 mtime = theme_cache_get_i64(&r);
+    gint64 size = theme_cache_get_i64(&r);
+    gint64 cur_mtime = 0, cur_size = 0;
+    valid = !r.error && path != NULL &&
+            (i > 0 || g_strcmp0(path, file) == 0) &&
+            theme_cache_stat(path, &cur_mtime, &cur_size) &&
+            mtime == cur_mtime && size == cur_size;
+    files = g_list_append(files, path);
+  }
+  // And the environment variables used should have the same value.
+  guint32 num_env = valid ? theme_cache_get_count(&r) : 0;
+  for (guint32 i = 0; valid && i < num_env; i++) {
+    char *name = theme_cache_get_str(&r);
+    char *val = theme_cache_get_str(&r);
+    valid = !r.error && name != NULL && g_strcmp0(g_getenv(name), val) == 0;
+    g_free(name);
+    g_free(val);
+  }
+  if (valid) {
+    root = theme_cache_get_widget(&r, NULL, 0);
+    valid = !r.error && r.pos == r.len;
+  }
+  g_mapped_file_unref(mf);
+
+  if (!valid) {
+    g_debug("Theme cache %s is not valid for: %s", cache_file, file);
+    rofi_theme_free(root);
+    g_list_free_full(files, g_free);
+    return FALSE;
+  }
+  g_debug("Loaded theme: %s from cache: %s", file, cache_file);
+  rofi_theme_free(rofi_theme);
+  rofi_theme = root;
+  parsed_config_files = g_list_concat(parsed_config_files, files);
+  rofi_theme_style_cache_clear();
+  return TRUE;
+}
@@ -30,8 +30,12 @@
 
 #include "timings.h"
 #include "config.h"
+#include "helper.h"
 #include "rofi.h"
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 /**
  * Timer used to calculate time stamps.
  */
@@ -41,10 +45,158 @@ GTimer *global_timer = NULL;
  */
 double global_timer_last = 0.0;
 
+gboolean rofi_timings_profiling = FALSE;
+
+/** Stop recording after this many events, so a long session can't run away. */
+#define PROFILE_MAX_EVENTS (1 << 20)
+
+/**
+ * Type of a recorded event.
+ */
+typedef enum {
+  /** Start of a span. */
+  PROFILE_SPAN_BEGIN,
+  /** End of a span. */
+  PROFILE_SPAN_END,
+  /** A TICK() */
+  PROFILE_INSTANT,
+  /** New counter total. */
+  PROFILE_COUNTER,
+} ProfileEventType;
+
+/**
+ * A recorded event.
+ */
+typedef struct {
+  /** The type. */
+  ProfileEventType type;
+  /** Interned name. */
+  const char *name;
+  /** Microseconds since start. */
+  gint64 time;
+  /** Small id of the recording thread. */
+  guint tid;
+  /** Span nesting depth on the recording thread. */
+  guint depth;
+  /** Counter total. */
+  gint64 value;
+} ProfileEvent;
+
+/**
+ * Per thread profile state.
+ */
+typedef struct {
+  /** Small id of the thread, in order of first event. */
+  guint tid;
+  /** Open spans. */
+  guint depth;
+} ProfileThread;
+
+/**
+ * The profile trace.
+ */
+static struct {
+  /** Guards everything below. */
+  GMutex lock;
+  /** Start time. */
+  gint64 start;
+  /** Output file. */
+  char *path;
+  /** Recorded ProfileEvent's */
+  GArray *events;
+  /** Counter name to running total. */
+  GHashTable *counters;
+  /** Events not recorded because of PROFILE_MAX_EVENTS. */
+  guint dropped;
+  /** Last handed out thread id. */
+  gint last_tid;
+} profile;
+
+static GPrivate profile_thread = G_PRIVATE_INIT(g_free);
+
+gboolean rofi_timings_latency = FALSE;
+
+/** Stop adding samples to a step after this many. */
+#define LATENCY_MAX_SAMPLES (1 << 16)
+
+/** Names of the latency steps, as printed. */
+static const char *const latency_step_names[ROFI_LATENCY_NUM_STEPS] = {
+    "input-to-refilter", "refilter",       "draw",
+    "commit",            "frame-callback", "input-to-paint",
+};
+
+/**
+ * Input latency histograms. Only touched from the main loop.
+ */
+static struct {
+  /** Output file, "-" for stderr. */
+  char *path;
+  /** Time of the oldest key event not yet painted, 0 if none. */
+  gint64 input;
+  /** Number of key events. */
+  guint inputs;
+  /** Start time of the running steps, 0 if not running. */
+  gint64 begin[ROFI_LATENCY_NUM_STEPS];
+  /** Durations in microseconds (guint32) of each step. */
+  GArray *samples[ROFI_LATENCY_NUM_STEPS];
+} latency;
+
+static ProfileThread *rofi_timings_thread(void) {
+  ProfileThread *pt = g_private_get(&profile_thread);
+  if (pt == NULL) {
+    pt = g_new0(ProfileThread, 1);
+    pt->tid = (guint)g_atomic_int_add(&(profile.last_tid), 1) + 1;
+    g_private_set(&profile_thread, pt);
+  }
+  return pt;
+}
+
+static void rofi_timings_record(ProfileEventType type, const char *name,
+                                guint depth, gint64 value) {
+  ProfileThread *pt = rofi_timings_thread();
+  ProfileEvent ev = {
+      .type = type,
+      .name = g_intern_string(name),
+      .time = g_get_monotonic_time() - profile.start,
+      .tid = pt->tid,
+      .depth = depth,
+      .value = value,
+  };
+  g_mutex_lock(&(profile.lock));
+  if (profile.events == NULL) {
+    // Profiling stopped, a worker thread can still be running.
+  } else if (profile.events->len < PROFILE_MAX_EVENTS) {
+    g_array_append_val(profile.events, ev);
+  } else {
+    profile.dropped++;
+  }
+  g_mutex_unlock(&(profile.lock));
+}
+
 void rofi_timings_init(void) {
   global_timer = g_timer_new();
   double now = g_timer_elapsed(global_timer, NULL);
   g_debug("%4.6f (%2.6f): Started", now, 0.0);
+
+  char *path = NULL;
+  if (find_arg_str("-profile-out", &path) && path != NULL) {
+    g_mutex_init(&(profile.lock));
+    profile.start = g_get_monotonic_time();
+    profile.path = rofi_expand_path(path);
+    profile.events = g_array_sized_new(FALSE, FALSE, sizeof(ProfileEvent), 1024);
+    profile.counters =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    rofi_timings_profiling = TRUE;
+  }
+  path = NULL;
+  if (find_arg_str("-latency-out", &path) && path != NULL) {
+    latency.path = g_strcmp0(path, "-") == 0 ? g_strdup(path)
+                                             : rofi_expand_path(path);
+    for (int i = 0; i < ROFI_LATENCY_NUM_STEPS; i++) {
+      latency.samples[i] = g_array_new(FALSE, FALSE, sizeof(guint32));
+    }
+    rofi_timings_latency = TRUE;
+  }
 }
 
 void rofi_timings_tick(const char *file, char const *str, int line,
@@ -54,10 +206,277 @@ void rofi_timings_tick(const char *file, char const *str, int line,
   g_debug("%4.6f (%2.6f): %s:%s:%-3d %s", now, now - global_timer_last, file,
           str, line, msg);
   global_timer_last = now;
+  if (rofi_timings_profiling) {
+    rofi_timings_record(PROFILE_INSTANT, (msg[0] != '\0') ? msg : str,
+                        rofi_timings_thread()->depth, 0);
+  }
+}
+
+void rofi_timings_span_begin(const char *name) {
+  ProfileThread *pt = rofi_timings_thread();
+  rofi_timings_record(PROFILE_SPAN_BEGIN, name, pt->depth, 0);
+  pt->depth++;
+}
+
+void rofi_timings_span_end(const char *name) {
+  ProfileThread *pt = rofi_timings_thread();
+  if (pt->depth > 0) {
+    pt->depth--;
+  }
+  rofi_timings_record(PROFILE_SPAN_END, name, pt->depth, 0);
+}
+
+void rofi_timings_counter_add(const char *name, gint64 delta) {
+  const char *iname = g_intern_string(name);
+  g_mutex_lock(&(profile.lock));
+  if (profile.counters == NULL) {
+    g_mutex_unlock(&(profile.lock));
+    return;
+  }
+  gint64 *total = g_hash_table_lookup(profile.counters, iname);
+  if (total == NULL) {
+    total = g_new0(gint64, 1);
+    g_hash_table_insert(profile.counters, (gpointer)iname, total);
+  }
+  *total += delta;
+  gint64 value = *total;
+  g_mutex_unlock(&(profile.lock));
+  rofi_timings_record(PROFILE_COUNTER, iname, rofi_timings_thread()->depth,
+                      value);
+}
+
+static void rofi_timings_latency_add(RofiLatencyStep step, gint64 duration) {
+  if (latency.samples[step]->len < LATENCY_MAX_SAMPLES) {
+    guint32 us = (guint32)CLAMP(duration, 0, G_MAXUINT32);
+    g_array_append_val(latency.samples[step], us);
+  }
+}
+
+void rofi_timings_latency_input(void) {
+  latency.inputs++;
+  // Keys typed before the previous one is painted share its frame, measure
+  // from the oldest.
+  if (latency.input == 0) {
+    latency.input = g_get_monotonic_time();
+  }
+}
+
+void rofi_timings_latency_begin(RofiLatencyStep step) {
+  if (latency.input != 0) {
+    latency.begin[step] = g_get_monotonic_time();
+  }
+}
+
+void rofi_timings_latency_end(RofiLatencyStep step) {
+  if (latency.begin[step] != 0) {
+    rofi_timings_latency_add(step,
+                             g_get_monotonic_time() - latency.begin[step]);
+    latency.begin[step] = 0;
+  }
+}
+
+void rofi_timings_latency_mark(RofiLatencyStep step) {
+  if (latency.input == 0) {
+    return;
+  }
+  rofi_timings_latency_add(step, g_get_monotonic_time() - latency.input);
+  if (step == ROFI_LATENCY_INPUT_TO_PAINT) {
+    latency.input = 0;
+  }
+}
+
+static gint rofi_timings_latency_cmp(gconstpointer a, gconstpointer b) {
+  guint32 va = *(const guint32 *)a, vb = *(const guint32 *)b;
+  return (va > vb) - (va < vb);
+}
+
+/**
+ * @param sorted The sorted samples.
+ * @param p The percentile.
+ *
+ * @returns the nearest-rank percentile in milliseconds.
+ */
+static double rofi_timings_latency_percentile(GArray *sorted, guint p) {
+  guint rank = (p * sorted->len + 99) / 100;
+  rank = CLAMP(rank, 1, sorted->len);
+  return g_array_index(sorted, guint32, rank - 1) / 1000.0;
+}
+
+static void rofi_timings_latency_write(FILE *fp) {
+  // Upper bounds (ms) of the histogram buckets, the last is open.
+  static const double buckets[] = {0.5, 1, 2, 4, 8, 16, 33, 66};
+  const guint num_buckets = G_N_ELEMENTS(buckets) + 1;
+
+  fprintf(fp, "# rofi input latency, %u key events, times in ms\n",
+          latency.inputs);
+  fprintf(fp, "%-18s %8s %8s %8s %8s %8s\n", "step", "count", "p50", "p95",
+          "p99", "max");
+  for (int i = 0; i < ROFI_LATENCY_NUM_STEPS; i++) {
+    GArray *samples = latency.samples[i];
+    if (samples->len == 0) {
+      fprintf(fp, "%-18s %8u %8s %8s %8s %8s\n", latency_step_names[i], 0u,
+              "-", "-", "-", "-");
+      continue;
+    }
+    g_array_sort(samples, rofi_timings_latency_cmp);
+    fprintf(fp, "%-18s %8u %8.3f %8.3f %8.3f %8.3f\n", latency_step_names[i],
+            samples->len, rofi_timings_latency_percentile(samples, 50),
+            rofi_timings_latency_percentile(samples, 95),
+            rofi_timings_latency_percentile(samples, 99),
+            g_array_index(samples, guint32, samples->len - 1) / 1000.0);
+  }
+
+  fprintf(fp, "\n%-18s", "histogram");
+  for (guint b = 0; b < num_buckets; b++) {
+    char label[16];
+    if (b < G_N_ELEMENTS(buckets)) {
+      g_snprintf(label, sizeof(label), "<%g", buckets[b]);
+    } else {
+      g_snprintf(label, sizeof(label), ">=%g", buckets[b - 1]);
+    }
+    fprintf(fp, " %6s", label);
+  }
+  fputc('\n', fp);
+  for (int i = 0; i < ROFI_LATENCY_NUM_STEPS; i++) {
+    GArray *samples = latency.samples[i];
+    guint counts[G_N_ELEMENTS(buckets) + 1] = {0};
+    for (guint j = 0; j < samples->len; j++) {
+      double ms = g_array_index(samples, guint32, j) / 1000.0;
+      guint b = 0;
+      while (b < G_N_ELEMENTS(buckets) && ms >= buckets[b]) {
+        b++;
+      }
+      counts[b]++;
+    }
+    fprintf(fp, "%-18s", latency_step_names[i]);
+    for (guint b = 0; b < num_buckets; b++) {
+      fprintf(fp, " %6u", counts[b]);
+    }
+    fputc('\n', fp);
+  }
+}
+
+static void rofi_timings_latency_report(void) {
+  if (g_strcmp0(latency.path, "-") == 0) {
+    rofi_timings_latency_write(stderr);
+    return;
+  }
+  FILE *fp = fopen(latency.path, "w");
+  if (fp == NULL) {
+    g_warning("Failed to open latency output '%s': %s", latency.path,
+              g_strerror(errno));
+    return;
+  }
+  rofi_timings_latency_write(fp);
+  if (fclose(fp) != 0) {
+    g_warning("Failed to write latency output '%s': %s", latency.path,
+              g_strerror(errno));
+  }
+}
+
+/**
+ * Write a string with the quotes escaped for JSON or CSV.
+ */
+static void rofi_timings_write_string(FILE *fp, const char *str,
+                                      gboolean json) {
+  fputc('"', fp);
+  for (const char *c = str; *c != '\0'; c++) {
+    if (*c == '"') {
+      fputs(json ? "\\\"" : "\"\"", fp);
+    } else if (json && *c == '\\') {
+      fputs("\\\\", fp);
+    } else if ((unsigned char)*c < 0x20) {
+      fputc(' ', fp);
+    } else {
+      fputc(*c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+static void rofi_timings_write_json(FILE *fp) {
+  static const char *const phase[] = {"B", "E", "i", "C"};
+  int pid = (int)getpid();
+  fputs("{\"traceEvents\":[\n", fp);
+  for (guint i = 0; i < profile.events->len; i++) {
+    ProfileEvent *ev = &g_array_index(profile.events, ProfileEvent, i);
+    fputs("{\"name\":", fp);
+    rofi_timings_write_string(fp, ev->name, TRUE);
+    fprintf(fp, ",\"ph\":\"%s\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u",
+            phase[ev->type], ev->time, pid, ev->tid);
+    if (ev->type == PROFILE_INSTANT) {
+      fputs(",\"s\":\"t\"", fp);
+    } else if (ev->type == PROFILE_COUNTER) {
+      fprintf(fp, ",\"args\":{\"value\":%" G_GINT64_FORMAT "}", ev->value);
+    }
+    fputs((i + 1) < profile.events->len ? "},\n" : "}\n", fp);
+  }
+  fprintf(fp, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%u}}\n",
+          profile.dropped);
+}
+
+static void rofi_timings_write_csv(FILE *fp) {
+  static const char *const type[] = {"begin", "end", "tick", "counter"};
+  fputs("type,name,thread,depth,time_us,value\n", fp);
+  for (guint i = 0; i < profile.events->len; i++) {
+    ProfileEvent *ev = &g_array_index(profile.events, ProfileEvent, i);
+    fprintf(fp, "%s,", type[ev->type]);
+    rofi_timings_write_string(fp, ev->name, FALSE);
+    fprintf(fp, ",%u,%u,%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT "\n", ev->tid,
+            ev->depth, ev->time, ev->value);
+  }
+}
+
+static void rofi_timings_profile_write(void) {
+  FILE *fp = fopen(profile.path, "w");
+  if (fp == NULL) {
+    g_warning("Failed to open profile output '%s': %s", profile.path,
+              g_strerror(errno));
+    return;
+  }
+  g_mutex_lock(&(profile.lock));
+  if (g_str_has_suffix(profile.path, ".csv")) {
+    rofi_timings_write_csv(fp);
+  } else {
+    rofi_timings_write_json(fp);
+  }
+  if (profile.dropped > 0) {
+    g_warning("Profile trace full, %u events were not recorded.",
+              profile.dropped);
+  }
+  g_mutex_unlock(&(profile.lock));
+  if (fclose(fp) != 0) {
+    g_warning("Failed to write profile output '%s': %s", profile.path,
+              g_strerror(errno));
+  }
 }
 
 void rofi_timings_quit(void) {
   double now = g_timer_elapsed(global_timer, NULL);
   g_debug("%4.6f (%2.6f): Stopped", now, 0.0);
   g_timer_destroy(global_timer);
+  if (rofi_timings_profiling) {
+    rofi_timings_profile_write();
+    rofi_timings_profiling = FALSE;
+    // Jobs still running on the thread pool can record events, they check
+    // for NULL under the lock.
+    g_mutex_lock(&(profile.lock));
+    g_array_free(profile.events, TRUE);
+    g_hash_table_destroy(profile.counters);
+    profile.events = NULL;
+    profile.counters = NULL;
+    g_mutex_unlock(&(profile.lock));
+    g_free(profile.path);
+    profile.path = NULL;
+  }
+  if (rofi_timings_latency) {
+    rofi_timings_latency_report();
+    rofi_timings_latency = FALSE;
+    for (int i = 0; i < ROFI_LATENCY_NUM_STEPS; i++) {
+      g_array_free(latency.samples[i], TRUE);
+      latency.samples[i] = NULL;
+    }
+    g_free(latency.path);
+    latency.path = NULL;
+  }
 }
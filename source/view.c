@@ -277,9 +277,14 @@ static void rofi_view_set_user_timeout(G_GNUC_UNUSED gpointer data) {
   }
 }
 
+static void rofi_view_row_layouts_clear(RofiViewState *state);
+
 void rofi_view_restart(RofiViewState *state) {
   state->quit = FALSE;
   state->retv = MENU_CANCEL;
+  // The mode might have changed the state of entries (e.g. multi-select).
+  rofi_view_row_layouts_clear(state);
+  listview_refresh_rows(state->list_view);
 }
 
 RofiViewState *rofi_view_get_active(void) { return current_active_menu; }
@@ -291,6 +296,21 @@ void rofi_view_remove_active(RofiViewState *state) {
     g_queue_remove(&(CacheState.views), state);
   }
 }
+/**
+ * @param state The view that becomes active.
+ *
+ * All views draw on the same window, so the damage the view collected while
+ * another was shown does not cover what is on screen. Drop it, without damage
+ * the next draw repaints everything.
+ */
+static void rofi_view_damage_all(RofiViewState *state) {
+  widget_queue_redraw(WIDGET(state->main_window));
+  cairo_region_t *damage = widget_take_damage(WIDGET(state->main_window));
+  if (damage != NULL) {
+    cairo_region_destroy(damage);
+  }
+}
+
 void rofi_view_set_active(RofiViewState *state) {
   if (current_active_menu != NULL && state != NULL) {
     g_queue_push_head(&(CacheState.views), current_active_menu);
@@ -298,12 +318,14 @@ void rofi_view_set_active(RofiViewState *state) {
     current_active_menu = state;
     g_debug("stack view.");
     rofi_view_window_update_size(current_active_menu);
+    rofi_view_damage_all(current_active_menu);
     rofi_view_queue_redraw();
     return;
   } else if (state == NULL && !g_queue_is_empty(&(CacheState.views))) {
     g_debug("pop view.");
     current_active_menu = g_queue_pop_head(&(CacheState.views));
     rofi_view_window_update_size(current_active_menu);
+    rofi_view_damage_all(current_active_menu);
     rofi_view_queue_redraw();
     return;
   }
@@ -341,10 +363,17 @@ void rofi_view_free(RofiViewState *state) {
     helper_tokenize_free(state->tokens);
     state->tokens = NULL;
   }
+  g_free(state->tokens_pattern);
+  if (state->highlight_spans != NULL) {
+    g_hash_table_destroy(state->highlight_spans);
+  }
   // Do this here?
   // Wait for final release?
   widget_free(WIDGET(state->main_window));
 
+  if (state->row_layouts != NULL) {
+    g_hash_table_destroy(state->row_layouts);
+  }
   g_free(state->line_map);
   g_free(state->distance);
   // Free the switcher boxes.
@@ -648,14 +677,117 @@ static void selection_changed_callback(G_GNUC_UNUSED listview *lv,
     }
   }
 }
+/**
+ * A shaped row, kept so the entry can be shown again without asking the mode
+ * for it and shaping its text again.
+ */
+typedef struct {
+  /** The layout, with markup and highlighting applied. */
+  PangoLayout *layout;
+  /** The text shown. */
+  char *text;
+  /** The state reported by the mode. */
+  int fstate;
+} RowLayout;
+
+/** Maximum number of rows kept in RofiViewState::row_layouts. */
+#define ROW_LAYOUTS_MAX 512
+
+static void row_layout_free(RowLayout *row) {
+  g_object_unref(row->layout);
+  g_free(row->text);
+  g_free(row);
+}
+
+static void rofi_view_row_layouts_clear(RofiViewState *state) {
+  if (state->row_layouts != NULL) {
+    g_hash_table_remove_all(state->row_layouts);
+  }
+}
+
+static void rofi_view_row_layouts_add(RofiViewState *state, gpointer key,
+                                      textbox *t, int fstate) {
+  if (state->row_layouts == NULL) {
+    state->row_layouts = g_hash_table_new_full(
+        g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)row_layout_free);
+  } else if (g_hash_table_size(state->row_layouts) >= ROW_LAYOUTS_MAX) {
+    g_hash_table_remove_all(state->row_layouts);
+  }
+  RowLayout *row = g_new0(RowLayout, 1);
+  row->layout = g_object_ref(textbox_get_layout(t));
+  row->text = textbox_get_text(t);
+  row->fstate = fstate;
+  g_hash_table_replace(state->row_layouts, key, row);
+}
+
+static void highlight_spans_free(GArray *spans) {
+  if (spans != NULL) {
+    g_array_free(spans, TRUE);
+  }
+}
+
+/**
+ * @param state The handle to the view
+ * @param entry The entry shown.
+ * @param text The visible text of the entry.
+ *
+ * Get the parts of the entry matched by the current tokens. These are found
+ * once for each entry shown, until the tokens change. With fuzzy matching
+ * and fzf sorting, the alignment the entry was scored on is used.
+ *
+ * @returns the matched spans (owned by the view), or NULL.
+ */
+static const GArray *rofi_view_get_highlight_spans(RofiViewState *state,
+                                                   unsigned int entry,
+                                                   const char *text) {
+  gpointer key = GUINT_TO_POINTER(entry);
+  GArray *spans = NULL;
+  if (state->highlight_spans == NULL) {
+    state->highlight_spans =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                              (GDestroyNotify)highlight_spans_free);
+  } else if (g_hash_table_lookup_extended(state->highlight_spans, key, NULL,
+                                          (gpointer *)&spans)) {
+    return spans;
+  }
+  gboolean inverted = FALSE;
+  for (int j = 0; state->tokens[j]; j++) {
+    inverted |= state->tokens[j]->invert;
+  }
+  if (config.matching_method == MM_FUZZY && config.sort &&
+      config.sorting_method_enum == SORT_FZF && !config.normalize_match &&
+      !inverted && state->tokens_pattern != NULL) {
+    spans = rofi_scorer_fuzzy_align(
+        state->tokens_pattern, g_utf8_strlen(state->tokens_pattern, -1), text);
+  }
+  if (spans == NULL) {
+    spans = helper_token_match_get_spans(state->tokens, text);
+  }
+  g_hash_table_insert(state->highlight_spans, key, spans);
+  return spans;
+}
+
 static void update_callback(textbox *t, icon *ico, unsigned int index,
                             void *udata, TextBoxFontType *type, gboolean full) {
   RofiViewState *state = (RofiViewState *)udata;
   if (full) {
     GList *add_list = NULL;
     int fstate = 0;
-    char *text = mode_get_display_value(state->sw, state->line_map[index],
-                                        &fstate, &add_list, TRUE);
+    char *text = NULL;
+    // The entry, and if it is on an alternate or the selected row.
+    gpointer key = GSIZE_TO_POINTER(((gsize)state->line_map[index] << 2) |
+                                    (((*type) & HIGHLIGHT) ? 2 : 0) |
+                                    (((*type) & ALT) ? 1 : 0));
+    RowLayout *row = NULL;
+    if (t != NULL && state->row_layouts != NULL) {
+      row = g_hash_table_lookup(state->row_layouts, key);
+    }
+    if (row != NULL) {
+      fstate = row->fstate;
+    } else {
+      text = mode_get_display_value(state->sw, state->line_map[index], &fstate,
+                                    &add_list, TRUE);
+    }
     (*type) |= fstate;
 
     if (ico) {
@@ -664,9 +796,14 @@ static void update_callback(textbox *t, icon *ico, unsigned int index,
           mode_get_icon(state->sw, state->line_map[index], icon_height);
       icon_set_surface(ico, surf_icon);
     }
-    if (t) {
+    if (t && row != NULL) {
+      textbox_font(t, *type);
+      textbox_set_layout(t, row->layout, row->text);
+    } else if (t) {
       // TODO needed for markup.
       textbox_font(t, *type);
+      // The current layout might be kept for the entry shown before.
+      textbox_detach_layout(t);
       // Move into list view.
       textbox_text(t, text);
       PangoAttrList *list = textbox_get_pango_attributes(t);
@@ -680,8 +817,9 @@ static void update_callback(textbox *t, icon *ico, unsigned int index,
         RofiHighlightColorStyle th = {ROFI_HL_BOLD | ROFI_HL_UNDERLINE,
                                       {0.0, 0.0, 0.0, 0.0}};
         th = rofi_theme_get_highlight(WIDGET(t), "highlight", th);
-        helper_token_match_get_pango_attr(th, state->tokens,
-                                          textbox_get_visible_text(t), list);
+        const GArray *spans = rofi_view_get_highlight_spans(
+            state, state->line_map[index], textbox_get_visible_text(t));
+        helper_token_match_spans_to_pango_attr(th, spans, list);
       }
       for (GList *iter = g_list_first(add_list); iter != NULL;
            iter = g_list_next(iter)) {
@@ -689,6 +827,7 @@ static void update_callback(textbox *t, icon *ico, unsigned int index,
       }
       textbox_set_pango_attributes(t, list);
       pango_attr_list_unref(list);
+      rofi_view_row_layouts_add(state, key, t, fstate);
     }
 
     g_list_free(add_list);
@@ -724,6 +863,11 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
   if (state->sw == NULL) {
     return G_SOURCE_REMOVE;
   }
+  TIMINGS_SPAN_BEGIN("refilter");
+  TIMINGS_LATENCY_MARK(ROFI_LATENCY_INPUT_TO_REFILTER);
+  TIMINGS_LATENCY_BEGIN(ROFI_LATENCY_REFILTER);
+  // Entries, or their highlighting, might change.
+  rofi_view_row_layouts_clear(state);
   GTimer *timer = g_timer_new();
   TICK_N("Filter start");
   if (state->reload) {
@@ -735,6 +879,11 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
     helper_tokenize_free(state->tokens);
     state->tokens = NULL;
   }
+  g_free(state->tokens_pattern);
+  state->tokens_pattern = NULL;
+  if (state->highlight_spans != NULL) {
+    g_hash_table_remove_all(state->highlight_spans);
+  }
   TICK_N("Filter tokenize");
   if (state->text && strlen(state->text->text) > 0) {
 
@@ -804,12 +953,17 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
 
     // Cleanup + bookkeeping.
     state->filtered_lines = j;
-    g_free(pattern);
+    // Kept for highlighting the shown entries.
+    state->tokens_pattern = pattern;
 
     double elapsed = g_timer_elapsed(timer, NULL);
 
     CacheState.max_refilter_time = elapsed;
   } else {
+    if (state->text) {
+      // The mode is told about cleared input too.
+      g_free(mode_preprocess_input(state->sw, ""));
+    }
     listview_set_filtered(state->list_view, FALSE);
     for (unsigned int i = 0; i < state->num_lines; i++) {
       state->line_map[i] = i;
@@ -817,6 +971,7 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
     state->filtered_lines = state->num_lines;
   }
   TICK_N("Filter matching done");
+  TIMINGS_COUNTER("entries filtered", state->num_lines);
   listview_set_num_elements(state->list_view, state->filtered_lines);
 
   if (state->tb_filtered_rows) {
@@ -850,9 +1005,11 @@ static gboolean rofi_view_refilter_real(RofiViewState *state) {
   TICK_N("Filter resize window based on window ");
   state->refilter = FALSE;
   TICK_N("Filter done");
+  TIMINGS_LATENCY_END(ROFI_LATENCY_REFILTER);
   rofi_view_update(state, TRUE);
 
   g_timer_destroy(timer);
+  TIMINGS_SPAN_END("refilter");
   return G_SOURCE_REMOVE;
 }
 void rofi_view_refilter(RofiViewState *state) {
@@ -1933,6 +2090,7 @@ void rofi_view_ellipsize_listview(RofiViewState *state,
 
 void rofi_view_switch_mode(RofiViewState *state, Mode *mode) {
   state->sw = mode;
+  rofi_view_row_layouts_clear(state);
   // Update prompt;
   if (state->prompt) {
     rofi_view_update_prompt(state);
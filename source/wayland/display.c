@@ -54,6 +54,8 @@
 #include "keyb.h"
 #include "rofi-types.h"
 #include "settings.h"
+#include "theme.h"
+#include "timings.h"
 #include "view.h"
 
 #include "display-internal.h"
@@ -74,6 +76,10 @@
        : 0)
 
 typedef struct _display_buffer_pool wayland_buffer_pool;
+
+/** Number of frames of damage kept, to repaint buffers of that age. */
+#define WAYLAND_DAMAGE_HISTORY 4
+
 typedef struct {
   wayland_stuff *context;
   uint32_t global_name;
@@ -96,16 +102,32 @@ typedef struct {
   struct wl_buffer *buffer;
   uint8_t *data;
   gboolean released;
+  /** The frame the contents of the buffer are from, 0 if undefined. */
+  guint64 frame;
 } wayland_buffer;
 
-struct _display_buffer_pool {
-  wayland_stuff *context;
+/**
+ * Shared memory the buffers of a pool are allocated from. When a pool is
+ * freed, it is kept to back the next pool, growing it when needed.
+ */
+typedef struct {
+  int fd;
   uint8_t *data;
   size_t size;
+  struct wl_shm_pool *pool;
+} wayland_shm;
+
+struct _display_buffer_pool {
+  wayland_stuff *context;
+  wayland_shm *shm;
   int32_t width;
   int32_t height;
   gboolean to_free;
   wayland_buffer *buffers;
+  /** The last committed frame. */
+  guint64 frame;
+  /** Damage of the last frames, indexed by frame, NULL if all changed. */
+  cairo_region_t *damage[WAYLAND_DAMAGE_HISTORY];
 };
 
 static gboolean wayland_display_late_setup(void);
@@ -114,6 +136,96 @@ static wayland_stuff wayland_;
 wayland_stuff *wayland = &wayland_;
 static const cairo_user_data_key_t wayland_cairo_surface_user_data;
 
+/** Shared memory of a freed pool, to be reused by the next pool. */
+static wayland_shm *wayland_shm_spare = NULL;
+
+static void wayland_shm_free(wayland_shm *shm) {
+  if (shm == NULL) {
+    return;
+  }
+  wl_shm_pool_destroy(shm->pool);
+  munmap(shm->data, shm->size);
+  close(shm->fd);
+  g_free(shm);
+}
+
+static int wayland_shm_open(void) {
+  int fd;
+#ifdef MFD_CLOEXEC
+  fd = memfd_create("rofi-wayland-surface", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd >= 0) {
+    // The pool only ever grows, so the compositor can rely on its size.
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK);
+    return fd;
+  }
+  g_debug("memfd_create failed: %s, falling back to a file.",
+          g_strerror(errno));
+#endif
+  gchar filename[PATH_MAX];
+  g_snprintf(filename, PATH_MAX, "%s/rofi-wayland-surface",
+             g_get_user_runtime_dir());
+  fd = g_open(filename, O_CREAT | O_RDWR, 0);
+  g_unlink(filename);
+  if (fd < 0) {
+    return -1;
+  }
+  if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+    g_close(fd, NULL);
+    return -1;
+  }
+  return fd;
+}
+
+static wayland_shm *wayland_shm_new(size_t size) {
+  int fd = wayland_shm_open();
+  if (fd < 0) {
+    g_warning("creating a buffer file for %zu B failed: %s", size,
+              g_strerror(errno));
+    return NULL;
+  }
+  if (ftruncate(fd, size) < 0) {
+    g_close(fd, NULL);
+    return NULL;
+  }
+  uint8_t *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    g_warning("mmap of size %zu failed: %s", size, g_strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  wayland_shm *shm = g_new0(wayland_shm, 1);
+  shm->fd = fd;
+  shm->data = data;
+  shm->size = size;
+  shm->pool = wl_shm_create_pool(wayland->shm, fd, size);
+  return shm;
+}
+
+/**
+ * Grow the shared memory to at least size, doubling it to avoid growing on
+ * every resize. No buffers may be allocated from it.
+ */
+static gboolean wayland_shm_grow(wayland_shm *shm, size_t size) {
+  if (shm->size >= size) {
+    return TRUE;
+  }
+  size_t new_size = MAX(size, shm->size * 2);
+  if (ftruncate(shm->fd, new_size) < 0) {
+    return FALSE;
+  }
+  uint8_t *data =
+      mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm->fd, 0);
+  if (data == MAP_FAILED) {
+    g_warning("mmap of size %zu failed: %s", new_size, g_strerror(errno));
+    return FALSE;
+  }
+  munmap(shm->data, shm->size);
+  shm->data = data;
+  shm->size = new_size;
+  wl_shm_pool_resize(shm->pool, new_size);
+  return TRUE;
+}
+
 static void wayland_buffer_cleanup(wayland_buffer_pool *self) {
   if (!self->to_free) {
     return;
@@ -134,7 +246,21 @@ static void wayland_buffer_cleanup(wayland_buffer_pool *self) {
     return;
   }
 
-  munmap(self->data, self->size);
+  for (i = 0; i < WAYLAND_DAMAGE_HISTORY; ++i) {
+    if (self->damage[i] != NULL) {
+      cairo_region_destroy(self->damage[i]);
+    }
+  }
+  // Keep the largest shared memory around for the next pool.
+  if (wayland_shm_spare == NULL) {
+    wayland_shm_spare = self->shm;
+  } else if (wayland_shm_spare->size < self->shm->size) {
+    wayland_shm_free(wayland_shm_spare);
+    wayland_shm_spare = self->shm;
+  } else {
+    wayland_shm_free(self->shm);
+  }
+  g_free(self->buffers);
   g_free(self);
 }
 
@@ -156,10 +282,6 @@ static const struct wl_buffer_listener wayland_buffer_listener = {
 };
 
 wayland_buffer_pool *display_buffer_pool_new(gint width, gint height) {
-  struct wl_shm_pool *wl_pool;
-  struct wl_buffer *buffer;
-  int fd;
-  uint8_t *data;
   width *= wayland->scale;
   height *= wayland->scale;
   int32_t stride;
@@ -174,53 +296,39 @@ wayland_buffer_pool *display_buffer_pool_new(gint width, gint height) {
   size = (size_t)stride * height;
   pool_size = size * wayland->buffer_count;
 
-  gchar filename[PATH_MAX];
-  g_snprintf(filename, PATH_MAX, "%s/rofi-wayland-surface",
-             g_get_user_runtime_dir());
-  fd = g_open(filename, O_CREAT | O_RDWR, 0);
-  g_unlink(filename);
-  if (fd < 0) {
-    g_warning("creating a buffer file for %zu B failed: %s", pool_size,
-              g_strerror(errno));
-    return NULL;
-  }
-  if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
-    g_close(fd, NULL);
-    return NULL;
-  }
-  if (ftruncate(fd, pool_size) < 0) {
-    g_close(fd, NULL);
-    return NULL;
-  }
-
-  data = mmap(NULL, pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  if (data == MAP_FAILED) {
-    g_warning("mmap of size %zu failed: %s", pool_size, g_strerror(errno));
-    close(fd);
-    return NULL;
+  // Reuse the shared memory of a previous pool.
+  wayland_shm *shm = wayland_shm_spare;
+  wayland_shm_spare = NULL;
+  if (shm != NULL && !wayland_shm_grow(shm, pool_size)) {
+    wayland_shm_free(shm);
+    shm = NULL;
+  }
+  if (shm == NULL) {
+    shm = wayland_shm_new(pool_size);
+    if (shm == NULL) {
+      return NULL;
+    }
   }
 
   wayland_buffer_pool *pool;
   pool = g_new0(wayland_buffer_pool, 1);
 
+  pool->shm = shm;
   pool->width = width;
   pool->height = height;
 
   pool->buffers = g_new0(wayland_buffer, wayland->buffer_count);
 
-  wl_pool = wl_shm_create_pool(wayland->shm, fd, pool_size);
   size_t i;
   for (i = 0; i < wayland->buffer_count; ++i) {
     pool->buffers[i].pool = pool;
     pool->buffers[i].buffer = wl_shm_pool_create_buffer(
-        wl_pool, size * i, width, height, stride, WL_SHM_FORMAT_ARGB8888);
-    pool->buffers[i].data = data + size * i;
+        shm->pool, size * i, width, height, stride, WL_SHM_FORMAT_ARGB8888);
+    pool->buffers[i].data = shm->data + size * i;
     pool->buffers[i].released = TRUE;
     wl_buffer_add_listener(pool->buffers[i].buffer, &wayland_buffer_listener,
                            pool);
   }
-  wl_shm_pool_destroy(wl_pool);
-  close(fd);
 
   return pool;
 }
@@ -247,12 +355,15 @@ static void wayland_surface_protocol_enter(void *data,
     // DPI auto-detect requested.
     config.dpi = wayland_output_get_dpi(output, output->current.scale, height);
     g_debug("Auto-detected DPI: %d", config.dpi);
+    distance_bump_generation();
   }
 
   wl_surface_set_buffer_scale(wl_surface, output->current.scale);
 
   if (wayland->scale != output->current.scale) {
     wayland->scale = output->current.scale;
+    // Distances are scaled with it.
+    distance_bump_generation();
 
     // create new buffers with the correct scaled size
     rofi_view_pool_refresh();
@@ -304,7 +415,31 @@ display_buffer_pool_get_next_buffer(wayland_buffer_pool *pool) {
   return surface;
 }
 
-void display_surface_commit(cairo_surface_t *surface) {
+cairo_region_t *
+display_buffer_pool_get_repaint_region(cairo_surface_t *surface,
+                                       const cairo_region_t *damage) {
+  wayland_buffer *buffer =
+      cairo_surface_get_user_data(surface, &wayland_cairo_surface_user_data);
+  wayland_buffer_pool *pool = buffer->pool;
+  if (damage == NULL || buffer->frame == 0 ||
+      (pool->frame - buffer->frame) >= WAYLAND_DAMAGE_HISTORY) {
+    return NULL;
+  }
+  // Everything that changed since the frame the buffer holds.
+  cairo_region_t *region = cairo_region_copy(damage);
+  for (guint64 frame = buffer->frame + 1; frame <= pool->frame; frame++) {
+    cairo_region_t *d = pool->damage[frame % WAYLAND_DAMAGE_HISTORY];
+    if (d == NULL) {
+      cairo_region_destroy(region);
+      return NULL;
+    }
+    cairo_region_union(region, d);
+  }
+  return region;
+}
+
+void display_surface_commit(cairo_surface_t *surface,
+                            const cairo_region_t *damage) {
   if (surface == NULL || wayland->surface == NULL) {
     return;
   }
@@ -315,12 +450,39 @@ void display_surface_commit(cairo_surface_t *surface) {
 
   cairo_surface_destroy(surface);
 
-  wl_surface_damage(wayland->surface, 0, 0, pool->width, pool->height);
+  // The first frame of a pool, sized differently, is new as a whole.
+  if (pool->frame == 0) {
+    damage = NULL;
+  }
+  if (damage != NULL && wl_surface_get_version(wayland->surface) >=
+                            WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION) {
+    // Only damage what changed, in buffer coordinates.
+    int n = cairo_region_num_rectangles(damage);
+    for (int i = 0; i < n; i++) {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle(damage, i, &rect);
+      wl_surface_damage_buffer(wayland->surface, rect.x * wayland->scale,
+                               rect.y * wayland->scale,
+                               rect.width * wayland->scale,
+                               rect.height * wayland->scale);
+    }
+  } else {
+    wl_surface_damage(wayland->surface, 0, 0, pool->width, pool->height);
+  }
   wl_surface_attach(wayland->surface, buffer->buffer, 0, 0);
   // FIXME: hidpi
   wl_surface_set_buffer_scale(wayland->surface, wayland->scale);
   buffer->released = FALSE;
 
+  // Remember what changed in this frame, for the buffers holding older ones.
+  pool->frame++;
+  guint index = pool->frame % WAYLAND_DAMAGE_HISTORY;
+  if (pool->damage[index] != NULL) {
+    cairo_region_destroy(pool->damage[index]);
+  }
+  pool->damage[index] = damage ? cairo_region_copy(damage) : NULL;
+  buffer->frame = pool->frame;
+
   wl_surface_commit(wayland->surface);
 }
 
@@ -329,6 +491,7 @@ static void wayland_frame_callback(void *data, struct wl_callback *callback,
   if (wayland->frame_cb != NULL) {
     wl_callback_destroy(wayland->frame_cb);
     wayland->frame_cb = NULL;
+    TIMINGS_LATENCY_END(ROFI_LATENCY_FRAME_CALLBACK);
     rofi_view_frame_callback();
   }
   if (wayland->surface != NULL) {
@@ -402,6 +565,7 @@ static gboolean wayland_key_repeat(void *data) {
     return G_SOURCE_REMOVE;
   }
 
+  TIMINGS_LATENCY_INPUT();
   char *text = nk_bindings_seat_handle_key(wayland->bindings_seat, NULL,
                                            self->repeat.key,
                                            NK_BINDINGS_KEY_STATE_PRESS);
@@ -471,6 +635,7 @@ static void wayland_keyboard_key(void *data, struct wl_keyboard *keyboard,
     nk_bindings_seat_handle_key(wayland->bindings_seat, NULL, keycode,
                                 NK_BINDINGS_KEY_STATE_RELEASE);
   } else if (kstate == WL_KEYBOARD_KEY_STATE_PRESSED) {
+    TIMINGS_LATENCY_INPUT();
     char *text = nk_bindings_seat_handle_key(
         wayland->bindings_seat, NULL, keycode, NK_BINDINGS_KEY_STATE_PRESS);
 
@@ -1696,6 +1861,14 @@ void display_set_surface_dimensions(int width, int height, int x_margin,
                                    -y_margin, x_margin);
 }
 
+static gboolean wayland_display_resume(void) {
+  // The layer surface is destroyed when the window is hidden.
+  if (wayland->surface != NULL) {
+    return TRUE;
+  }
+  return wayland_display_late_setup();
+}
+
 static void wayland_display_early_cleanup(void) {
   if (wayland->main_loop_source == NULL) {
     return;
@@ -1710,6 +1883,8 @@ static void wayland_display_cleanup(void) {
     return;
   }
 
+  wayland_shm_free(wayland_shm_spare);
+  wayland_shm_spare = NULL;
   nk_bindings_seat_free(wayland->bindings_seat);
   g_hash_table_unref(wayland->seats_by_name);
   g_hash_table_unref(wayland->seats);
@@ -1811,6 +1986,7 @@ static void wayland_set_fullscreen_mode(void) {
 static display_proxy display_ = {
     .setup = wayland_display_setup,
     .late_setup = wayland_display_late_setup,
+    .resume = wayland_display_resume,
     .early_cleanup = wayland_display_early_cleanup,
     .cleanup = wayland_display_cleanup,
     .dump_monitor_layout = wayland_display_dump_monitor_layout,
@@ -98,6 +98,7 @@ static void wayland_rofi_view_get_current_monitor(int *width, int *height) {
   if (WlState.monitor_width == 0 && WlState.monitor_height == 0) {
     display_get_surface_dimensions(&WlState.monitor_width,
                                    &WlState.monitor_height);
+    distance_bump_generation();
   }
 
   if (width) {
@@ -272,6 +273,7 @@ static void wayland___create_window(MenuFlags menu_flags) {
     config.dpi =
         pango_cairo_font_map_get_resolution((PangoCairoFontMap *)font_map);
   }
+  distance_bump_generation();
   // Setup font.
   // Dummy widget.
   box *win = box_create(NULL, "window", ROFI_ORIENTATION_HORIZONTAL);
@@ -340,12 +342,28 @@ static void wayland_rofi_view_update(RofiViewState *state, gboolean qr) {
     // no available buffer, bail out
     return;
   }
+  TIMINGS_SPAN_BEGIN("draw");
+  TIMINGS_LATENCY_BEGIN(ROFI_LATENCY_DRAW);
+  cairo_region_t *damage = widget_take_damage(WIDGET(state->main_window));
+  // The buffer still holds an older frame, only repaint what changed since.
+  cairo_region_t *repaint =
+      display_buffer_pool_get_repaint_region(surface, damage);
+  guint scale = display_scale();
+  cairo_surface_set_device_scale(surface, scale, scale);
   cairo_t *d = cairo_create(surface);
+  if (repaint != NULL) {
+    int n = cairo_region_num_rectangles(repaint);
+    for (int i = 0; i < n; i++) {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle(repaint, i, &rect);
+      cairo_rectangle(d, rect.x, rect.y, rect.width, rect.height);
+    }
+    cairo_clip(d);
+    cairo_region_destroy(repaint);
+  }
   cairo_set_operator(d, CAIRO_OPERATOR_SOURCE);
   // Paint the background transparent.
   cairo_set_source_rgba(d, 0, 0, 0, 0.0);
-  guint scale = display_scale();
-  cairo_surface_set_device_scale(surface, scale, scale);
   cairo_paint(d);
   TICK_N("Background");
 
@@ -355,7 +373,17 @@ static void wayland_rofi_view_update(RofiViewState *state, gboolean qr) {
 
   TICK_N("widgets");
   cairo_destroy(d);
-  display_surface_commit(surface);
+  TIMINGS_LATENCY_END(ROFI_LATENCY_DRAW);
+  TIMINGS_LATENCY_BEGIN(ROFI_LATENCY_COMMIT);
+  display_surface_commit(surface, damage);
+  TIMINGS_LATENCY_END(ROFI_LATENCY_COMMIT);
+  // Arrival of the frame callback, the compositor used the frame.
+  TIMINGS_LATENCY_BEGIN(ROFI_LATENCY_FRAME_CALLBACK);
+  TIMINGS_LATENCY_MARK(ROFI_LATENCY_INPUT_TO_PAINT);
+  if (damage != NULL) {
+    cairo_region_destroy(damage);
+  }
+  TIMINGS_SPAN_END("draw");
 
   if (qr) {
     wayland_rofi_view_queue_redraw();
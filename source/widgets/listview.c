@@ -27,6 +27,7 @@
 
 #include "config.h"
 #include <glib.h>
+#include <limits.h>
 #include <widgets/box.h>
 #include <widgets/icon.h>
 #include <widgets/listview.h>
@@ -62,6 +63,10 @@ typedef struct {
   textbox *textbox;
   textbox *index;
   icon *icon;
+  // The element shown, UINT_MAX when the content has to be pulled again.
+  unsigned int shown;
+  // The drawing mode the row was last updated with.
+  TextBoxFontType shown_type;
 } _listview_row;
 
 struct _listview {
@@ -106,7 +111,10 @@ struct _listview {
 
   ScrollType scroll_type;
 
+  // Pool of row widgets, recycled by position; only the first cur_elements
+  // are in use.
   _listview_row *boxes;
+  unsigned int num_boxes;
   scrollbar *scrollbar;
 
   listview_update_callback callback;
@@ -237,6 +245,7 @@ static void listview_create_row(listview *lv, _listview_row *row) {
   row->textbox = NULL;
   row->icon = NULL;
   row->index = NULL;
+  row->shown = UINT_MAX;
 
   for (GList *iter = g_list_first(list); iter != NULL;
        iter = g_list_next(iter)) {
@@ -249,7 +258,7 @@ static int listview_get_desired_height(widget *wid, const int width);
 
 static void listview_free(widget *wid) {
   listview *lv = (listview *)wid;
-  for (unsigned int i = 0; i < lv->cur_elements; i++) {
+  for (unsigned int i = 0; i < lv->num_boxes; i++) {
     widget_free(WIDGET(lv->boxes[i].box));
   }
   g_free(lv->boxes);
@@ -300,20 +309,25 @@ static unsigned int scroll_per_page(listview *lv) {
 }
 
 // For vertical packing flow
-static unsigned int scroll_continious_elements(listview *lv) {
+static unsigned int continious_elements_offset(listview *lv,
+                                               unsigned int selected) {
   unsigned int vmid = (lv->max_rows - 1) / 2;
   unsigned int hmid = (lv->menu_columns - 1) / 2;
   unsigned int middle = (lv->max_rows * hmid) + vmid;
   unsigned int offset = 0;
-  if (lv->selected > middle) {
-    if (lv->selected < (lv->req_elements - (lv->max_elements - middle))) {
-      offset = lv->selected - middle;
+  if (selected > middle) {
+    if (selected < (lv->req_elements - (lv->max_elements - middle))) {
+      offset = selected - middle;
     }
     // Don't go below zero.
     else if (lv->req_elements > lv->max_elements) {
       offset = lv->req_elements - lv->max_elements;
     }
   }
+  return offset;
+}
+static unsigned int scroll_continious_elements(listview *lv) {
+  unsigned int offset = continious_elements_offset(lv, lv->selected);
   if (offset != lv->cur_page) {
     // scrollbar_set_handle ( lv->scrollbar, offset );
     lv->cur_page = offset;
@@ -323,10 +337,11 @@ static unsigned int scroll_continious_elements(listview *lv) {
 }
 
 // For horizontal packing flow
-static unsigned int scroll_continious_rows(listview *lv) {
+static unsigned int continious_rows_offset(listview *lv,
+                                           unsigned int selected_element) {
   unsigned int middle, selected, req_rows, offset;
   middle = (lv->max_rows - 1) / 2;
-  selected = lv->selected / lv->menu_columns;
+  selected = selected_element / lv->menu_columns;
   req_rows = (lv->req_elements + lv->menu_columns - 1) / lv->menu_columns;
   offset = 0;
   if (selected > middle) {
@@ -339,6 +354,10 @@ static unsigned int scroll_continious_rows(listview *lv) {
     }
   }
   offset *= lv->menu_columns;
+  return offset;
+}
+static unsigned int scroll_continious_rows(listview *lv) {
+  unsigned int offset = continious_rows_offset(lv, lv->selected);
   if (offset != lv->cur_page) {
     // scrollbar_set_handle ( lv->scrollbar, offset );
     lv->cur_page = offset;
@@ -353,6 +372,14 @@ static void update_element(listview *lv, unsigned int tb, unsigned int index,
   TextBoxFontType type = (index & 1) == 0 ? NORMAL : ALT;
   type = (index) == lv->selected ? HIGHLIGHT : type;
 
+  // Row still shows this element in this mode, nothing to pull.
+  if (lv->boxes[tb].shown == index && lv->boxes[tb].shown_type == type) {
+    return;
+  }
+  lv->boxes[tb].shown = index;
+  lv->boxes[tb].shown_type = type;
+  TIMINGS_COUNTER("listview rows updated", 1);
+
   if (lv->boxes[tb].index) {
     if (index < 10) {
       char str[2] = {((index + 1) % 10) + '0', '\0'};
@@ -597,12 +624,11 @@ static void listview_recompute_elements(listview *lv) {
     newne = MIN(lv->req_elements, lv->max_elements);
     lv->cur_columns = lv->menu_columns;
   }
-  for (unsigned int i = newne; i < lv->cur_elements; i++) {
-    widget_free(WIDGET(lv->boxes[i].box));
-  }
-  lv->boxes = g_realloc(lv->boxes, newne * sizeof(_listview_row));
-  if (newne > 0) {
-    for (unsigned int i = lv->cur_elements; i < newne; i++) {
+  // Rows are kept when fewer are needed, and only created when the pool
+  // has to grow.
+  if (newne > lv->num_boxes) {
+    lv->boxes = g_realloc(lv->boxes, newne * sizeof(_listview_row));
+    for (unsigned int i = lv->num_boxes; i < newne; i++) {
       listview_create_row(lv, &(lv->boxes[i]));
       widget *wid = WIDGET(lv->boxes[i].box);
       widget_set_trigger_action_handler(wid, listview_element_trigger_action,
@@ -613,11 +639,22 @@ static void listview_recompute_elements(listview *lv) {
 
       listview_set_state(lv->boxes[i], NORMAL);
     }
+    lv->num_boxes = newne;
   }
   lv->rchanged = TRUE;
   lv->cur_elements = newne;
 }
 
+void listview_refresh_rows(listview *lv) {
+  if (lv == NULL) {
+    return;
+  }
+  for (unsigned int i = 0; i < lv->num_boxes; i++) {
+    lv->boxes[i].shown = UINT_MAX;
+  }
+  widget_queue_redraw(WIDGET(lv));
+}
+
 void listview_set_num_elements(listview *lv, unsigned int rows) {
   if (lv == NULL) {
     return;
@@ -627,6 +664,8 @@ void listview_set_num_elements(listview *lv, unsigned int rows) {
   if (lv->require_input && !lv->filtered) {
     lv->req_elements = 0;
   }
+  // The elements behind the indexes changed.
+  listview_refresh_rows(lv);
   listview_set_selected(lv, lv->selected);
   TICK_N("Set selected");
   listview_recompute_elements(lv);
@@ -642,14 +681,65 @@ unsigned int listview_get_selected(listview *lv) {
   return 0;
 }
 
+/**
+ * @param lv The listview.
+ * @param selected The element to select.
+ *
+ * The offset of the first element shown when selected is selected, like
+ * listview_draw() computes it.
+ *
+ * @returns the offset.
+ */
+static unsigned int listview_scroll_offset(listview *lv,
+                                           unsigned int selected) {
+  if (lv->scroll_type == LISTVIEW_SCROLL_PER_PAGE) {
+    if (selected >= lv->last_offset &&
+        (selected - lv->last_offset) < lv->max_elements) {
+      return lv->last_offset;
+    }
+    return (lv->max_elements > 0)
+               ? (selected / lv->max_elements) * lv->max_elements
+               : 0;
+  }
+  if (lv->pack_direction == ROFI_ORIENTATION_VERTICAL) {
+    return continious_elements_offset(lv, selected);
+  }
+  return continious_rows_offset(lv, selected);
+}
+
+/**
+ * @param lv The listview.
+ * @param previous The element selected before.
+ *
+ * Queue the redraw for a new selection. When the listview does not scroll,
+ * only the rows of the old and new selection (and the scrollbar) are damaged.
+ */
+static void listview_queue_selection_redraw(listview *lv,
+                                            unsigned int previous) {
+  unsigned int offset = lv->last_offset;
+  if (lv->type != LISTVIEW || lv->rchanged ||
+      listview_scroll_offset(lv, lv->selected) != offset ||
+      previous < offset || (previous - offset) >= lv->cur_elements ||
+      lv->selected < offset || (lv->selected - offset) >= lv->cur_elements) {
+    widget_queue_redraw(WIDGET(lv));
+    return;
+  }
+  widget_queue_redraw(WIDGET(lv->boxes[previous - offset].box));
+  widget_queue_redraw(WIDGET(lv->boxes[lv->selected - offset].box));
+  if (widget_enabled(WIDGET(lv->scrollbar))) {
+    widget_queue_redraw(WIDGET(lv->scrollbar));
+  }
+}
+
 void listview_set_selected(listview *lv, unsigned int selected) {
   if (lv == NULL) {
     return;
   }
   if (lv->req_elements > 0) {
+    unsigned int previous = lv->selected;
     lv->selected = MIN(selected, lv->req_elements - 1);
     lv->barview.direction = LEFT_TO_RIGHT;
-    widget_queue_redraw(WIDGET(lv));
+    listview_queue_selection_redraw(lv, previous);
     if (lv->sc_callback) {
       lv->sc_callback(lv, lv->selected, lv->sc_udata);
     }
@@ -1171,7 +1261,7 @@ void listview_set_fixed_num_lines(listview *lv) {
 void listview_set_ellipsize(listview *lv, PangoEllipsizeMode mode) {
   if (lv) {
     lv->emode = mode;
-    for (unsigned int i = 0; i < lv->cur_elements; i++) {
+    for (unsigned int i = 0; i < lv->num_boxes; i++) {
       textbox_set_ellipsize(lv->boxes[i].textbox, lv->emode);
     }
   }
@@ -1188,7 +1278,7 @@ void listview_toggle_ellipsizing(listview *lv) {
       mode = PANGO_ELLIPSIZE_START;
     }
     lv->emode = mode;
-    for (unsigned int i = 0; i < lv->cur_elements; i++) {
+    for (unsigned int i = 0; i < lv->num_boxes; i++) {
       textbox_set_ellipsize(lv->boxes[i].textbox, mode);
     }
   }
@@ -58,6 +58,35 @@ static TBFontConfig *tbfc_default = NULL;
 /** HashMap of previously parsed font descriptions. */
 static GHashTable *tbfc_cache = NULL;
 
+/**
+ * A run of glyphs shaped in a single font.
+ */
+typedef struct {
+  /** The font the run was shaped in. */
+  cairo_scaled_font_t *font;
+  /** Index of the first glyph of the run. */
+  guint offset;
+  /** Number of glyphs in the run. */
+  guint length;
+} TextboxGlyphRun;
+
+/**
+ * The glyph runs of a layout, with positions relative to the layout origin,
+ * so drawing an unchanged label does not walk the pango layout again.
+ */
+struct _TextboxGlyphCache {
+  /** The layout the runs were taken from. */
+  PangoLayout *layout;
+  /** The serial of the layout when the runs were taken. */
+  guint serial;
+  /** FALSE if the layout needs the pango renderer (colours, decorations). */
+  gboolean usable;
+  /** The runs (TextboxGlyphRun). */
+  GArray *runs;
+  /** The glyphs of all runs (cairo_glyph_t). */
+  GArray *glyphs;
+};
+
 static gboolean textbox_blink(gpointer data) {
   textbox *tb = (textbox *)data;
   if (tb->blink < 2) {
@@ -123,6 +152,128 @@ textbox_editable_trigger_action(widget *wid,
   return WIDGET_TRIGGER_ACTION_RESULT_IGNORED;
 }
 
+static void textbox_glyph_cache_free(textbox *tb) {
+  struct _TextboxGlyphCache *cache = tb->glyph_cache;
+  if (cache == NULL) {
+    return;
+  }
+  for (guint i = 0; i < cache->runs->len; i++) {
+    cairo_scaled_font_destroy(
+        g_array_index(cache->runs, TextboxGlyphRun, i).font);
+  }
+  g_array_free(cache->runs, TRUE);
+  g_array_free(cache->glyphs, TRUE);
+  g_free(cache);
+  tb->glyph_cache = NULL;
+}
+
+/**
+ * @param tb The textbox object.
+ *
+ * Get the glyph runs of the current layout, taking them again when the layout
+ * changed since. The layout serial changes with its text, attributes, size
+ * and font, and with the pango context (resolution and font options).
+ *
+ * @returns the glyph runs, or NULL when the layout has to be drawn by pango.
+ */
+static struct _TextboxGlyphCache *textbox_glyph_cache_get(textbox *tb) {
+  struct _TextboxGlyphCache *cache = tb->glyph_cache;
+  guint serial = pango_layout_get_serial(tb->layout);
+  if (cache != NULL && cache->layout == tb->layout &&
+      cache->serial == serial) {
+    return cache->usable ? cache : NULL;
+  }
+  textbox_glyph_cache_free(tb);
+  cache = tb->glyph_cache = g_malloc0(sizeof(struct _TextboxGlyphCache));
+  cache->layout = tb->layout;
+  cache->serial = serial;
+  cache->runs = g_array_new(FALSE, FALSE, sizeof(TextboxGlyphRun));
+  cache->glyphs = g_array_new(FALSE, FALSE, sizeof(cairo_glyph_t));
+  cache->usable = TRUE;
+  TIMINGS_COUNTER("textbox glyph runs taken", 1);
+
+  PangoLayoutIter *iter = pango_layout_get_iter(tb->layout);
+  do {
+    PangoLayoutRun *run = pango_layout_iter_get_run_readonly(iter);
+    if (run == NULL) {
+      continue;
+    }
+    // Colours, underlines, shapes and the like are drawn by the renderer.
+    if (run->item->analysis.extra_attrs != NULL) {
+      cache->usable = FALSE;
+      break;
+    }
+    cairo_scaled_font_t *font = pango_cairo_font_get_scaled_font(
+        (PangoCairoFont *)run->item->analysis.font);
+    if (font == NULL) {
+      cache->usable = FALSE;
+      break;
+    }
+    PangoRectangle logical;
+    pango_layout_iter_get_run_extents(iter, NULL, &logical);
+    int baseline = pango_layout_iter_get_baseline(iter);
+
+    TextboxGlyphRun gr = {cairo_scaled_font_reference(font),
+                          cache->glyphs->len, 0};
+    g_array_append_val(cache->runs, gr);
+    TextboxGlyphRun *r =
+        &g_array_index(cache->runs, TextboxGlyphRun, cache->runs->len - 1);
+
+    int x_position = 0;
+    for (int i = 0; i < run->glyphs->num_glyphs; i++) {
+      PangoGlyphInfo *gi = &(run->glyphs->glyphs[i]);
+      if (gi->glyph & PANGO_GLYPH_UNKNOWN_FLAG) {
+        // Missing glyphs are drawn as hex boxes by the renderer.
+        cache->usable = FALSE;
+        break;
+      }
+      if (gi->glyph != PANGO_GLYPH_EMPTY) {
+        cairo_glyph_t glyph;
+        glyph.index = gi->glyph;
+        glyph.x = (double)(logical.x + x_position + gi->geometry.x_offset) /
+                  PANGO_SCALE;
+        glyph.y = (double)(baseline + gi->geometry.y_offset) / PANGO_SCALE;
+        g_array_append_val(cache->glyphs, glyph);
+        r->length++;
+      }
+      x_position += gi->geometry.width;
+    }
+  } while (cache->usable && pango_layout_iter_next_run(iter));
+  pango_layout_iter_free(iter);
+
+  return cache->usable ? cache : NULL;
+}
+
+/**
+ * @param cache The glyph runs.
+ * @param draw The cairo context.
+ * @param x The x position of the layout.
+ * @param y The y position of the layout.
+ * @param path Add the glyph outlines to the path instead of showing them.
+ */
+static void textbox_glyph_cache_draw(struct _TextboxGlyphCache *cache,
+                                     cairo_t *draw, int x, int y,
+                                     gboolean path) {
+  cairo_save(draw);
+  cairo_translate(draw, x, y);
+  for (guint i = 0; i < cache->runs->len; i++) {
+    TextboxGlyphRun *r = &g_array_index(cache->runs, TextboxGlyphRun, i);
+    if (r->length == 0) {
+      continue;
+    }
+    cairo_glyph_t *glyphs =
+        &g_array_index(cache->glyphs, cairo_glyph_t, r->offset);
+    cairo_set_scaled_font(draw, r->font);
+    if (path) {
+      cairo_glyph_path(draw, glyphs, r->length);
+    } else {
+      cairo_show_glyphs(draw, glyphs, r->length);
+    }
+  }
+  // The path is not part of the saved state, so the outlines survive this.
+  cairo_restore(draw);
+}
+
 static void textbox_initialize_font(textbox *tb) {
   tb->tbfc = tbfc_default;
   const char *font = rofi_theme_get_string(WIDGET(tb), "font", NULL);
@@ -316,6 +467,7 @@ void textbox_font(textbox *tb, TextBoxFontType tbft) {
     break;
   }
   if (tb->tbft != tbft || tb->widget.state == NULL) {
+    textbox_glyph_cache_free(tb);
     widget_queue_redraw(WIDGET(tb));
   }
   tb->tbft = tbft;
@@ -375,6 +527,49 @@ void textbox_set_pango_attributes(textbox *tb, PangoAttrList *list) {
   pango_layout_set_attributes(tb->layout, list);
 }
 
+PangoLayout *textbox_get_layout(textbox *tb) {
+  if (tb == NULL) {
+    return NULL;
+  }
+  return tb->layout;
+}
+void textbox_detach_layout(textbox *tb) {
+  if (tb == NULL) {
+    return;
+  }
+  PangoLayout *layout = pango_layout_copy(tb->layout);
+  textbox_glyph_cache_free(tb);
+  g_object_unref(tb->layout);
+  tb->layout = layout;
+}
+void textbox_set_layout(textbox *tb, PangoLayout *layout, const char *text) {
+  if (tb == NULL || layout == NULL) {
+    return;
+  }
+  if (tb->layout != layout) {
+    // Keep the size the textbox currently has.
+    pango_layout_set_width(layout, pango_layout_get_width(tb->layout));
+    pango_layout_set_height(layout, pango_layout_get_height(tb->layout));
+    pango_layout_set_ellipsize(layout, pango_layout_get_ellipsize(tb->layout));
+    g_object_ref(layout);
+    textbox_glyph_cache_free(tb);
+    g_object_unref(tb->layout);
+    tb->layout = layout;
+  }
+  g_free(tb->text);
+  tb->text = g_strdup(text);
+  tb->show_placeholder = FALSE;
+  tb->cursor = MAX(0, MIN((int)g_utf8_strlen(tb->text, -1), tb->cursor));
+  if (tb->flags & TB_AUTOWIDTH) {
+    textbox_moveresize(tb, tb->widget.x, tb->widget.y, tb->widget.w,
+                       tb->widget.h);
+    if (WIDGET(tb)->parent) {
+      widget_update(WIDGET(tb)->parent);
+    }
+  }
+  widget_queue_redraw(WIDGET(tb));
+}
+
 char *textbox_get_text(const textbox *tb) {
   if (tb->text == NULL) {
     return g_strdup("");
@@ -409,6 +604,7 @@ void textbox_text(textbox *tb, const char *text) {
       }
     }
   }
+  textbox_glyph_cache_free(tb);
   __textbox_update_pango_text(tb);
   if (tb->flags & TB_AUTOWIDTH) {
     textbox_moveresize(tb, tb->widget.x, tb->widget.y, tb->widget.w,
@@ -476,6 +672,7 @@ static void textbox_free(widget *wid) {
   g_free(tb->text);
 
   g_free(tb->placeholder);
+  textbox_glyph_cache_free(tb);
   if (tb->layout != NULL) {
     g_object_unref(tb->layout);
   }
@@ -594,14 +791,24 @@ static void textbox_draw(widget *wid, cairo_t *draw) {
   } else {
     show_outline = rofi_theme_get_boolean(WIDGET(tb), "text-outline", FALSE);
   }
-  cairo_move_to(draw, x, top);
-  pango_cairo_show_layout(draw, tb->layout);
+  struct _TextboxGlyphCache *cache = textbox_glyph_cache_get(tb);
+  if (cache != NULL) {
+    textbox_glyph_cache_draw(cache, draw, x, top, FALSE);
+  } else {
+    cairo_move_to(draw, x, top);
+    pango_cairo_show_layout(draw, tb->layout);
+  }
 
   if (show_outline) {
     rofi_theme_get_color(WIDGET(tb), "text-outline-color", draw);
     double width = rofi_theme_get_double(WIDGET(tb), "text-outline-width", 0.5);
-    cairo_move_to(draw, x, top);
-    pango_cairo_layout_path(draw, tb->layout);
+    if (cache != NULL) {
+      cairo_new_path(draw);
+      textbox_glyph_cache_draw(cache, draw, x, top, TRUE);
+    } else {
+      cairo_move_to(draw, x, top);
+      pango_cairo_layout_path(draw, tb->layout);
+    }
     cairo_set_line_width(draw, width);
     cairo_stroke(draw);
   }
@@ -967,6 +1174,8 @@ void textbox_set_pango_context(const char *font, PangoContext *p) {
   }
   g_object_unref(layout);
   tbfc_default = tbfc;
+  // em and ch depend on the default font.
+  distance_bump_generation();
 
   g_hash_table_insert(tbfc_cache, (gpointer *)(font ? font : default_font_name),
                       tbfc);
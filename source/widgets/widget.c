@@ -51,20 +51,57 @@ void widget_init(widget *wid, widget *parent, WidgetType type,
   wid->cursor_type =
       rofi_theme_get_cursor_type(wid, "cursor", ROFI_CURSOR_DEFAULT);
 
+  wid->pixels_generation = 0;
+
   // enabled by default
   wid->enabled = rofi_theme_get_boolean(wid, "enabled", TRUE);
 }
 
+/**
+ * @param wid The widget.
+ *
+ * Get the margin, border, border-radius and padding in pixels. These are
+ * converted once and kept until the distances or the values they are
+ * converted with (font, monitor, dpi) change.
+ *
+ * @returns the distances in pixels.
+ */
+static const WidgetPixels *widget_get_pixels(const widget *wid) {
+  const unsigned int generation = distance_get_generation();
+  if (wid->pixels_generation != generation) {
+    // Only a cache, the widget itself is not modified.
+    widget *w = (widget *)wid;
+    const RofiPadding *pads[] = {&(wid->margin), &(wid->border),
+                                 &(wid->border_radius), &(wid->padding)};
+    int *out[] = {w->pixels.margin, w->pixels.border, w->pixels.radius,
+                  w->pixels.padding};
+    for (unsigned int i = 0; i < G_N_ELEMENTS(pads); i++) {
+      out[i][0] =
+          distance_get_pixel(pads[i]->left, ROFI_ORIENTATION_HORIZONTAL);
+      out[i][1] = distance_get_pixel(pads[i]->top, ROFI_ORIENTATION_VERTICAL);
+      out[i][2] =
+          distance_get_pixel(pads[i]->right, ROFI_ORIENTATION_HORIZONTAL);
+      out[i][3] =
+          distance_get_pixel(pads[i]->bottom, ROFI_ORIENTATION_VERTICAL);
+    }
+    w->pixels_generation = generation;
+  }
+  return &(wid->pixels);
+}
+
 void widget_set_state(widget *wid, const char *state) {
   if (wid == NULL) {
     return;
   }
   if (g_strcmp0(wid->state, state)) {
     wid->state = state;
+    // Style is looked up again for the new state.
+    wid->style = NULL;
     // Update border.
     wid->border = rofi_theme_get_padding(wid, "border", wid->def_border);
     wid->border_radius =
         rofi_theme_get_padding(wid, "border-radius", wid->def_border_radius);
+    wid->pixels_generation = 0;
     if (wid->set_state != NULL) {
       wid->set_state(wid, state);
     }
@@ -72,6 +109,39 @@ void widget_set_state(widget *wid, const char *state) {
   }
 }
 
+/**
+ * @param wid The widget.
+ *
+ * Add the current area of the widget to the damage of its toplevel widget.
+ */
+static void widget_add_damage(widget *wid) {
+  if (wid->w < 1 || wid->h < 1) {
+    return;
+  }
+  widget *toplevel = wid;
+  while (toplevel->parent != NULL) {
+    toplevel = toplevel->parent;
+  }
+  cairo_rectangle_int_t rect = {.x = widget_get_absolute_xpos(wid),
+                                .y = widget_get_absolute_ypos(wid),
+                                .width = wid->w,
+                                .height = wid->h};
+  if (toplevel->damage == NULL) {
+    toplevel->damage = cairo_region_create_rectangle(&rect);
+  } else {
+    cairo_region_union_rectangle(toplevel->damage, &rect);
+  }
+}
+
+cairo_region_t *widget_take_damage(widget *wid) {
+  if (wid == NULL) {
+    return NULL;
+  }
+  cairo_region_t *damage = wid->damage;
+  wid->damage = NULL;
+  return damage;
+}
+
 int widget_intersect(const widget *wid, int x, int y) {
   if (wid == NULL) {
     return FALSE;
@@ -88,6 +158,10 @@ void widget_resize(widget *wid, short w, short h) {
   if (wid == NULL) {
     return;
   }
+  if (wid->w != w || wid->h != h) {
+    // The area it no longer covers needs redrawing too.
+    widget_add_damage(wid);
+  }
   if (wid->resize != NULL) {
     if (wid->w != w || wid->h != h) {
       wid->resize(wid, w, h);
@@ -103,8 +177,12 @@ void widget_move(widget *wid, short x, short y) {
   if (wid == NULL) {
     return;
   }
-  wid->x = x;
-  wid->y = y;
+  if (wid->x != x || wid->y != y) {
+    widget_add_damage(wid);
+    wid->x = x;
+    wid->y = y;
+    widget_add_damage(wid);
+  }
 }
 void widget_set_type(widget *wid, WidgetType type) {
   if (wid == NULL) {
@@ -143,32 +221,29 @@ void widget_draw(widget *wid, cairo_t *d) {
       wid->need_redraw = FALSE;
       return;
     }
+    // Don't draw if it is outside of the area being redrawn.
+    double cx1, cy1, cx2, cy2;
+    cairo_clip_extents(d, &cx1, &cy1, &cx2, &cy2);
+    if (wid->x >= cx2 || wid->y >= cy2 || (wid->x + wid->w) <= cx1 ||
+        (wid->y + wid->h) <= cy1) {
+      wid->need_redraw = FALSE;
+      return;
+    }
     // Store current state.
     cairo_save(d);
-    const int margin_left =
-        distance_get_pixel(wid->margin.left, ROFI_ORIENTATION_HORIZONTAL);
-    const int margin_top =
-        distance_get_pixel(wid->margin.top, ROFI_ORIENTATION_VERTICAL);
-    const int margin_right =
-        distance_get_pixel(wid->margin.right, ROFI_ORIENTATION_HORIZONTAL);
-    const int margin_bottom =
-        distance_get_pixel(wid->margin.bottom, ROFI_ORIENTATION_VERTICAL);
-    const int left =
-        distance_get_pixel(wid->border.left, ROFI_ORIENTATION_HORIZONTAL);
-    const int right =
-        distance_get_pixel(wid->border.right, ROFI_ORIENTATION_HORIZONTAL);
-    const int top =
-        distance_get_pixel(wid->border.top, ROFI_ORIENTATION_VERTICAL);
-    const int bottom =
-        distance_get_pixel(wid->border.bottom, ROFI_ORIENTATION_VERTICAL);
-    int radius_bl = distance_get_pixel(wid->border_radius.left,
-                                       ROFI_ORIENTATION_HORIZONTAL);
-    int radius_tr = distance_get_pixel(wid->border_radius.right,
-                                       ROFI_ORIENTATION_HORIZONTAL);
-    int radius_tl =
-        distance_get_pixel(wid->border_radius.top, ROFI_ORIENTATION_VERTICAL);
-    int radius_br = distance_get_pixel(wid->border_radius.bottom,
-                                       ROFI_ORIENTATION_VERTICAL);
+    const WidgetPixels *px = widget_get_pixels(wid);
+    const int margin_left = px->margin[0];
+    const int margin_top = px->margin[1];
+    const int margin_right = px->margin[2];
+    const int margin_bottom = px->margin[3];
+    const int left = px->border[0];
+    const int top = px->border[1];
+    const int right = px->border[2];
+    const int bottom = px->border[3];
+    int radius_bl = px->radius[0];
+    int radius_tl = px->radius[1];
+    int radius_tr = px->radius[2];
+    int radius_br = px->radius[3];
 
     double vspace =
         wid->h - margin_top - margin_bottom - top / 2.0 - bottom / 2.0;
@@ -422,6 +497,9 @@ void widget_free(widget *wid) {
   if (wid->name != NULL) {
     g_free(wid->name);
   }
+  if (wid->damage != NULL) {
+    cairo_region_destroy(wid->damage);
+  }
   if (wid->free != NULL) {
     wid->free(wid);
   }
@@ -488,6 +566,7 @@ void widget_queue_redraw(widget *wid) {
     iter = iter->parent;
   }
   iter->need_redraw = TRUE;
+  widget_add_damage(wid);
 }
 
 gboolean widget_need_redraw(widget *wid) {
@@ -570,43 +649,29 @@ int widget_padding_get_left(const widget *wid) {
   if (wid == NULL) {
     return 0;
   }
-  int distance =
-      distance_get_pixel(wid->padding.left, ROFI_ORIENTATION_HORIZONTAL);
-  distance += distance_get_pixel(wid->border.left, ROFI_ORIENTATION_HORIZONTAL);
-  distance += distance_get_pixel(wid->margin.left, ROFI_ORIENTATION_HORIZONTAL);
-  return distance;
+  const WidgetPixels *px = widget_get_pixels(wid);
+  return px->padding[0] + px->border[0] + px->margin[0];
 }
 int widget_padding_get_right(const widget *wid) {
   if (wid == NULL) {
     return 0;
   }
-  int distance =
-      distance_get_pixel(wid->padding.right, ROFI_ORIENTATION_HORIZONTAL);
-  distance +=
-      distance_get_pixel(wid->border.right, ROFI_ORIENTATION_HORIZONTAL);
-  distance +=
-      distance_get_pixel(wid->margin.right, ROFI_ORIENTATION_HORIZONTAL);
-  return distance;
+  const WidgetPixels *px = widget_get_pixels(wid);
+  return px->padding[2] + px->border[2] + px->margin[2];
 }
 int widget_padding_get_top(const widget *wid) {
   if (wid == NULL) {
     return 0;
   }
-  int distance =
-      distance_get_pixel(wid->padding.top, ROFI_ORIENTATION_VERTICAL);
-  distance += distance_get_pixel(wid->border.top, ROFI_ORIENTATION_VERTICAL);
-  distance += distance_get_pixel(wid->margin.top, ROFI_ORIENTATION_VERTICAL);
-  return distance;
+  const WidgetPixels *px = widget_get_pixels(wid);
+  return px->padding[1] + px->border[1] + px->margin[1];
 }
 int widget_padding_get_bottom(const widget *wid) {
   if (wid == NULL) {
     return 0;
   }
-  int distance =
-      distance_get_pixel(wid->padding.bottom, ROFI_ORIENTATION_VERTICAL);
-  distance += distance_get_pixel(wid->border.bottom, ROFI_ORIENTATION_VERTICAL);
-  distance += distance_get_pixel(wid->margin.bottom, ROFI_ORIENTATION_VERTICAL);
-  return distance;
+  const WidgetPixels *px = widget_get_pixels(wid);
+  return px->padding[3] + px->border[3] + px->margin[3];
 }
 
 int widget_padding_get_remaining_width(const widget *wid) {
@@ -385,9 +385,17 @@ cairo_surface_t *x11_helper_get_bg_surface(void) {
 // retrieve a text property from a window
 // technically we could use window_get_prop(), but this is better for character
 // set support
+xcb_get_property_cookie_t window_get_text_prop_cookie(xcb_window_t w,
+                                                      xcb_atom_t atom) {
+  return xcb_get_property(xcb->connection, 0, w, atom,
+                          XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX);
+}
+
 char *window_get_text_prop(xcb_window_t w, xcb_atom_t atom) {
-  xcb_get_property_cookie_t c = xcb_get_property(
-      xcb->connection, 0, w, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX);
+  return window_get_text_prop_reply(window_get_text_prop_cookie(w, atom));
+}
+
+char *window_get_text_prop_reply(xcb_get_property_cookie_t c) {
   xcb_get_property_reply_t *r =
       xcb_get_property_reply(xcb->connection, c, NULL);
   if (r) {
@@ -1256,6 +1264,13 @@ static void main_loop_x11_event_handler_view(xcb_generic_event_t *event) {
     }
     break;
   }
+  case XCB_PROPERTY_NOTIFY: {
+#ifdef WINDOW_MODE
+    xcb_property_notify_event_t *xpe = (xcb_property_notify_event_t *)event;
+    window_client_handle_property(xpe->window, xpe->atom);
+#endif
+    break;
+  }
   case XCB_EXPOSE:
     rofi_view_frame_callback();
     break;
@@ -1372,6 +1387,7 @@ static void main_loop_x11_event_handler_view(xcb_generic_event_t *event) {
   }
   case XCB_KEY_PRESS: {
     xcb_key_press_event_t *xkpe = (xcb_key_press_event_t *)event;
+    TIMINGS_LATENCY_INPUT();
 #ifdef XCB_IMDKIT
     if (xcb->ic) {
       g_log("IMDKit", G_LOG_LEVEL_DEBUG, "press key %d to xim", xkpe->detail);
@@ -1899,14 +1915,7 @@ static gboolean lazy_grab_keyboard(G_GNUC_UNUSED gpointer data) {
   return G_SOURCE_CONTINUE;
 }
 
-static gboolean xcb_display_late_setup(void) {
-  x11_create_visual_and_colormap();
-
-  x11_lookup_cursors();
-
-  /**
-   * Create window (without showing)
-   */
+static gboolean xcb_display_grab_input(void) {
   // Try to grab the keyboard as early as possible.
   // We grab this using the rootwindow (as dmenu does it).
   // this seems to result in the smallest delay for most people.
@@ -1932,6 +1941,27 @@ static gboolean xcb_display_late_setup(void) {
   return TRUE;
 }
 
+static gboolean xcb_display_late_setup(void) {
+  x11_create_visual_and_colormap();
+
+  x11_lookup_cursors();
+
+  /**
+   * Create window (without showing)
+   */
+  // The daemon grabs when a window is requested, see xcb_display_resume.
+  if (find_arg("-daemon") >= 0) {
+    return TRUE;
+  }
+  return xcb_display_grab_input();
+}
+
+static gboolean xcb_display_resume(void) {
+  lazy_grab_retry_count_kb = 0;
+  lazy_grab_retry_count_pt = 0;
+  return xcb_display_grab_input();
+}
+
 xcb_window_t xcb_stuff_get_root_window(void) { return xcb->screen->root; }
 
 static void xcb_display_early_cleanup(void) {
@@ -2055,6 +2085,7 @@ static const struct _view_proxy *xcb_display_view_proxy(void) {
 static display_proxy display_ = {
     .setup = xcb_display_setup,
     .late_setup = xcb_display_late_setup,
+    .resume = xcb_display_resume,
     .early_cleanup = xcb_display_early_cleanup,
     .cleanup = xcb_display_cleanup,
     .dump_monitor_layout = xcb_display_dump_monitor_layout,
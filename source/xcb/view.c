@@ -120,6 +120,10 @@ static struct {
   unsigned long long count;
   /** redraw idle time. */
   guint repaint_source;
+  /** Area of edit_pixmap that changed and is not yet copied to the window. */
+  cairo_region_t *copy_region;
+  /** Copy all of edit_pixmap to the window on the next repaint. */
+  gboolean copy_all;
   /** Window fullscreen */
   gboolean fullscreen;
   /** Cursor type */
@@ -132,6 +136,8 @@ static struct {
     .idle_timeout = 0,
     .count = 0L,
     .repaint_source = 0,
+    .copy_region = NULL,
+    .copy_all = TRUE,
     .fullscreen = FALSE,
 };
 
@@ -250,10 +256,31 @@ static gboolean xcb_rofi_view_repaint(G_GNUC_UNUSED void *data) {
     rofi_view_update(state, FALSE);
     g_debug("expose event");
     TICK_N("Expose");
-    xcb_copy_area(xcb->connection, XcbState.edit_pixmap, CacheState.main_window,
-                  XcbState.gc, 0, 0, 0, 0, state->width, state->height);
+    TIMINGS_LATENCY_BEGIN(ROFI_LATENCY_COMMIT);
+    if (XcbState.copy_all) {
+      xcb_copy_area(xcb->connection, XcbState.edit_pixmap,
+                    CacheState.main_window, XcbState.gc, 0, 0, 0, 0,
+                    state->width, state->height);
+    } else if (XcbState.copy_region != NULL) {
+      // Only copy what changed.
+      int n = cairo_region_num_rectangles(XcbState.copy_region);
+      for (int i = 0; i < n; i++) {
+        cairo_rectangle_int_t rect;
+        cairo_region_get_rectangle(XcbState.copy_region, i, &rect);
+        xcb_copy_area(xcb->connection, XcbState.edit_pixmap,
+                      CacheState.main_window, XcbState.gc, rect.x, rect.y,
+                      rect.x, rect.y, rect.width, rect.height);
+      }
+    }
+    if (XcbState.copy_region != NULL) {
+      cairo_region_destroy(XcbState.copy_region);
+      XcbState.copy_region = NULL;
+    }
+    XcbState.copy_all = FALSE;
     xcb_flush(xcb->connection);
     TICK_N("flush");
+    TIMINGS_LATENCY_END(ROFI_LATENCY_COMMIT);
+    TIMINGS_LATENCY_MARK(ROFI_LATENCY_INPUT_TO_PAINT);
     XcbState.repaint_source = 0;
   }
   return (bench_update() == TRUE) ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
@@ -271,7 +298,29 @@ static void xcb_rofi_view_update(RofiViewState *state, gboolean qr) {
   }
   g_debug("Redraw view");
   TICK();
+  TIMINGS_SPAN_BEGIN("draw");
+  TIMINGS_LATENCY_BEGIN(ROFI_LATENCY_DRAW);
   cairo_t *d = XcbState.edit_draw;
+  // Only redraw the area that changed, if known.
+  cairo_region_t *damage = widget_take_damage(WIDGET(state->main_window));
+  cairo_save(d);
+  if (damage != NULL) {
+    int n = cairo_region_num_rectangles(damage);
+    for (int i = 0; i < n; i++) {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle(damage, i, &rect);
+      cairo_rectangle(d, rect.x, rect.y, rect.width, rect.height);
+    }
+    cairo_clip(d);
+    if (XcbState.copy_region == NULL) {
+      XcbState.copy_region = cairo_region_copy(damage);
+    } else {
+      cairo_region_union(XcbState.copy_region, damage);
+    }
+    cairo_region_destroy(damage);
+  } else {
+    XcbState.copy_all = TRUE;
+  }
   cairo_set_operator(d, CAIRO_OPERATOR_SOURCE);
   if (XcbState.fake_bg != NULL) {
     if (XcbState.fake_bgrel) {
@@ -302,8 +351,12 @@ static void xcb_rofi_view_update(RofiViewState *state, gboolean qr) {
   rofi_set_im_window_pos(x, y);
 #endif
 
+  cairo_restore(d);
+
   TICK_N("widgets");
   cairo_surface_flush(XcbState.edit_surf);
+  TIMINGS_LATENCY_END(ROFI_LATENCY_DRAW);
+  TIMINGS_SPAN_END("draw");
   if (qr) {
     rofi_view_queue_redraw();
   }
@@ -767,6 +820,8 @@ static void xcb___create_window(MenuFlags menu_flags) {
     config.dpi =
         pango_cairo_font_map_get_resolution((PangoCairoFontMap *)font_map);
   }
+  // The monitor and dpi are known now.
+  distance_bump_generation();
   // Setup font.
   // Dummy widget.
   box *win = box_create(NULL, "window", ROFI_ORIENTATION_HORIZONTAL);
@@ -920,6 +975,8 @@ static void xcb_rofi_view_temp_click_to_exit(RofiViewState *state,
 }
 
 static void xcb_rofi_view_frame_callback(void) {
+  // The window contents got lost, copy all of it again.
+  XcbState.copy_all = TRUE;
   if (XcbState.repaint_source == 0) {
     XcbState.count++;
     g_debug("redraw %llu", XcbState.count);
@@ -977,6 +1034,11 @@ static void xcb_rofi_view_cleanup(void) {
     cairo_surface_destroy(XcbState.fake_bg);
     XcbState.fake_bg = NULL;
   }
+  if (XcbState.copy_region) {
+    cairo_region_destroy(XcbState.copy_region);
+    XcbState.copy_region = NULL;
+  }
+  XcbState.copy_all = TRUE;
   if (XcbState.edit_draw) {
     cairo_destroy(XcbState.edit_draw);
     XcbState.edit_draw = NULL;
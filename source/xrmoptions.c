@@ -131,6 +131,18 @@ static XrmOption xrmOptions[] = {
      NULL,
      "Custom command to generate preview icons",
      CONFIG_DEFAULT},
+    {xrm_Number,
+     "max-thumbnailers",
+     {.num = &config.max_thumbnailers},
+     NULL,
+     "Maximum number of thumbnailers running at the same time",
+     CONFIG_DEFAULT},
+    {xrm_String,
+     "icon-cache-size",
+     {.str = &config.icon_cache_size},
+     NULL,
+     "Memory budget for loaded icons, e.g. 64M (unlimited if not set)",
+     CONFIG_DEFAULT},
 
     {xrm_String,
      "terminal",
@@ -466,6 +478,10 @@ GList *extra_parsed_options = NULL;
 
 static gboolean __config_parser_set_property(XrmOption *option,
                                              const Property *p, char **error);
+static void config_parse_cmd_option(XrmOption *option);
+
+/** The commandline options have been parsed. */
+static gboolean cmd_options_parsed = FALSE;
 
 void config_parser_add_option(XrmOptionType type, const char *key, void **value,
                               const char *comment) {
@@ -496,10 +512,13 @@ void config_parser_add_option(XrmOptionType type, const char *key, void **value,
         g_debug("Failed to set property on custom entry: %s", key);
         g_free(error);
       }
-      num_extra_options++;
-      return;
+      break;
     }
   }
+  // Options added late (lazily loaded plugins) still honor the commandline.
+  if (cmd_options_parsed) {
+    config_parse_cmd_option(&(extra_options[num_extra_options]));
+  }
   num_extra_options++;
 }
 
@@ -584,6 +603,7 @@ void config_parse_cmd_options(void) {
     XrmOption *op = &(extra_options[i]);
     config_parse_cmd_option(op);
   }
+  cmd_options_parsed = TRUE;
 
   /** copy of the argc for use in commandline argument parser. */
   extern int stored_argc;
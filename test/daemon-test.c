@@ -0,0 +1,216 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2017 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "display.h"
+#include "rofi-daemon.h"
+#include "rofi-icon-fetcher.h"
+#include "rofi.h"
+#include "settings.h"
+#include "widgets/textbox.h"
+#include <assert.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <helper.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static int test = 0;
+
+#define TASSERT(a)                                                             \
+  {                                                                            \
+    assert(a);                                                                 \
+    printf("Test %i passed (%s)\n", ++test, #a);                               \
+  }
+#include "theme.h"
+ThemeWidget *rofi_theme = NULL;
+
+uint32_t rofi_icon_fetcher_query(G_GNUC_UNUSED const char *name,
+                                 G_GNUC_UNUSED const int size) {
+  return 0;
+}
+uint32_t rofi_icon_fetcher_query_advanced(G_GNUC_UNUSED const char *name,
+                                          G_GNUC_UNUSED const int wsize,
+                                          G_GNUC_UNUSED const int hsize) {
+  return 0;
+}
+
+cairo_surface_t *rofi_icon_fetcher_get(G_GNUC_UNUSED const uint32_t uid) {
+  return NULL;
+}
+
+void rofi_clear_error_messages(void) {}
+void rofi_clear_warning_messages(void) {}
+
+gboolean rofi_theme_parse_string(G_GNUC_UNUSED const char *string) {
+  return FALSE;
+}
+double textbox_get_estimated_char_height(void) { return 12.0; }
+void rofi_view_get_current_monitor(int *width, int *height) {
+  *width = 1920;
+  *height = 1080;
+}
+double textbox_get_estimated_ch(void) { return 9.0; }
+void rofi_add_error_message(G_GNUC_UNUSED GString *msg) {}
+void rofi_add_warning_message(G_GNUC_UNUSED GString *msg) {}
+int rofi_view_error_dialog(const char *msg, G_GNUC_UNUSED int markup) {
+  fputs(msg, stderr);
+  return TRUE;
+}
+int monitor_active(G_GNUC_UNUSED workarea *mon) { return 0; }
+
+void display_startup_notification(
+    G_GNUC_UNUSED RofiHelperExecuteContext *context,
+    G_GNUC_UNUSED GSpawnChildSetupFunc *child_setup,
+    G_GNUC_UNUSED gpointer *user_data) {}
+
+/** What the daemon saw for the last request. */
+static gboolean shown = FALSE;
+static char *shown_mode = NULL;
+static char *shown_filter = NULL;
+static char *shown_cwd = NULL;
+static char *shown_token = NULL;
+static char *shown_home = NULL;
+
+static void test_show(const char *mode, const char *filter) {
+  g_free(shown_mode);
+  g_free(shown_filter);
+  g_free(shown_cwd);
+  g_free(shown_token);
+  g_free(shown_home);
+  shown_mode = g_strdup(mode);
+  shown_filter = g_strdup(filter);
+  shown_cwd = g_get_current_dir();
+  shown_token = g_strdup(g_getenv("XDG_ACTIVATION_TOKEN"));
+  shown_home = g_strdup(g_getenv("HOME"));
+  shown = TRUE;
+  // The window is closed right away.
+  rofi_daemon_session_finish(42);
+}
+
+static void test_wait_show(void) {
+  shown = FALSE;
+  while (!shown) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+}
+
+static gpointer test_forward_thread(G_GNUC_UNUSED gpointer data) {
+  char *args[] = {"rofi", "-show", "drun", "-filter", "fire", NULL};
+  return GINT_TO_POINTER(rofi_daemon_forward(5, args));
+}
+
+int main(G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv) {
+  if (setlocale(LC_ALL, "") == NULL) {
+    fprintf(stderr, "Failed to set locale.\n");
+    return EXIT_FAILURE;
+  }
+  char *runtime = g_dir_make_tmp("rofi-daemon-test-XXXXXX", NULL);
+  TASSERT(runtime != NULL);
+  // Read once by glib, before the daemon looks up its socket.
+  g_setenv("XDG_RUNTIME_DIR", runtime, TRUE);
+  char *start_cwd = g_get_current_dir();
+  // The daemon reports the resolved directory.
+  char *real_runtime = realpath(runtime, NULL);
+  TASSERT(real_runtime != NULL);
+
+  // No daemon running, the request is not forwarded.
+  {
+    char *args[] = {"rofi", "-show", "drun", NULL};
+    TASSERT(rofi_daemon_forward(3, args) == -1);
+  }
+
+  TASSERT(rofi_daemon_lock(FALSE));
+  TASSERT(rofi_daemon_start(test_show));
+
+  // Anything but -show and -filter needs a full rofi.
+  {
+    char *args[] = {"rofi", "-show", "drun", "-dmenu", NULL};
+    TASSERT(rofi_daemon_forward(4, args) == -1);
+  }
+
+  // Forward a request and get the exit code of the window back.
+  {
+    g_setenv("XDG_ACTIVATION_TOKEN", "token-1", TRUE);
+    GThread *client = g_thread_new("client", test_forward_thread, NULL);
+    test_wait_show();
+    TASSERT(GPOINTER_TO_INT(g_thread_join(client)) == 42);
+    TASSERT(g_strcmp0(shown_mode, "drun") == 0);
+    TASSERT(g_strcmp0(shown_filter, "fire") == 0);
+    TASSERT(g_strcmp0(shown_token, "token-1") == 0);
+    TASSERT(g_strcmp0(shown_cwd, start_cwd) == 0);
+  }
+
+  // A request from another directory and without a token, only the forwarded
+  // variables are applied.
+  {
+    char *path = g_build_filename(runtime, "rofi-daemon.sock", NULL);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    g_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+    g_free(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TASSERT(fd >= 0);
+    TASSERT(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    char *home = g_strdup(g_getenv("HOME"));
+    char *request =
+        g_strdup_printf("show run\ncwd %s\nenv HOME=/nowhere\n\n", runtime);
+    TASSERT(write(fd, request, strlen(request)) == (ssize_t)strlen(request));
+    g_free(request);
+    test_wait_show();
+    char reply[32] = {0};
+    TASSERT(read(fd, reply, sizeof(reply) - 1) > 0);
+    TASSERT(strcmp(reply, "42\n") == 0);
+    close(fd);
+    TASSERT(g_strcmp0(shown_mode, "run") == 0);
+    TASSERT(shown_filter == NULL);
+    TASSERT(shown_token == NULL);
+    TASSERT(g_strcmp0(shown_cwd, real_runtime) == 0);
+    TASSERT(g_strcmp0(shown_home, home) == 0);
+    g_free(home);
+  }
+
+  rofi_daemon_stop();
+  TASSERT(g_chdir(start_cwd) == 0);
+  char *pid_path = g_build_filename(runtime, "rofi-daemon.pid", NULL);
+  TASSERT(g_unlink(pid_path) == 0);
+  g_free(pid_path);
+  TASSERT(g_rmdir(runtime) == 0);
+  free(real_runtime);
+  g_free(start_cwd);
+  g_free(runtime);
+  g_free(shown_mode);
+  g_free(shown_filter);
+  g_free(shown_cwd);
+  g_free(shown_token);
+  g_free(shown_home);
+}
@@ -0,0 +1,449 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2023 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * Headless benchmark of the matching, scoring and sorting code on synthetic
+ * data. The filter pipeline mirrors rofi_view_refilter: tokenize, match in
+ * chunks on a thread pool, score and sort. The reader mirrors the dmenu
+ * reader: getdelim and rofi_force_utf8.
+ *
+ * Usage: filter.benchmark [lines ...]
+ */
+
+#include "display.h"
+#include "rofi-icon-fetcher.h"
+#include "rofi-types.h"
+#include "rofi.h"
+#include "settings.h"
+#include "theme.h"
+#include "widgets/textbox.h"
+#include <glib.h>
+#include <helper.h>
+#include <locale.h>
+#include <pango/pango.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ThemeWidget *rofi_theme = NULL;
+
+uint32_t rofi_icon_fetcher_query(G_GNUC_UNUSED const char *name,
+                                 G_GNUC_UNUSED const int size) {
+  return 0;
+}
+uint32_t rofi_icon_fetcher_query_advanced(G_GNUC_UNUSED const char *name,
+                                          G_GNUC_UNUSED const int wsize,
+                                          G_GNUC_UNUSED const int hsize) {
+  return 0;
+}
+void rofi_clear_error_messages(void) {}
+void rofi_clear_warning_messages(void) {}
+
+cairo_surface_t *rofi_icon_fetcher_get(G_GNUC_UNUSED const uint32_t uid) {
+  return NULL;
+}
+
+gboolean rofi_theme_parse_string(G_GNUC_UNUSED const char *string) {
+  return FALSE;
+}
+
+double textbox_get_estimated_char_height(void) { return 12.0; }
+void rofi_view_get_current_monitor(int *width, int *height) {
+  *width = 1920;
+  *height = 1080;
+}
+double textbox_get_estimated_ch(void) { return 9.0; }
+void rofi_add_error_message(G_GNUC_UNUSED GString *msg) {}
+void rofi_add_warning_message(G_GNUC_UNUSED GString *msg) {}
+int rofi_view_error_dialog(const char *msg, G_GNUC_UNUSED int markup) {
+  fputs(msg, stderr);
+  return TRUE;
+}
+int monitor_active(G_GNUC_UNUSED workarea *mon) { return 0; }
+
+void display_startup_notification(
+    G_GNUC_UNUSED RofiHelperExecuteContext *context,
+    G_GNUC_UNUSED GSpawnChildSetupFunc *child_setup,
+    G_GNUC_UNUSED gpointer *user_data) {}
+
+/** Kind of synthetic data. */
+typedef enum { DATA_ASCII, DATA_CJK, DATA_MARKUP, DATA_NUM } DataKind;
+
+static const char *const data_names[DATA_NUM] = {"ascii", "cjk", "markup"};
+/** Query used for each kind of data. */
+static const char *const data_queries[DATA_NUM] = {"fire ed", "设置 文", "term"};
+
+static const char *const words_ascii[] = {
+    "firefox", "terminal", "editor",  "settings", "files",   "music",
+    "video",   "browser",  "network", "display",  "keyboard", "printer",
+    "mail",    "calendar", "notes",   "camera",   "weather", "clock"};
+static const char *const words_cjk[] = {"文件", "设置", "终端", "浏览器",
+                                        "编辑器", "音乐", "视频", "图片",
+                                        "网络", "日历", "邮件", "相机"};
+
+static const char *const method_names[] = {"normal", "regex", "glob", "fuzzy",
+                                           "prefix"};
+static const char *const sort_names[] = {"none", "levenshtein", "fzf"};
+
+/** A generated dataset. */
+typedef struct {
+  DataKind kind;
+  unsigned int length;
+  /** Lines as shown. */
+  char **lines;
+  /** Lines as matched, markup stripped. */
+  char **match;
+} Dataset;
+
+static Dataset *dataset_new(DataKind kind, unsigned int length) {
+  Dataset *ds = g_malloc0(sizeof(Dataset));
+  ds->kind = kind;
+  ds->length = length;
+  ds->lines = g_malloc0_n(length + 1, sizeof(char *));
+  ds->match = g_malloc0_n(length + 1, sizeof(char *));
+  // Fixed seed, so runs are comparable.
+  GRand *rand = g_rand_new_with_seed(42);
+  GString *str = g_string_new(NULL);
+  for (unsigned int i = 0; i < length; i++) {
+    g_string_truncate(str, 0);
+    int words = g_rand_int_range(rand, 2, 6);
+    for (int w = 0; w < words; w++) {
+      if (w > 0) {
+        g_string_append_c(str, ' ');
+      }
+      if (kind == DATA_CJK) {
+        g_string_append(str, words_cjk[g_rand_int_range(
+                                 rand, 0, G_N_ELEMENTS(words_cjk))]);
+      } else {
+        const char *word =
+            words_ascii[g_rand_int_range(rand, 0, G_N_ELEMENTS(words_ascii))];
+        if (kind == DATA_MARKUP && (w % 2) == 0) {
+          g_string_append_printf(str, "<b>%s</b>", word);
+        } else {
+          g_string_append(str, word);
+        }
+      }
+    }
+    g_string_append_printf(str, " %u", i);
+    ds->lines[i] = g_strdup(str->str);
+    if (kind == DATA_MARKUP) {
+      pango_parse_markup(ds->lines[i], -1, 0, NULL, &(ds->match[i]), NULL,
+                         NULL);
+    } else {
+      ds->match[i] = ds->lines[i];
+    }
+  }
+  g_string_free(str, TRUE);
+  g_rand_free(rand);
+  return ds;
+}
+
+static void dataset_free(Dataset *ds) {
+  for (unsigned int i = 0; i < ds->length; i++) {
+    if (ds->match[i] != ds->lines[i]) {
+      g_free(ds->match[i]);
+    }
+    g_free(ds->lines[i]);
+  }
+  g_free(ds->match);
+  g_free(ds->lines);
+  g_free(ds);
+}
+
+static void report(const char *bench, const Dataset *ds, const char *method,
+                   const char *sort, unsigned int threads, unsigned int ops,
+                   double elapsed) {
+  double ns = (elapsed * 1e9) / MAX(1, ops);
+  double per_sec = (elapsed > 0.0) ? (ops / elapsed) : 0.0;
+  printf("%-10s %-7s %8u %-7s %-12s %2u %12.1f ns/line %14.0f lines/s\n",
+         bench, data_names[ds->kind], ds->length, method, sort, threads, ns,
+         per_sec);
+}
+
+/** Chunk of the filter pipeline, like thread_state_view in view.c */
+typedef struct {
+  const Dataset *ds;
+  rofi_int_matcher **tokens;
+  const char *pattern;
+  glong plen;
+  unsigned int *line_map;
+  int *distance;
+  unsigned int start;
+  unsigned int stop;
+  unsigned int count;
+  GMutex *mutex;
+  GCond *cond;
+  unsigned int *acount;
+} FilterJob;
+
+static void filter_job_run(gpointer data, G_GNUC_UNUSED gpointer user_data) {
+  FilterJob *t = (FilterJob *)data;
+  for (unsigned int i = t->start; i < t->stop; i++) {
+    if (helper_token_match(t->tokens, t->ds->match[i])) {
+      t->line_map[t->start + t->count] = i;
+      if (config.sort) {
+        const char *str = t->ds->match[i];
+        glong slen = g_utf8_strlen(str, -1);
+        if (config.sorting_method_enum == SORT_FZF) {
+          t->distance[i] =
+              rofi_scorer_fuzzy_evaluate(t->pattern, t->plen, str, slen);
+        } else {
+          t->distance[i] = levenshtein(t->pattern, t->plen, str, slen);
+        }
+      }
+      t->count++;
+    }
+  }
+  g_mutex_lock(t->mutex);
+  (*(t->acount))--;
+  g_cond_signal(t->cond);
+  g_mutex_unlock(t->mutex);
+}
+
+static int distance_sort(const void *p1, const void *p2, void *arg) {
+  const unsigned int *a = p1;
+  const unsigned int *b = p2;
+  int *distances = arg;
+  return distances[*a] - distances[*b];
+}
+
+/**
+ * Run the filter pipeline once.
+ *
+ * @returns the number of matched lines.
+ */
+static unsigned int filter_run(GThreadPool *pool, const Dataset *ds,
+                               unsigned int threads, unsigned int *line_map,
+                               int *distance) {
+  const char *pattern = data_queries[ds->kind];
+  rofi_int_matcher **tokens = helper_tokenize(pattern, config.case_sensitive);
+  unsigned int nt = MAX(1, ds->length / 500);
+  nt = MIN(nt, threads * 4);
+  FilterJob *jobs = g_malloc0_n(nt, sizeof(FilterJob));
+  GMutex mutex;
+  GCond cond;
+  g_mutex_init(&mutex);
+  g_cond_init(&cond);
+  unsigned int count = nt;
+  unsigned int steps = (ds->length + nt) / nt;
+  for (unsigned int i = 0; i < nt; i++) {
+    jobs[i].ds = ds;
+    jobs[i].tokens = tokens;
+    jobs[i].pattern = pattern;
+    jobs[i].plen = g_utf8_strlen(pattern, -1);
+    jobs[i].line_map = line_map;
+    jobs[i].distance = distance;
+    jobs[i].start = i * steps;
+    jobs[i].stop = MIN(ds->length, (i + 1) * steps);
+    jobs[i].mutex = &mutex;
+    jobs[i].cond = &cond;
+    jobs[i].acount = &count;
+    if (i > 0) {
+      g_thread_pool_push(pool, &jobs[i], NULL);
+    }
+  }
+  filter_job_run(&jobs[0], NULL);
+  g_mutex_lock(&mutex);
+  while (count > 0) {
+    g_cond_wait(&cond, &mutex);
+  }
+  g_mutex_unlock(&mutex);
+  g_cond_clear(&cond);
+  g_mutex_clear(&mutex);
+
+  unsigned int j = 0;
+  for (unsigned int i = 0; i < nt; i++) {
+    if (j != jobs[i].start) {
+      memmove(&(line_map[j]), &(line_map[jobs[i].start]),
+              sizeof(unsigned int) * jobs[i].count);
+    }
+    j += jobs[i].count;
+  }
+  if (config.sort) {
+    g_qsort_with_data(line_map, j, sizeof(unsigned int), distance_sort,
+                      distance);
+  }
+  g_free(jobs);
+  helper_tokenize_free(tokens);
+  return j;
+}
+
+static void bench_tokenize(const Dataset *ds) {
+  // Tokenizing does not depend on the data, so limit the iterations.
+  unsigned int iterations = MIN(ds->length, 10000);
+  for (int m = MM_NORMAL; m <= MM_PREFIX; m++) {
+    config.matching_method = m;
+    GTimer *timer = g_timer_new();
+    for (unsigned int i = 0; i < iterations; i++) {
+      helper_tokenize_free(helper_tokenize(data_queries[ds->kind], FALSE));
+    }
+    report("tokenize", ds, method_names[m], "-", 1, iterations,
+           g_timer_elapsed(timer, NULL));
+    g_timer_destroy(timer);
+  }
+}
+
+static void bench_match(const Dataset *ds) {
+  for (int m = MM_NORMAL; m <= MM_PREFIX; m++) {
+    config.matching_method = m;
+    rofi_int_matcher **tokens = helper_tokenize(data_queries[ds->kind], FALSE);
+    unsigned int hits = 0;
+    GTimer *timer = g_timer_new();
+    for (unsigned int i = 0; i < ds->length; i++) {
+      hits += helper_token_match(tokens, ds->match[i]);
+    }
+    report("match", ds, method_names[m], "-", 1, ds->length,
+           g_timer_elapsed(timer, NULL));
+    g_timer_destroy(timer);
+    helper_tokenize_free(tokens);
+    if (hits > ds->length) {
+      abort();
+    }
+  }
+}
+
+static void bench_score(const Dataset *ds) {
+  const char *pattern = data_queries[ds->kind];
+  glong plen = g_utf8_strlen(pattern, -1);
+  for (int s = SORT_NORMAL; s <= SORT_FZF; s++) {
+    long sum = 0;
+    GTimer *timer = g_timer_new();
+    for (unsigned int i = 0; i < ds->length; i++) {
+      const char *str = ds->match[i];
+      glong slen = g_utf8_strlen(str, -1);
+      if (s == SORT_FZF) {
+        sum += rofi_scorer_fuzzy_evaluate(pattern, plen, str, slen);
+      } else {
+        sum += levenshtein(pattern, plen, str, slen);
+      }
+    }
+    report("score", ds, "-", sort_names[s + 1], 1, ds->length,
+           g_timer_elapsed(timer, NULL));
+    g_timer_destroy(timer);
+    if (sum == G_MAXLONG) {
+      abort();
+    }
+  }
+}
+
+static void bench_filter(const Dataset *ds, const unsigned int *thread_counts,
+                         unsigned int num_thread_counts) {
+  unsigned int *line_map = g_malloc0_n(ds->length, sizeof(unsigned int));
+  int *distance = g_malloc0_n(ds->length, sizeof(int));
+  for (unsigned int t = 0; t < num_thread_counts; t++) {
+    unsigned int threads = thread_counts[t];
+    // The calling thread runs one chunk, like in the view.
+    GThreadPool *pool = g_thread_pool_new(filter_job_run, NULL,
+                                          MAX(1, threads - 1), TRUE, NULL);
+    for (int m = MM_NORMAL; m <= MM_PREFIX; m++) {
+      config.matching_method = m;
+      for (int s = -1; s <= SORT_FZF; s++) {
+        config.sort = (s >= 0);
+        config.sorting_method_enum = MAX(s, SORT_NORMAL);
+        GTimer *timer = g_timer_new();
+        filter_run(pool, ds, threads, line_map, distance);
+        report("filter", ds, method_names[m], sort_names[s + 1], threads,
+               ds->length, g_timer_elapsed(timer, NULL));
+        g_timer_destroy(timer);
+      }
+    }
+    g_thread_pool_free(pool, FALSE, TRUE);
+  }
+  g_free(distance);
+  g_free(line_map);
+}
+
+static void bench_reader(const Dataset *ds) {
+  GString *input = g_string_new(NULL);
+  for (unsigned int i = 0; i < ds->length; i++) {
+    g_string_append(input, ds->lines[i]);
+    g_string_append_c(input, '\n');
+  }
+  FILE *fp = fmemopen(input->str, input->len, "r");
+  if (fp == NULL) {
+    g_string_free(input, TRUE);
+    return;
+  }
+  char **entries = g_malloc0_n(ds->length + 1, sizeof(char *));
+  unsigned int length = 0;
+  char *line = NULL;
+  size_t len = 0;
+  ssize_t nread = 0;
+  GTimer *timer = g_timer_new();
+  while (length < ds->length && (nread = getdelim(&line, &len, '\n', fp)) != -1) {
+    if (line[nread - 1] == '\n') {
+      nread--;
+      line[nread] = '\0';
+    }
+    entries[length++] = rofi_force_utf8(line, nread);
+  }
+  report("reader", ds, "-", "-", 1, length, g_timer_elapsed(timer, NULL));
+  g_timer_destroy(timer);
+  free(line);
+  fclose(fp);
+  g_strfreev(entries);
+  g_string_free(input, TRUE);
+}
+
+int main(int argc, char **argv) {
+  if (setlocale(LC_ALL, "") == NULL) {
+    fprintf(stderr, "Failed to set locale.\n");
+    return EXIT_FAILURE;
+  }
+  cmd_set_arguments(argc, argv);
+
+  unsigned int sizes[16] = {1000, 100000, 1000000};
+  unsigned int num_sizes = 3;
+  if (argc > 1) {
+    num_sizes = 0;
+    for (int i = 1; i < argc && num_sizes < G_N_ELEMENTS(sizes); i++) {
+      sizes[num_sizes++] = (unsigned int)g_ascii_strtoull(argv[i], NULL, 10);
+    }
+  }
+  unsigned int thread_counts[4] = {1, 2, 4, 0};
+  unsigned int num_thread_counts = 3;
+  unsigned int ncpu = g_get_num_processors();
+  if (ncpu > 4) {
+    thread_counts[num_thread_counts++] = ncpu;
+  }
+
+  printf("%-10s %-7s %8s %-7s %-12s %2s %20s %22s\n", "bench", "data", "lines",
+         "method", "sort", "th", "time", "rate");
+  for (unsigned int s = 0; s < num_sizes; s++) {
+    for (int kind = 0; kind < DATA_NUM; kind++) {
+      Dataset *ds = dataset_new(kind, sizes[s]);
+      config.sort = FALSE;
+      bench_tokenize(ds);
+      bench_match(ds);
+      bench_score(ds);
+      bench_filter(ds, thread_counts, num_thread_counts);
+      bench_reader(ds);
+      dataset_free(ds);
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -202,6 +202,23 @@ int main(int argc, char **argv) {
     TASSERTL(rofi_scorer_fuzzy_evaluate("aap noot mies", 12, "Anm", 3),
              1073741824);
   }
+  {
+    GArray *spans = rofi_scorer_fuzzy_align("anm", 3, "aap noot mies");
+    TASSERT(spans != NULL);
+    TASSERTE(spans->len, 3u);
+    TASSERTL(g_array_index(spans, rofi_range_pair, 0).start, 0);
+    TASSERTL(g_array_index(spans, rofi_range_pair, 1).start, 4);
+    TASSERTL(g_array_index(spans, rofi_range_pair, 2).start, 9);
+    TASSERTL(g_array_index(spans, rofi_range_pair, 2).stop, 10);
+    g_array_free(spans, TRUE);
+    spans = rofi_scorer_fuzzy_align("noo", 3, "aap noot mies");
+    TASSERT(spans != NULL);
+    TASSERTE(spans->len, 1u);
+    TASSERTL(g_array_index(spans, rofi_range_pair, 0).start, 4);
+    TASSERTL(g_array_index(spans, rofi_range_pair, 0).stop, 7);
+    g_array_free(spans, TRUE);
+    TASSERT(rofi_scorer_fuzzy_align("blu", 3, "aap noot mies") == NULL);
+  }
 
   char *a;
   a = helper_string_replace_if_exists(
@@ -139,6 +139,17 @@ START_TEST(test_mode_num_items) {
 }
 END_TEST
 
+START_TEST(test_mode_init_claim) {
+  mode_init_claim(&help_keys_mode);
+  ck_assert_int_eq(mode_init_pending(&help_keys_mode), TRUE);
+  // Not queried before it is loaded.
+  ck_assert_int_eq(mode_get_num_entries(&help_keys_mode), 0);
+  ck_assert_int_eq(mode_init_claimed(&help_keys_mode), TRUE);
+  ck_assert_int_eq(mode_init_pending(&help_keys_mode), FALSE);
+  ck_assert_int_eq(mode_get_num_entries(&help_keys_mode), 79);
+}
+END_TEST
+
 START_TEST(test_mode_result) {
   char *res;
 
@@ -192,6 +203,7 @@ static Suite *mode_suite(void) {
   tcase_add_checked_fixture(tc_core, test_mode_setup, test_mode_teardown);
   tcase_add_test(tc_core, test_mode_create);
   tcase_add_test(tc_core, test_mode_num_items);
+  tcase_add_test(tc_core, test_mode_init_claim);
   tcase_add_test(tc_core, test_mode_result);
   tcase_add_test(tc_core, test_mode_destroy);
   tcase_add_test(tc_core, test_mode_match_entry);
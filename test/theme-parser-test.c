@@ -35,6 +35,7 @@
 #include "widgets/widget-internal.h"
 #include <assert.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <helper.h>
 #include <locale.h>
 #include <stdio.h>
@@ -204,7 +205,7 @@ START_TEST(test_core_newline) {
 END_TEST
 
 START_TEST(test_properties_boolean) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   /** Boolean property */
@@ -219,7 +220,7 @@ START_TEST(test_properties_boolean) {
 END_TEST
 
 START_TEST(test_properties_boolean_reference) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -233,7 +234,7 @@ START_TEST(test_properties_boolean_reference) {
 END_TEST
 
 START_TEST(test_properties_distance_em) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10em;}");
@@ -248,7 +249,7 @@ START_TEST(test_properties_distance_em) {
 }
 END_TEST
 START_TEST(test_properties_distance_em_linestyle) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { sol: 1.3em solid; dash: 1.5em dash;}");
@@ -268,7 +269,7 @@ START_TEST(test_properties_distance_em_linestyle) {
 }
 END_TEST
 START_TEST(test_properties_distance_ch) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10ch;}");
@@ -283,7 +284,7 @@ START_TEST(test_properties_distance_ch) {
 }
 END_TEST
 START_TEST(test_properties_distance_ch_linestyle) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { sol: 1.3ch solid; dash: 1.5ch dash;}");
@@ -303,7 +304,7 @@ START_TEST(test_properties_distance_ch_linestyle) {
 }
 END_TEST
 START_TEST(test_properties_distance_px) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10px;}");
@@ -318,7 +319,7 @@ START_TEST(test_properties_distance_px) {
 }
 END_TEST
 START_TEST(test_properties_distance_px_linestyle) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { sol: 10px solid; dash: 14px dash;}");
@@ -337,7 +338,7 @@ START_TEST(test_properties_distance_px_linestyle) {
 }
 END_TEST
 START_TEST(test_properties_distance_percent) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10%;}");
@@ -352,7 +353,7 @@ START_TEST(test_properties_distance_percent) {
 }
 END_TEST
 START_TEST(test_properties_distance_percent_linestyle) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { sol: 10% solid; dash: 10% dash;}");
@@ -372,7 +373,7 @@ START_TEST(test_properties_distance_percent_linestyle) {
 END_TEST
 
 START_TEST(test_properties_distance_mm) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10mm;}");
@@ -388,7 +389,7 @@ START_TEST(test_properties_distance_mm) {
 END_TEST
 
 START_TEST(test_properties_distance_mm_linestyle) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { sol: 10mm solid; dash: 10mm dash;}");
@@ -407,7 +408,7 @@ START_TEST(test_properties_distance_mm_linestyle) {
 }
 END_TEST
 START_TEST(test_properties_position) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { center: center; east: east; west: west; south: "
@@ -469,7 +470,7 @@ START_TEST(test_properties_position) {
 END_TEST
 
 START_TEST(test_properties_style) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { none: none; bold: bold; underline: underline; "
@@ -488,7 +489,7 @@ START_TEST(test_properties_style) {
 }
 END_TEST
 START_TEST(test_properties_style2) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
 
@@ -507,7 +508,7 @@ START_TEST(test_properties_style2) {
 }
 END_TEST
 START_TEST(test_properties_style_color) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { comb: bold #123; }");
@@ -521,7 +522,7 @@ START_TEST(test_properties_style_color) {
 END_TEST
 
 START_TEST(test_properties_color_h3) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { red: #F00; green: #0F0; blue: #00F; }");
@@ -545,7 +546,7 @@ START_TEST(test_properties_color_h3) {
 END_TEST
 
 START_TEST(test_properties_color_h6) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { red: #FF0000; green: #00FF00; blue: #0000FF; }");
@@ -569,7 +570,7 @@ START_TEST(test_properties_color_h6) {
 END_TEST
 
 START_TEST(test_properties_color_h4) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { red: #F003; green: #0F02; blue: #00F1; }");
@@ -595,7 +596,7 @@ START_TEST(test_properties_color_h4) {
 }
 END_TEST
 START_TEST(test_properties_color_h8) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -622,7 +623,7 @@ START_TEST(test_properties_color_h8) {
 }
 END_TEST
 START_TEST(test_properties_color_rgb) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { red: rgb(100%,0%,0%); green: rgb(0%,100%,0%); "
@@ -646,7 +647,7 @@ START_TEST(test_properties_color_rgb) {
 }
 END_TEST
 START_TEST(test_properties_color_rgba_p) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -674,7 +675,7 @@ START_TEST(test_properties_color_rgba_p) {
 }
 END_TEST
 START_TEST(test_properties_color_rgba_percent_p) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -702,7 +703,7 @@ START_TEST(test_properties_color_rgba_percent_p) {
 }
 END_TEST
 START_TEST(test_properties_color_rgb_p) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -726,7 +727,7 @@ START_TEST(test_properties_color_rgb_p) {
 }
 END_TEST
 START_TEST(test_properties_color_rgba) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { red: rgba(255,0,0,0.3); green: "
@@ -754,7 +755,7 @@ START_TEST(test_properties_color_rgba) {
 }
 END_TEST
 START_TEST(test_properties_color_rgba_percent) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { red: rgba(255,0,0,30%); green: "
@@ -781,7 +782,7 @@ START_TEST(test_properties_color_rgba_percent) {
 }
 END_TEST
 START_TEST(test_properties_color_argb) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -808,7 +809,7 @@ START_TEST(test_properties_color_argb) {
 }
 END_TEST
 START_TEST(test_properties_color_hsl) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test1: hsl(127,40%,66.66666%); test2: hsl(0, "
@@ -836,7 +837,7 @@ START_TEST(test_properties_color_hsl) {
 }
 END_TEST
 START_TEST(test_properties_color_hsla) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test1: hsla(127,40%,66.66666%, 40%); test2: "
@@ -858,7 +859,7 @@ START_TEST(test_properties_color_hsla) {
 }
 END_TEST
 START_TEST(test_properties_color_hsl_ws) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -887,7 +888,7 @@ START_TEST(test_properties_color_hsl_ws) {
 }
 END_TEST
 START_TEST(test_properties_color_hsla_ws) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test1: hsla(127 40% 66.66666% / 0.3); test2: "
@@ -909,7 +910,7 @@ START_TEST(test_properties_color_hsla_ws) {
 }
 END_TEST
 START_TEST(test_properties_color_hwb) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test1: hwb(190,65%,0%); test2: hwb(265, 31%, "
@@ -937,7 +938,7 @@ START_TEST(test_properties_color_hwb) {
 }
 END_TEST
 START_TEST(test_properties_color_hwb_ws) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -972,7 +973,7 @@ START_TEST(test_properties_color_hwb_ws) {
 }
 END_TEST
 START_TEST(test_properties_color_cmyk) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -994,7 +995,7 @@ START_TEST(test_properties_color_cmyk) {
 }
 END_TEST
 START_TEST(test_properties_color_cmyk_ws) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -1016,7 +1017,7 @@ START_TEST(test_properties_color_cmyk_ws) {
 }
 END_TEST
 START_TEST(test_properties_color_names) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   for (unsigned int iter = 0; iter < num_CSSColors; iter++) {
@@ -1048,7 +1049,7 @@ START_TEST(test_properties_color_names) {
 }
 END_TEST
 START_TEST(test_properties_color_names_alpha) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   for (unsigned int iter = 0; iter < num_CSSColors; iter++) {
@@ -1072,7 +1073,7 @@ START_TEST(test_properties_color_names_alpha) {
 }
 END_TEST
 START_TEST(test_properties_padding_2) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10px 20px;}");
@@ -1091,7 +1092,7 @@ START_TEST(test_properties_padding_2) {
 }
 END_TEST
 START_TEST(test_properties_padding_3) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10px 30px 20px;}");
@@ -1110,7 +1111,7 @@ START_TEST(test_properties_padding_3) {
 }
 END_TEST
 START_TEST(test_properties_padding_4) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 10px 30px 20px 40px;}");
@@ -1130,7 +1131,7 @@ START_TEST(test_properties_padding_4) {
 END_TEST
 
 START_TEST(test_properties_string_escape) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -1145,7 +1146,7 @@ START_TEST(test_properties_string_escape) {
 }
 END_TEST
 START_TEST(test_properties_string) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { font: \"blaat€\"; test: 123.432; }");
@@ -1156,7 +1157,7 @@ START_TEST(test_properties_string) {
 }
 END_TEST
 START_TEST(test_properties_double) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { test: 123.432; }");
@@ -1165,7 +1166,7 @@ START_TEST(test_properties_double) {
 }
 END_TEST
 START_TEST(test_properties_integer) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { yoffset: 4; }");
@@ -1174,7 +1175,7 @@ START_TEST(test_properties_integer) {
 END_TEST
 
 START_TEST(test_properties_orientation) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { vert: vertical; hori: horizontal; }");
@@ -1194,7 +1195,7 @@ START_TEST(test_properties_orientation) {
 }
 END_TEST
 START_TEST(test_properties_orientation_case) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { vert: Vertical; hori: HoriZonTal;}");
@@ -1207,7 +1208,7 @@ START_TEST(test_properties_orientation_case) {
 }
 END_TEST
 START_TEST(test_properties_cursor) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { def: default; ptr: pointer; txt: text; }");
@@ -1220,7 +1221,7 @@ START_TEST(test_properties_cursor) {
 }
 END_TEST
 START_TEST(test_properties_cursor_case) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string("* { def: dEfault; ptr: POINter; txt: tExt; }");
@@ -1233,7 +1234,7 @@ START_TEST(test_properties_cursor_case) {
 }
 END_TEST
 START_TEST(test_properties_list) {
-  widget wid;
+  widget wid = {0};
   wid.name = "blaat";
   wid.state = NULL;
   rofi_theme_parse_string(
@@ -1284,6 +1285,95 @@ START_TEST(test_parse_file_not_existing) {
   error = 0;
 }
 END_TEST
+/** Supported theme file extensions, defined by the theme lexer. */
+extern const char *rasi_theme_file_extensions[];
+
+static ThemeWidget *theme_cache_test_child(ThemeWidget *wid, const char *name) {
+  for (unsigned int i = 0; i < wid->num_widgets; i++) {
+    if (g_strcmp0(wid->widgets[i]->name, name) == 0) {
+      return wid->widgets[i];
+    }
+  }
+  return NULL;
+}
+
+START_TEST(test_theme_cache) {
+  char *dir = g_dir_make_tmp("rofi-theme-cache-XXXXXX", NULL);
+  ck_assert_ptr_nonnull(dir);
+  char *file = g_build_filename(dir, "test.rasi", NULL);
+  char *cache = g_build_filename(dir, "theme.cache", NULL);
+  ck_assert(g_file_set_contents(
+      file,
+      "* { red: #FF0000; }\n"
+      "window { width: calc( 1036 + 30 ); padding: 2px 4px; "
+      "border-color: var(red); "
+      "children: [ listview, inputbar ]; }\n"
+      "@media ( min-width: 100px ) { window { enabled: false; } }\n",
+      -1, NULL));
+  char *path = helper_get_theme_path(file, rasi_theme_file_extensions, NULL);
+
+  rofi_theme_reset();
+  rofi_theme_cache_record_begin();
+  ck_assert_int_eq(rofi_theme_parse_file(file), FALSE);
+  rofi_theme_cache_record_end(cache, path);
+  rofi_theme_free(rofi_theme);
+  rofi_theme = NULL;
+
+  ck_assert_int_eq(rofi_theme_cache_load(cache, path), TRUE);
+  ck_assert_ptr_nonnull(rofi_theme);
+  ck_assert_str_eq(rofi_theme->name, "Root");
+  Property *p = g_hash_table_lookup(rofi_theme->properties, "red");
+  ck_assert_ptr_nonnull(p);
+  ck_assert_int_eq(p->type, P_COLOR);
+  ck_assert_double_eq_tol(p->value.color.red, 1.0, REAL_COMPARE_DELTA);
+
+  ThemeWidget *window = theme_cache_test_child(rofi_theme, "window");
+  ck_assert_ptr_nonnull(window);
+  ck_assert_ptr_eq(window->parent, rofi_theme);
+  p = g_hash_table_lookup(window->properties, "padding");
+  ck_assert_int_eq(p->type, P_PADDING);
+  ck_assert_double_eq_tol(p->value.padding.top.base.distance, 2.0,
+                          REAL_COMPARE_DELTA);
+  ck_assert_double_eq_tol(p->value.padding.right.base.distance, 4.0,
+                          REAL_COMPARE_DELTA);
+  widget wid = {0};
+  wid.name = "window";
+  wid.state = "";
+  RofiDistance d = rofi_theme_get_distance(&wid, "width", 0);
+  ck_assert_int_eq(distance_get_pixel(d, ROFI_ORIENTATION_HORIZONTAL), 1066);
+  p = g_hash_table_lookup(window->properties, "border-color");
+  ck_assert_int_eq(p->type, P_LINK);
+  ck_assert_str_eq(p->value.link.name, "red");
+  ck_assert_ptr_null(p->value.link.ref);
+  p = g_hash_table_lookup(window->properties, "children");
+  ck_assert_int_eq(p->type, P_LIST);
+  ck_assert_int_eq(g_list_length(p->value.list), 2);
+
+  gboolean media = FALSE;
+  for (unsigned int i = 0; i < rofi_theme->num_widgets; i++) {
+    ThemeWidget *wid = rofi_theme->widgets[i];
+    if (wid->media != NULL) {
+      ck_assert_int_eq(wid->media->type, THEME_MEDIA_TYPE_MIN_WIDTH);
+      ck_assert_double_eq_tol(wid->media->value, 100.0, REAL_COMPARE_DELTA);
+      ck_assert_ptr_nonnull(theme_cache_test_child(wid, "window"));
+      media = TRUE;
+    }
+  }
+  ck_assert(media);
+
+  // A changed theme file invalidates the cache.
+  ck_assert(g_file_set_contents(file, "* { red: #00FF00; }\n", -1, NULL));
+  ck_assert_int_eq(rofi_theme_cache_load(cache, path), FALSE);
+
+  g_unlink(cache);
+  g_unlink(file);
+  g_rmdir(dir);
+  g_free(path);
+  g_free(cache);
+  g_free(file);
+  g_free(dir);
+}
+END_TEST
 START_TEST(test_import_empty) {
   rofi_theme_parse_string("@import \"/dev/null\"");
   ck_assert_ptr_nonnull(rofi_theme);
@@ -1336,8 +1426,51 @@ START_TEST(test_import_error) {
   warning = 0;
 }
 END_TEST
+START_TEST(test_style_state_change) {
+  widget wid = {0};
+  wid.name = "element";
+  wid.state = "normal.normal";
+  rofi_theme_parse_string("element { spacing: 1; enabled: true; }"
+                          "element selected { spacing: 2; }");
+  ck_assert_ptr_nonnull(rofi_theme);
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "spacing", 0), 1);
+  ck_assert_ptr_nonnull(wid.style);
+
+  // The cached style of the old state is not used for the new one.
+  wid.state = "selected.normal";
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "spacing", 0), 2);
+  ck_assert_int_eq(rofi_theme_get_boolean(&wid, "enabled", FALSE), TRUE);
+
+  wid.state = "normal.normal";
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "spacing", 0), 1);
+}
+END_TEST
+
+START_TEST(test_style_parse_string_invalidates) {
+  widget wid = {0};
+  wid.name = "element";
+  wid.state = "";
+  rofi_theme_parse_string("element { spacing: 1; }");
+  ck_assert_ptr_nonnull(rofi_theme);
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "spacing", 0), 1);
+  // Not set yet, the miss is cached too.
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "padding", 0), 0);
+
+  // Like -theme-str, parsed after the first lookup.
+  rofi_theme_parse_string("element { spacing: 3; padding: 4; }");
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "spacing", 0), 3);
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "padding", 0), 4);
+
+  // A new widget section for the name.
+  rofi_theme_parse_string("element selected { spacing: 5; }");
+  wid.state = "selected.normal";
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "spacing", 0), 5);
+  ck_assert_int_eq(rofi_theme_get_integer(&wid, "padding", 0), 4);
+}
+END_TEST
+
 START_TEST(test_prepare_array) {
-  widget wid;
+  widget wid = {0};
   wid.name = "element-text";
   wid.state = "normal.normal";
   rofi_theme_parse_string("element-text  { tabs: [ 10, 20px, 30px, 40px ];}");
@@ -1362,7 +1495,7 @@ START_TEST(test_prepare_array) {
 END_TEST
 
 START_TEST(test_prepare_math_floor) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 1024 floor 30 );}");
@@ -1377,7 +1510,7 @@ START_TEST(test_prepare_math_floor) {
 }
 END_TEST
 START_TEST(test_prepare_math_ceil) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 1024 ceil 30 );}");
@@ -1392,7 +1525,7 @@ START_TEST(test_prepare_math_ceil) {
 }
 END_TEST
 START_TEST(test_prepare_math_round) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 1036 round 30 );}");
@@ -1407,7 +1540,7 @@ START_TEST(test_prepare_math_round) {
 }
 END_TEST
 START_TEST(test_prepare_math_add) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 1036 + 30 );}");
@@ -1422,7 +1555,7 @@ START_TEST(test_prepare_math_add) {
 }
 END_TEST
 START_TEST(test_prepare_math_subtract) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 1036 - 30 );}");
@@ -1437,7 +1570,7 @@ START_TEST(test_prepare_math_subtract) {
 }
 END_TEST
 START_TEST(test_prepare_math_multiply) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 256*4 );}");
@@ -1452,7 +1585,7 @@ START_TEST(test_prepare_math_multiply) {
 }
 END_TEST
 START_TEST(test_prepare_math_modulo) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 255 modulo 4 modulo 5 );}");
@@ -1468,7 +1601,7 @@ START_TEST(test_prepare_math_modulo) {
 END_TEST
 
 START_TEST(test_prepare_math_min) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 256 min 4 );}");
@@ -1484,7 +1617,7 @@ START_TEST(test_prepare_math_min) {
 END_TEST
 
 START_TEST(test_prepare_math_max) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 256 max 4 );}");
@@ -1500,7 +1633,7 @@ START_TEST(test_prepare_math_max) {
 END_TEST
 
 START_TEST(test_prepare_math_failure) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( 1/2 * 500 );}");
@@ -1516,7 +1649,7 @@ START_TEST(test_prepare_math_failure) {
 END_TEST
 
 START_TEST(test_prepare_math_failure2) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc( -16/2 * 1.5 );}");
@@ -1531,7 +1664,7 @@ START_TEST(test_prepare_math_failure2) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure3) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc(10+3);}");
@@ -1546,7 +1679,7 @@ START_TEST(test_prepare_math_failure3) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure4) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc(10.0+3.2);}");
@@ -1561,7 +1694,7 @@ START_TEST(test_prepare_math_failure4) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure5) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc(10-3);}");
@@ -1576,7 +1709,7 @@ START_TEST(test_prepare_math_failure5) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure6) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc(10.0-3.2);}");
@@ -1591,7 +1724,7 @@ START_TEST(test_prepare_math_failure6) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure7) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc(-10--3);}");
@@ -1606,7 +1739,7 @@ START_TEST(test_prepare_math_failure7) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure8) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: calc(-10.0--3.2);}");
@@ -1621,7 +1754,7 @@ START_TEST(test_prepare_math_failure8) {
 }
 END_TEST
 START_TEST(test_prepare_math_failure9) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window  { width: -128;}");
@@ -1643,7 +1776,7 @@ START_TEST(test_prepare_default) {
 }
 END_TEST
 START_TEST(test_prepare_environment_nf) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window {  width: env(QER_TEST,128); }");
@@ -1658,7 +1791,7 @@ START_TEST(test_prepare_environment_nf) {
 }
 END_TEST
 START_TEST(test_prepare_environment_f) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   setenv("QER_TEST", "64", 1);
@@ -1675,7 +1808,7 @@ START_TEST(test_prepare_environment_f) {
 }
 END_TEST
 START_TEST(test_prepare_environment_old_style) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   setenv("QER_TEST", "64", 1);
@@ -1693,7 +1826,7 @@ START_TEST(test_prepare_environment_old_style) {
 }
 END_TEST
 START_TEST(test_prepare_environment_media_f) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   setenv("QER_TEST", "true", 1);
@@ -1713,7 +1846,7 @@ START_TEST(test_prepare_environment_media_f) {
 END_TEST
 
 START_TEST(test_prepare_environment_media_nf) {
-  widget wid;
+  widget wid = {0};
   wid.name = "window";
   wid.state = "";
   rofi_theme_parse_string("window { width: 32; } @media( enabled: "
@@ -1925,6 +2058,21 @@ static Suite *theme_parser_suite(void) {
     tcase_add_test(tc_prop_import, test_import_error);
     suite_add_tcase(s, tc_prop_import);
   }
+  {
+    TCase *tc_theme_cache = tcase_create("Cache");
+    tcase_add_checked_fixture(tc_theme_cache, theme_parser_setup,
+                              theme_parser_teardown);
+    tcase_add_test(tc_theme_cache, test_theme_cache);
+    suite_add_tcase(s, tc_theme_cache);
+  }
+  {
+    TCase *tc_style = tcase_create("Style");
+    tcase_add_checked_fixture(tc_style, theme_parser_setup,
+                              theme_parser_teardown);
+    tcase_add_test(tc_style, test_style_state_change);
+    tcase_add_test(tc_style, test_style_parse_string_invalidates);
+    suite_add_tcase(s, tc_style);
+  }
   {
     TCase *tc_prepare_path = tcase_create("prepare_path");
     tcase_add_test(tc_prepare_path, test_prepare_path);
@@ -64,6 +64,11 @@ void rofi_timings_tick(G_GNUC_UNUSED const char *file,
 void rofi_timings_tick(G_GNUC_UNUSED const char *file,
                        G_GNUC_UNUSED char const *str, G_GNUC_UNUSED int line,
                        G_GNUC_UNUSED char const *msg) {}
+gboolean rofi_timings_profiling = FALSE;
+void rofi_timings_counter_add(G_GNUC_UNUSED const char *name,
+                              G_GNUC_UNUSED gint64 delta) {}
+void rofi_timings_span_begin(G_GNUC_UNUSED const char *name) {}
+void rofi_timings_span_end(G_GNUC_UNUSED const char *name) {}
 
 cairo_surface_t *rofi_icon_fetcher_get(G_GNUC_UNUSED const uint32_t uid) {
   return NULL;